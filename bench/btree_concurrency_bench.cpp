@@ -0,0 +1,100 @@
+/* Throughput of threads sharing a table-like B-tree (int keys, rows of
+ * 64 bytes), each doing point lookups with some inserts of new keys
+ * among the rows and some erases of rows, which merge pages, by the
+ * latches of the tree and by holding one mutex over each operation
+ * instead. The tree is loaded again for each run.
+ * Usage: btree_concurrency_bench [rows] [ops per thread] [insert %] [erase %] */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../src/btree/btree.h"
+
+static const int key_step = 1024;  // inserted keys fall between the rows
+
+static double seconds_since(std::chrono::steady_clock::time_point begin)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+/* operations per second of `threads` threads, one mutex held over each
+ * operation if `global` */
+static double run(int threads, bool global, int rows, int ops, int insert_percent, int erase_percent)
+{
+	const char *filename = "btree_concurrency_bench.tdata";
+	std::remove(filename);
+	pager pg(filename);
+	int_btree bt(&pg, 0);
+	std::vector<char> row(64);
+	for(int i = 0; i != rows; ++i)
+	{
+		int key = i * key_step;
+		std::memcpy(row.data(), &key, sizeof(int));
+		bt.insert(key, row.data(), (int)row.size());
+	}
+
+	std::mutex latch;
+	std::vector<long long> sums(threads);
+	std::vector<std::thread> workers;
+	auto begin = std::chrono::steady_clock::now();
+	for(int t = 0; t != threads; ++t)
+	{
+		workers.emplace_back([&, t] {
+			std::mt19937 rng(t + 1);
+			std::vector<char> data(64);
+			long long sum = 0;
+			for(int i = 0; i != ops; ++i)
+			{
+				int key = (int)(rng() % rows) * key_step;
+				int op = (int)(rng() % 100);
+				std::unique_lock<std::mutex> lock(latch, std::defer_lock);
+				if(global) lock.lock();
+				if(op < insert_percent)
+				{
+					key += 1 + (int)(rng() % (key_step - 1));
+					std::memcpy(data.data(), &key, sizeof(int));
+					bt.insert(key, data.data(), (int)data.size());
+				} else if(op < insert_percent + erase_percent) {
+					bt.erase(key);
+				} else {
+					bt.find(key, [&](int_btree::leaf_page &leaf, int pos) {
+						sum += leaf.get_key(pos);
+					} );
+				}
+			}
+			sums[t] = sum;
+		} );
+	}
+
+	for(std::thread &w : workers)
+		w.join();
+	double sec = seconds_since(begin);
+	std::remove(filename);
+	return (double)threads * ops / sec;
+}
+
+int main(int argc, char *argv[])
+{
+	int rows = argc > 1 ? std::atoi(argv[1]) : 200000;
+	int ops = argc > 2 ? std::atoi(argv[2]) : 200000;
+	int insert_percent = argc > 3 ? std::min(std::max(std::atoi(argv[3]), 0), 100) : 10;
+	int erase_percent = argc > 4 ? std::min(std::max(std::atoi(argv[4]), 0), 100 - insert_percent) : 5;
+
+	std::printf("%d rows, %d ops per thread, %d%% inserts, %d%% erases, %u cores\n",
+		rows, ops, insert_percent, erase_percent, std::thread::hardware_concurrency());
+	std::printf("%8s %14s %14s %10s\n", "threads", "mutex op/s", "latched op/s", "speedup");
+	for(int threads = 1; threads <= 8; threads *= 2)
+	{
+		double global = run(threads, true, rows, ops, insert_percent, erase_percent);
+		double latched = run(threads, false, rows, ops, insert_percent, erase_percent);
+		std::printf("%8d %14.0f %14.0f %9.2fx\n", threads, global, latched, latched / global);
+	}
+
+	return 0;
+}
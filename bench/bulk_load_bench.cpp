@@ -0,0 +1,97 @@
+/* Building an index of int keys by `index_btree::bulk_load` against
+ * inserting the keys one by one, in ascending and in random order:
+ * time taken, and the number of leaf pages with how full they are.
+ * Usage: bulk_load_bench [keys] */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "../src/btree/btree.h"
+#include "../src/btree/index_key.h"
+
+typedef index_btree<fixed_key_comparer> int_index;
+
+static const int stride = scalar_key_size;
+
+static double seconds_since(std::chrono::steady_clock::time_point begin)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+/* leaf pages of the tree, and the bytes of their keys over their space */
+static std::pair<int, double> leaf_fill(pager &pg, int_index &index, const char *first_key)
+{
+	int pages = 0;
+	long long used = 0, usable = 0;
+	for(int page_id = index.lower_bound(first_key).first; page_id; ++pages)
+	{
+		int_index::leaf_page leaf { pg.read(page_id), &pg };
+		used += leaf.used();
+		usable += leaf.usable();
+		page_id = leaf.next_page();
+	}
+	return { pages, usable ? 100.0 * used / usable : 0.0 };
+}
+
+/* build the index from the keys with `build`, and print a row */
+template<typename Build>
+static void run(const char *name, const std::vector<char> &keys, Build build)
+{
+	const char *filename = "bulk_load_bench.tdata";
+	std::remove(filename);
+	pager pg(filename);
+	int_index index(&pg, 0, stride);
+	auto begin = std::chrono::steady_clock::now();
+	build(index);
+	double sec = seconds_since(begin);
+	int num = (int)(keys.size() / stride);
+	auto fill = leaf_fill(pg, index, keys.data());
+	std::printf("%-18s %10.3f %12.0f %12d %8.1f\n", name, sec, num / sec, fill.first, fill.second);
+	std::remove(filename);
+}
+
+int main(int argc, char *argv[])
+{
+	int num = argc > 1 ? std::atoi(argv[1]) : 1000000;
+
+	// keys as `index_manager` makes them for an int column, in ascending order
+	std::vector<char> keys((size_t)num * stride);
+	for(int i = 0; i != num; ++i)
+	{
+		char *key = &keys[(size_t)i * stride];
+		key[0] = 1;
+		index_key::encode_int(key + 1, i * 2 - num);
+		index_key::encode_int(key + 5, i + 1);
+	}
+	std::vector<int> order(num);
+	for(int i = 0; i != num; ++i)
+		order[i] = i;
+	std::shuffle(order.begin(), order.end(), std::mt19937(1));
+
+	std::printf("%d int keys\n", num);
+	std::printf("%-18s %10s %12s %12s %8s\n", "build", "seconds", "keys/s", "leaf pages", "fill %");
+	for(int fill_percent : { 100, 90, 70 })
+	{
+		char name[32];
+		std::snprintf(name, sizeof(name), "bulk_load %d%%", fill_percent);
+		run(name, keys, [&](int_index &index) {
+			int next_key = 0;
+			index.bulk_load([&]() -> const char* {
+				return next_key == num ? nullptr : &keys[(size_t)next_key++ * stride];
+			}, fill_percent);
+		} );
+	}
+	run("insert ascending", keys, [&](int_index &index) {
+		for(int i = 0; i != num; ++i)
+			index.insert(&keys[(size_t)i * stride], i + 1);
+	} );
+	run("insert random", keys, [&](int_index &index) {
+		for(int i : order)
+			index.insert(&keys[(size_t)i * stride], i + 1);
+	} );
+
+	return 0;
+}
@@ -0,0 +1,94 @@
+/* Hit rates of the replacement policies under point reads of a hot set
+ * with full scans of a file larger than the buffer pool between them,
+ * the scans being what 2Q keeps out of the hot pages and LRU does not.
+ * The file is opened again for each policy, so the pool starts empty.
+ * Usage: cache_policy_bench [pool pages] [file pages] [reads per scan] */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "../src/fs/page_fs.h"
+
+static const int rounds = 20;
+static const int hot_percent = 90;  // point reads of the hot set
+
+static double seconds_since(std::chrono::steady_clock::time_point begin)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+static double hit_rate(const page_fs_stats_t &before, const page_fs_stats_t &after)
+{
+	std::uint64_t hits = after.hits - before.hits;
+	std::uint64_t misses = after.misses - before.misses;
+	return hits + misses ? 100.0 * hits / (hits + misses) : 0.0;
+}
+
+int main(int argc, char *argv[])
+{
+	int pool = std::max(argc > 1 ? std::atoi(argv[1]) : 1024, PAGE_CACHE_MIN_CAPACITY);
+	int file_pages = argc > 2 ? std::atoi(argv[2]) : pool * 4;
+	int reads = argc > 3 ? std::atoi(argv[3]) : pool * 4;
+	int hot_pages = pool / 2;
+
+	const char *filename = "cache_policy_bench.tdata";
+	std::remove(filename);
+	page_fs *fs = page_fs::get_instance();
+	fs->resize(pool);
+	int fid = fs->open(filename);
+	for(int i = 0; i != file_pages; ++i)
+		fs->allocate(fid);
+	fs->close(fid);
+
+	// the hot set is spread over the file
+	std::vector<int> page_ids(file_pages);
+	for(int i = 0; i != file_pages; ++i)
+		page_ids[i] = i + 1;
+	std::mt19937 rng(1);
+	std::shuffle(page_ids.begin(), page_ids.end(), rng);
+	std::vector<int> order(reads);
+	long long sum = 0;
+
+	std::printf("%d pages in the pool, %d in the file, %d hot, %d point reads per scan, %d%% of them hot\n",
+		pool, file_pages, hot_pages, reads, hot_percent);
+	std::printf("%6s %12s %12s %12s %10s\n", "policy", "point hit%", "scan hit%", "total hit%", "seconds");
+	for(const char *policy : { "lru", "2q" })
+	{
+		fs->set_policy(policy);
+		fid = fs->open(filename);
+		rng.seed(2);
+		page_fs_stats_t first = fs->get_stats(), before, after;
+		std::uint64_t point_hits = 0, point_reads = 0;
+		auto begin = std::chrono::steady_clock::now();
+		for(int r = 0; r != rounds; ++r)
+		{
+			for(int &x : order)
+				x = (int)(rng() % 100) < hot_percent
+					? page_ids[rng() % hot_pages] : 1 + (int)(rng() % file_pages);
+			before = fs->get_stats();
+			for(int x : order)
+				sum += fs->read(fid, x).get()[0];
+			after = fs->get_stats();
+			point_hits += after.hits - before.hits;
+			point_reads += (after.hits - before.hits) + (after.misses - before.misses);
+
+			for(int i = 1; i <= file_pages; ++i)
+				sum += fs->read(fid, i).get()[0];
+		}
+		double sec = seconds_since(begin);
+		after = fs->get_stats();
+		std::uint64_t scan_reads = (std::uint64_t)rounds * file_pages;
+		std::uint64_t scan_hits = (after.hits - first.hits) - point_hits;
+		std::printf("%6s %12.2f %12.2f %12.2f %10.3f\n", policy,
+			100.0 * point_hits / point_reads, 100.0 * scan_hits / scan_reads,
+			hit_rate(first, after), sec);
+		fs->close(fid);
+	}
+
+	std::printf("(checksum %lld)\n", sum);
+	std::remove(filename);
+	return 0;
+}
@@ -0,0 +1,117 @@
+/* Random 4 KB page reads of a file by `fseek` + `fread` on one FILE*
+ * under a mutex, as page_fs did before `file_io`, against the positional
+ * reads of `file_io`, buffered and direct (O_DIRECT), by 1 to 8 threads.
+ * Buffered reads are served by the OS page cache once the file has been
+ * read, direct reads go to the disk each time.
+ * Usage: file_io_bench [file MB] [reads per thread] */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../src/fs/file_io.h"
+
+static const char *filename = "file_io_bench.tdata";
+
+static double seconds_since(std::chrono::steady_clock::time_point begin)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+/* reads per second of `threads` threads each doing `reads` reads of
+ * random pages by `read_page(page_id, buf)`, buffers are page aligned */
+template<typename Fn>
+static double run(int threads, int pages, int reads, Fn read_page)
+{
+	std::vector<long long> sums(threads);
+	std::vector<std::thread> workers;
+	auto begin = std::chrono::steady_clock::now();
+	for(int t = 0; t != threads; ++t)
+	{
+		workers.emplace_back([&, t] {
+			std::mt19937 rng(t + 1);
+			char *buf = (char*)std::aligned_alloc(PAGE_SIZE, PAGE_SIZE);
+			long long sum = 0;
+			for(int i = 0; i != reads; ++i)
+			{
+				read_page((int)(rng() % pages), buf);
+				sum += buf[i % PAGE_SIZE];
+			}
+			sums[t] = sum;
+			std::free(buf);
+		} );
+	}
+	for(std::thread &w : workers)
+		w.join();
+	return (double)threads * reads / seconds_since(begin);
+}
+
+int main(int argc, char *argv[])
+{
+	int megabytes = argc > 1 ? std::atoi(argv[1]) : 64;
+	int reads = argc > 2 ? std::atoi(argv[2]) : 200000;
+	int pages = std::max(megabytes * (1 << 20) / PAGE_SIZE, 1);
+
+	std::remove(filename);
+	bool created;
+	file_io out;
+	if(!out.open(filename, false, created))
+	{
+		std::fprintf(stderr, "[Error] cannot create %s.\n", filename);
+		return 1;
+	}
+	std::vector<char> page(PAGE_SIZE);
+	for(int i = 0; i != pages; ++i)
+	{
+		std::fill(page.begin(), page.end(), (char)i);
+		out.write_page(i, page.data());
+	}
+	out.sync();
+	out.close();
+
+	FILE *stream = std::fopen(filename, "rb");
+	std::mutex latch;
+	file_io buffered, direct;
+	buffered.open(filename, false, created);
+	direct.open(filename, true, created);
+
+	std::printf("%d MB file, %d random %d byte reads per thread, %u cores\n",
+		megabytes, reads, PAGE_SIZE, std::thread::hardware_concurrency());
+	if(!direct.is_direct())
+		std::printf("no direct I/O on this file system\n");
+	std::printf("%8s %14s %14s %14s\n", "threads", "fread read/s", "pread read/s", "direct read/s");
+	for(int threads = 1; threads <= 8; threads *= 2)
+	{
+		double t_fread = run(threads, pages, reads, [&](int page_id, char *buf) {
+			std::lock_guard<std::mutex> lock(latch);
+			std::fseek(stream, (long)page_id * PAGE_SIZE, SEEK_SET);
+			if(std::fread(buf, PAGE_SIZE, 1, stream) != 1)
+				std::abort();
+		} );
+		double t_pread = run(threads, pages, reads, [&](int page_id, char *buf) {
+			if(!buffered.read_page(page_id, buf))
+				std::abort();
+		} );
+		std::printf("%8d %14.0f %14.0f", threads, t_fread, t_pread);
+		if(direct.is_direct())
+		{
+			// a tenth of the reads, they wait for the disk
+			double t_direct = run(threads, pages, std::max(reads / 10, 1), [&](int page_id, char *buf) {
+				if(!direct.read_page(page_id, buf))
+					std::abort();
+			} );
+			std::printf(" %14.0f", t_direct);
+		}
+		std::printf("\n");
+	}
+
+	std::fclose(stream);
+	buffered.close();
+	direct.close();
+	std::remove(filename);
+	return 0;
+}
@@ -0,0 +1,185 @@
+/* Search in the int keys of one index page: by a binary search with a
+ * std::function decoding the keys as they were once laid out, with one
+ * comparing the encoded keys as bytes, with that comparison inlined, and
+ * by `scalar_key_lower_bound`, which uses AVX2 if the bench is built for it.
+ * Then point lookup latency of an index for each key type, with its
+ * pages hot in the buffer pool. The index
+ * is bulk loaded from distinct keys, looked up in a random order.
+ * Usage: index_search_bench [keys] [lookups] */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include "../src/algo/search.h"
+#include "../src/index/index.h"
+
+static double seconds_since(std::chrono::steady_clock::time_point begin)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+/* `keys` distinct keys of `size` bytes of a column of `type` in ascending order */
+static std::vector<char> make_keys(int type, int size, int keys)
+{
+	std::vector<char> data((size_t)keys * size);
+	for(int i = 0; i != keys; ++i)
+	{
+		char *key = &data[(size_t)i * size];
+		if(type == COL_TYPE_INT) {
+			int v = i * 2 - keys;
+			std::memcpy(key, &v, sizeof(int));
+		} else if(type == COL_TYPE_FLOAT) {
+			float v = (float)i * 0.5f - keys;
+			std::memcpy(key, &v, sizeof(float));
+		} else {
+			std::snprintf(key, size, "customer-%012d", i);
+		}
+	}
+
+	return data;
+}
+
+/* ns per search of the `probes`, `stride` bytes apart, searched for
+ * in turn `lookups` times */
+template<typename Search>
+static double time_search(const std::vector<char> &probes, int stride, int lookups, Search search)
+{
+	// volatile, or the searches may be moved out of the timing
+	volatile long long sum = 0;
+	int num = (int)(probes.size() / stride);
+	auto begin = std::chrono::steady_clock::now();
+	for(int i = 0; i != lookups; ++i)
+		sum += search(&probes[(size_t)(i % num) * stride]);
+	return seconds_since(begin) * 1e9 / lookups;
+}
+
+/* an int key [rid, nullmark, data] as it was before keys were encoded */
+static int decoded_compare(const char *a, const char *b)
+{
+	if(a[4] != b[4]) return a[4] ? -1 : 1;
+	if(!a[4])
+	{
+		int r = integer_bin_comparer(a + 5, b + 5);
+		if(r != 0) return r;
+	}
+
+	return integer_comparer(*(const int*)a, *(const int*)b);
+}
+
+/* the keys of a full page of int keys, made as `index_manager` does */
+static void page_search(int lookups)
+{
+	const int stride = scalar_key_size;
+	const int n = (PAGE_SIZE - 16) / (stride + sizeof(int));
+	// probes which stay in the cache with the page, but too many for the
+	// branch predictor to learn the path of each
+	const int num = 16384;
+	std::vector<char> keys((size_t)n * stride), old_keys(keys.size());
+	std::vector<int> order(num);
+	for(int i = 0; i != n; ++i)
+	{
+		int rid = i + 1, val = i * 2;
+		char *key = &keys[(size_t)i * stride], *old_key = &old_keys[(size_t)i * stride];
+		key[0] = 1;
+		index_key::encode_int(key + 1, val);
+		index_key::encode_int(key + 5, rid);
+		std::memcpy(old_key, &rid, sizeof(int));
+		old_key[4] = 0;
+		std::memcpy(old_key + 5, &val, sizeof(int));
+	}
+
+	std::mt19937 rng(2);
+	for(int &k : order)
+		k = rng() % n;
+	std::vector<char> probes, old_probes;
+	for(int k : order)
+	{
+		probes.insert(probes.end(), &keys[(size_t)k * stride], &keys[(size_t)(k + 1) * stride]);
+		old_probes.insert(old_probes.end(), &old_keys[(size_t)k * stride], &old_keys[(size_t)(k + 1) * stride]);
+	}
+
+	std::function<int(const char*, const char*)> decoded = decoded_compare;
+	std::function<int(const char*, const char*)> dynamic = fixed_key_comparer(stride);
+	fixed_key_comparer inlined(stride);
+	double t0 = time_search(old_probes, stride, lookups, [&](const char *key) {
+		return ::lower_bound(0, n, [&](int id) { return decoded(&old_keys[(size_t)id * stride], key) < 0; });
+	} );
+	double t1 = time_search(probes, stride, lookups, [&](const char *key) {
+		return ::lower_bound(0, n, [&](int id) { return dynamic(&keys[(size_t)id * stride], key) < 0; });
+	} );
+	double t2 = time_search(probes, stride, lookups, [&](const char *key) {
+		return ::lower_bound(0, n, [&](int id) { return inlined(&keys[(size_t)id * stride], key) < 0; });
+	} );
+	double t3 = time_search(probes, stride, lookups, [&](const char *key) {
+		return scalar_key_lower_bound(keys.data(), n, key);
+	} );
+
+	std::printf("search in a page of %d int keys (ns/search):\n", n);
+	std::printf("%-26s %8.1f\n", "std::function, decoded", t0);
+	std::printf("%-26s %8.1f\n", "std::function, bytes", t1);
+	std::printf("%-26s %8.1f\n", "inlined, bytes", t2);
+#ifdef __AVX2__
+	std::printf("%-26s %8.1f\n", "5-way, AVX2", t3);
+#else
+	std::printf("%-26s %8.1f\n", "5-way, scalar", t3);
+#endif
+}
+
+static void run(const char *name, int type, int size, int keys, int lookups)
+{
+	const char *filename = "index_search_bench.tdata";
+	std::remove(filename);
+	std::vector<char> data = make_keys(type, size, keys);
+
+	std::mt19937 rng(1);
+	std::vector<int> order(lookups);
+	for(int &k : order)
+		k = rng() % keys;
+
+	pager pg(filename);
+	index_manager index(&pg, size, 0, type);
+	int next_key = 0;
+	index.bulk_load([&](const char *&key, int &rid) {
+		if(next_key == keys) return false;
+		key = &data[(size_t)next_key * size];
+		rid = ++next_key;
+		return true;
+	}, INDEX_FILL_PERCENT);
+
+	long long sum = 0;
+	for(int round = 0; round != 2; ++round)
+	{
+		// the first round warms the buffer pool up
+		auto begin = std::chrono::steady_clock::now();
+		for(int k : order)
+			sum += index.lower_bound(&data[(size_t)k * size]).second;
+		double sec = seconds_since(begin);
+		if(round == 1)
+		{
+			std::printf("%-10s %10d %12.1f %12.2f\n", name, keys,
+				sec * 1e9 / lookups, lookups / sec / 1e6);
+		}
+	}
+
+	if(sum == -1) std::puts("");
+	std::remove(filename);
+}
+
+int main(int argc, char *argv[])
+{
+	int keys = argc > 1 ? std::atoi(argv[1]) : 500000;
+	int lookups = argc > 2 ? std::atoi(argv[2]) : 2000000;
+
+	page_search(lookups);
+	std::printf("\nindex lookups:\n");
+	std::printf("%-10s %10s %12s %12s\n", "key", "keys", "ns/lookup", "M lookup/s");
+	run("INT", COL_TYPE_INT, sizeof(int), keys, lookups);
+	run("FLOAT", COL_TYPE_FLOAT, sizeof(float), keys, lookups);
+	run("VARCHAR", COL_TYPE_VARCHAR, 32, keys, lookups);
+	return 0;
+}
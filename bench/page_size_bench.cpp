@@ -0,0 +1,124 @@
+/* Insert (by increasing keys, as rows are), scan and point lookup
+ * throughput of a table-like B-tree (int keys, rows of fixed size) for
+ * each page size. The buffer pool keeps its size in bytes as the frames
+ * grow. "cold" runs right after the file is reopened, its pages come
+ * from the OS page cache, "hot" runs next.
+ * Usage: page_size_bench [rows] [row bytes] [lookups] */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "../src/btree/btree.h"
+#include "../src/btree/iterator.h"
+
+typedef btree_iterator<int_btree::leaf_page> leaf_iterator;
+
+static double seconds_since(std::chrono::steady_clock::time_point begin)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+/* visit every row in key order like a table scan, one page read per row */
+static long long scan(pager *pg, int_btree &bt)
+{
+	long long sum = 0;
+	for(leaf_iterator it(pg, bt.lower_bound(0)); !it.is_end(); it.next())
+	{
+		int_btree::leaf_page leaf { pg->read(it.get().first), pg };
+		sum += leaf.get_key(it.get().second);
+	}
+	return sum;
+}
+
+static long long lookup(pager *pg, int_btree &bt, const std::vector<int> &keys)
+{
+	long long sum = 0;
+	for(int key : keys)
+	{
+		auto r = bt.lower_bound(key);
+		int_btree::leaf_page leaf { pg->read(r.first), pg };
+		sum += leaf.get_key(r.second);
+	}
+	return sum;
+}
+
+int main(int argc, char *argv[])
+{
+	int rows = argc > 1 ? std::atoi(argv[1]) : 200000;
+	int row_size = argc > 2 ? std::max(std::atoi(argv[2]), (int)sizeof(int)) : 64;
+	int lookups = argc > 3 ? std::atoi(argv[3]) : 200000;
+
+	std::mt19937 rng(1);
+	std::vector<int> keys(lookups);
+	for(int &k : keys)
+		k = rng() % rows;
+	std::vector<char> row(row_size);
+
+	page_fs *fs = page_fs::get_instance();
+	std::uint64_t pool_bytes = (std::uint64_t)fs->get_capacity() * fs->get_frame_size();
+	std::printf("%d rows of %d bytes, %d lookups, %llu KB pool\n",
+		rows, row_size, lookups, (unsigned long long)(pool_bytes >> 10));
+	std::printf("%6s %8s %12s %12s %12s %12s %12s\n", "page", "file KB", "insert/s",
+		"cold scan/s", "hot scan/s", "cold look/s", "hot look/s");
+
+	const char *filename = "page_size_bench.tdata";
+	for(int page_size = PAGE_SIZE; page_size <= PAGE_MAX_SIZE; page_size *= 2)
+	{
+		std::remove(filename);
+		int root;
+		double t[5];
+		{
+			pager pg(filename, page_size);
+			int_btree bt(&pg, 0);
+			auto begin = std::chrono::steady_clock::now();
+			for(int i = 0; i != rows; ++i)
+			{
+				std::memcpy(row.data(), &i, sizeof(int));
+				bt.insert(i, row.data(), row_size);
+			}
+			t[4] = seconds_since(begin);
+			root = bt.get_root_page_id();
+		}
+		// each pager opens the file with nothing of it cached
+		long long sum = 0;
+		{
+			pager pg(filename);
+			int_btree bt(&pg, root);
+			auto begin = std::chrono::steady_clock::now();
+			sum += scan(&pg, bt);
+			t[0] = seconds_since(begin);
+			begin = std::chrono::steady_clock::now();
+			sum += scan(&pg, bt);
+			t[1] = seconds_since(begin);
+		}
+		{
+			pager pg(filename);
+			int_btree bt(&pg, root);
+			auto begin = std::chrono::steady_clock::now();
+			sum += lookup(&pg, bt, keys);
+			t[2] = seconds_since(begin);
+			begin = std::chrono::steady_clock::now();
+			sum += lookup(&pg, bt, keys);
+			t[3] = seconds_since(begin);
+		}
+
+		std::FILE *f = std::fopen(filename, "rb");
+		long file_kb = 0;
+		if(f)
+		{
+			std::fseek(f, 0, SEEK_END);
+			file_kb = std::ftell(f) >> 10;
+			std::fclose(f);
+		}
+		std::printf("%5dK %8ld %12.0f %12.0f %12.0f %12.0f %12.0f  (checksum %lld)\n",
+			page_size >> 10, file_kb, rows / t[4], rows / t[0], rows / t[1],
+			lookups / t[2], lookups / t[3], sum);
+	}
+
+	std::remove(filename);
+	return 0;
+}
@@ -0,0 +1,93 @@
+/* Hit path of the buffer pool: page table lookups alone, against the
+ * node-based map they replaced, then `page_fs::read` of cached pages.
+ * Usage: page_table_bench [pages] [lookups] */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "../src/fs/page_fs.h"
+#include "../src/fs/page_table.h"
+
+typedef std::pair<int, int> file_page_t;
+
+struct pair_hash
+{
+	std::size_t operator () (const file_page_t &p) const {
+		return std::hash<int>{}(p.first) ^ (std::hash<int>{}(p.second) << 1);
+	}
+};
+
+static double seconds_since(std::chrono::steady_clock::time_point begin)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+int main(int argc, char *argv[])
+{
+	int pages = argc > 1 ? std::atoi(argv[1]) : PAGE_CACHE_CAPACITY / PAGE_CACHE_SHARDS;
+	int lookups = argc > 2 ? std::atoi(argv[2]) : 20000000;
+
+	// keys of a shard, pages of a few files
+	std::vector<file_page_t> keys;
+	for(int i = 0; i != pages; ++i)
+		keys.push_back({ 1 + i % 4, 1 + i / 4 });
+	std::mt19937 rng(1);
+	std::vector<int> order(1 << 16);
+	for(int &x : order)
+		x = rng() % pages;
+
+	std::unordered_map<file_page_t, int, pair_hash> map;
+	page_table table;
+	table.reserve(pages);
+	for(int i = 0; i != pages; ++i)
+	{
+		map[keys[i]] = i;
+		table.insert(((std::uint64_t)keys[i].first << 32) | (std::uint32_t)keys[i].second, i);
+	}
+
+	long long sum = 0;
+	auto begin = std::chrono::steady_clock::now();
+	for(int i = 0; i != lookups; ++i)
+		sum += map.find(keys[order[i & 0xffff]])->second;
+	double t_map = seconds_since(begin);
+
+	begin = std::chrono::steady_clock::now();
+	for(int i = 0; i != lookups; ++i)
+	{
+		const file_page_t &k = keys[order[i & 0xffff]];
+		sum -= table.find(((std::uint64_t)k.first << 32) | (std::uint32_t)k.second);
+	}
+	double t_table = seconds_since(begin);
+
+	std::printf("%d keys, %d lookups (checksum %lld)\n", pages, lookups, sum);
+	std::printf("unordered_map  %6.2f ns/lookup\n", t_map * 1e9 / lookups);
+	std::printf("page_table     %6.2f ns/lookup, %.3f probes/lookup\n",
+		t_table * 1e9 / lookups, (double)table.get_probes() / table.get_lookups());
+
+	// the whole hit path, one file fitting in the pool
+	const char *filename = "page_table_bench.tdata";
+	std::remove(filename);
+	page_fs *fs = page_fs::get_instance();
+	int fid = fs->open(filename);
+	int file_pages = std::min(pages, fs->get_capacity() / 2);
+	for(int i = 0; i != file_pages; ++i)
+		fs->allocate(fid);
+	fs->reset_stats();
+
+	begin = std::chrono::steady_clock::now();
+	for(int i = 0; i != lookups; ++i)
+		sum += fs->read(fid, 1 + order[i & 0xffff] % file_pages).get()[0];
+	double t_read = seconds_since(begin);
+	page_fs_stats_t stats = fs->get_stats();
+	std::printf("page_fs::read  %6.2f ns/hit, %.3f probes/lookup, %llu misses\n",
+		t_read * 1e9 / lookups, (double)stats.probes / stats.lookups,
+		(unsigned long long)stats.misses);
+
+	fs->close(fid);
+	std::remove(filename);
+	return 0;
+}
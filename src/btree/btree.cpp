@@ -1,13 +1,58 @@
 #include "btree.h"
 #include "../algo/search.h"
+#include <algorithm>
+#include <vector>
+
+static inline bool is_interior(uint16_t magic)
+{
+	return magic == PAGE_FIXED || magic == PAGE_KEY_INTERIOR;
+}
+
+static inline bool is_leaf(uint16_t magic)
+{
+	return magic == PAGE_VARIANT || magic == PAGE_INDEX_LEAF || magic == PAGE_KEY_LEAF;
+}
+
+/* the first element of a page which is not less than `key` */
+template<typename Page, typename Key, typename Comparer>
+static inline int page_lower_bound(Page &page, Key key, Comparer &compare)
+{
+	return ::lower_bound(0, page.size(), [&](int id) {
+		return compare(page.get_key(id), key) < 0;
+	} );
+}
+
+/* keys of 4-byte columns lie in an array of 9-byte keys */
+template<bool Leaf>
+static inline int page_lower_bound(index_page<Leaf> &page, const char *key, fixed_key_comparer &compare)
+{
+	if(compare.size != scalar_key_size || page.variable())
+	{
+		return ::lower_bound(0, page.size(), [&](int id) {
+			return compare(page.get_key(id), key) < 0;
+		} );
+	}
+	return scalar_key_lower_bound(page.get_key(0), page.size(), key);
+}
+
+/* `key` is past the last key of the page and belongs to its right
+ * sibling, where a split moved it to */
+template<typename Page, typename Key, typename Comparer>
+static inline bool past_page(Page &page, Key key, Comparer &compare)
+{
+	return page.next_page() && page.size()
+		&& compare(page.get_key(page.size() - 1), key) < 0;
+}
 
 template<typename KeyType, typename Comparer, typename Copier>
 btree<KeyType, Comparer, Copier>::btree(
 		pager *pg, int root_page_id, int field_size,
 		Comparer compare, Copier copier)
-	: pg(pg), root_page_id(root_page_id),
-	  field_size(field_size), compare(compare), copy_to_temp(copier)
+	: pg(pg), root_page_id(root_page_id), field_size(field_size),
+	  last_leaf_pid(0), compare(compare), copy_to_temp(copier)
 {
+	for(auto &v : page_versions)
+		v = 0;
 	if(root_page_id == 0)
 	{
 		this->root_page_id = pg->new_page();
@@ -17,12 +62,12 @@ btree<KeyType, Comparer, Copier>::btree(
 
 template<typename KeyType, typename Comparer, typename Copier>
 template<typename Page>
-inline void btree<KeyType, Comparer, Copier>::insert_split_root(insert_ret ret)
+inline void btree<KeyType, Comparer, Copier>::insert_split_root(const insert_ret &ret)
 {
 	if(ret.split)
 	{
 		debug_puts("B-tree split root.");
-		int new_pid = pg->new_page();
+		int new_pid = pg->new_page(root_page_id);
 		interior_page page { pg->read_for_write(new_pid), pg };
 		page.init(field_size);
 
@@ -30,26 +75,162 @@ inline void btree<KeyType, Comparer, Copier>::insert_split_root(insert_ret ret)
 		Page upper { ret.upper_half, pg };
 		page.insert(0, lower.get_key(lower.size() - 1), root_page_id);
 		page.insert(1, upper.get_key(upper.size() - 1), ret.upper_pid);
+		// searches find the new root once it is filled
 		root_page_id = new_pid;
 	}
 }
 
+/* Find the leaf where `key` belongs, holding one latch at a time, and
+ * keep it latched, exclusively for a write. No page is made dirty, a
+ * write marks the leaf before it changes it. A search goes right past
+ * pages split meanwhile. A write follows the keys as the splits do.
+ * Either starts over if the version of a page changed between reading
+ * its id and latching it. False if the key is past the last key of a
+ * page with a right sibling, which a write must raise. */
+template<typename KeyType, typename Comparer, typename Copier>
+bool btree<KeyType, Comparer, Copier>::find_leaf(key_t key, bool for_write, leaf_ref &leaf)
+{
+	for(;;)
+	{
+		int pid = root_page_id;
+		unsigned version = page_version(pid);
+		bool in_bounds = true, at_root = true;
+		for(;;)
+		{
+			page_guard addr = pg->read(pid);
+			shared_latch latch(addr.latch());
+			if(page_version(pid) != version)
+				break;
+			// the root changes while the old one is latched
+			if(at_root && pid != root_page_id)
+				break;
+			at_root = false;
+
+			uint16_t magic = general_page::get_magic_number(addr.get());
+			if(is_interior(magic))
+			{
+				interior_page page { addr, pg };
+				if(!for_write && past_page(page, key, compare))
+				{
+					pid = page.next_page();
+					version = page_version(pid);
+					continue;
+				}
+
+				int ch_pos = page_lower_bound(page, key, compare);
+				if(ch_pos == page.size())
+				{
+					in_bounds = in_bounds && !page.next_page();
+					--ch_pos;
+				}
+				pid = page.get_child(ch_pos);
+				version = page_version(pid);
+				continue;
+			}
+
+			assert(is_leaf(magic));
+			exclusive_latch x_latch;
+			if(for_write)
+			{
+				latch.unlock();
+				x_latch = exclusive_latch(addr.latch());
+				if(page_version(pid) != version)
+					break;
+			}
+
+			leaf_page page { addr, pg };
+			if(!for_write && past_page(page, key, compare))
+			{
+				pid = page.next_page();
+				version = page_version(pid);
+				continue;
+			}
+
+			leaf.pid = pid;
+			leaf.guard = addr;
+			leaf.shared = std::move(latch);
+			leaf.exclusive = std::move(x_latch);
+			return in_bounds;
+		}
+	}
+}
+
+/* Append to the rightmost leaf if `key` is larger than all of the
+ * elements, which fits without a split, as for increasing row ids. */
+template<typename KeyType, typename Comparer, typename Copier>
+bool btree<KeyType, Comparer, Copier>::insert_append(
+		key_t key, const char *data, int data_size)
+{
+	int pid = last_leaf_pid;
+	if(!pid) return false;
+	unsigned version = page_version(pid);
+	// cleared before the leaf is freed, see `free_tree_page`
+	if(pid != last_leaf_pid)
+		return false;
+
+	// not written if the key goes elsewhere
+	page_guard addr = pg->read(pid);
+	exclusive_latch latch(addr.latch());
+	if(page_version(pid) != version)
+		return false;
+	leaf_page page { addr, pg };
+	if(page.next_page() || page.size() == 0
+		|| compare(page.get_key(page.size() - 1), key) >= 0)
+		return false;
+
+	if(!page.fits(data, data_size))
+		return false;
+	// before the change, a snapshot keeps the page as it was
+	addr.mark_dirty();
+	return page.insert(page.size(), data, data_size);
+}
+
+/* Insert into the leaf if it fits, no other page changes then */
+template<typename KeyType, typename Comparer, typename Copier>
+bool btree<KeyType, Comparer, Copier>::insert_in_leaf(
+		key_t key, const char *data, int data_size)
+{
+	leaf_ref leaf;
+	if(!find_leaf(key, true, leaf))
+		return false;
+	leaf_page page { leaf.guard, pg };
+	if(!page.fits(data, data_size))
+		return false;
+	leaf.guard.mark_dirty();
+	bool succ_ins = page.insert(page_lower_bound(page, key, compare), data, data_size);
+	assert(succ_ins);
+	UNUSED(succ_ins);
+	if(!page.next_page())
+		last_leaf_pid = leaf.pid;
+	return true;
+}
+
 template<typename KeyType, typename Comparer, typename Copier>
 void btree<KeyType, Comparer, Copier>::insert(
 		key_t key, const char *data, int data_size)
 {
-	char *addr = pg->read_for_write(root_page_id);
-	uint16_t magic = general_page::get_magic_number(addr);
-	if(magic == PAGE_FIXED)
+	if(insert_append(key, data, data_size) || insert_in_leaf(key, data, data_size))
+		return;
+
+	// the leaf is full or a key above is raised, split pages as needed
+	std::lock_guard<std::mutex> smo(smo_latch);
 	{
-		insert_ret ret = insert_interior(
-			root_page_id, addr, key, data, data_size);
-		insert_split_root<interior_page>(ret);
-	} else {
-		assert(magic == PAGE_VARIANT || magic == PAGE_INDEX_LEAF);
-		insert_ret ret = insert_leaf(
-			root_page_id, addr, key, data, data_size);
-		insert_split_root<leaf_page>(ret);
+		std::vector<exclusive_latch*> held;
+		int root = root_page_id;
+		page_guard addr = pg->read(root);
+		exclusive_latch latch(addr.latch());
+		uint16_t magic = general_page::get_magic_number(addr.get());
+		if(is_interior(magic))
+		{
+			insert_ret ret = insert_interior(
+				root, addr, latch, key, data, data_size, held);
+			insert_split_root<interior_page>(ret);
+		} else {
+			assert(is_leaf(magic));
+			insert_ret ret = insert_leaf(
+				root, addr, key, data, data_size);
+			insert_split_root<leaf_page>(ret);
+		}
 	}
 }
 
@@ -57,78 +238,97 @@ template<typename KeyType, typename Comparer, typename Copier>
 template<typename Page, typename ChPage>
 inline typename btree<KeyType, Comparer, Copier>::insert_ret
 btree<KeyType, Comparer, Copier>::insert_post_process(
-	int pid, int ch_pid, int ch_pos, insert_ret ch_ret)
+	Page page, ChPage ch_page, int pid, int ch_pos, const insert_ret &ch_ret)
 {
 	insert_ret ret;
 	ret.split = false;
-	Page page { pg->read_for_write(pid), pg };
+	page.guard.mark_dirty();
+	key_t ch_key = ch_page.get_key(ch_page.size() - 1);
+	key_t ch_largest = key_t();
 	if(ch_ret.split)
 	{
-		ChPage lower_ch { ch_ret.lower_half, pg };
 		ChPage upper_ch { ch_ret.upper_half, pg };
-		page.set_key(ch_pos, lower_ch.get_key(lower_ch.size() - 1));
-		key_t ch_largest = copy_to_temp(upper_ch.get_key(upper_ch.size() - 1));
-		bool succ_ins = page.insert(ch_pos + 1, ch_largest, ch_ret.upper_pid);
-		if(!succ_ins)
-		{
-			auto upper = page.split(pid);
-			Page upper_page = upper.second;
-			Page lower_page = page;
-			if(ch_pos < lower_page.size())
-			{
-				succ_ins = lower_page.insert(
-					ch_pos + 1, ch_largest, ch_ret.upper_pid);
-				assert(succ_ins);
-			} else {
-				succ_ins = upper_page.insert(
-					ch_pos - lower_page.size() + 1,
-					ch_largest, ch_ret.upper_pid
-				);
-				assert(succ_ins);
-			}
+		ch_largest = copy_to_temp(upper_ch.get_key(upper_ch.size() - 1));
+	}
 
-			ret.split = true;
-			ret.lower_half = lower_page.buf;
-			ret.upper_half = upper_page.buf;
-			ret.upper_pid  = upper.first;
-		}
-	} else {
-		ChPage ch_page { pg->read(ch_pid), pg };
-		page.set_key(ch_pos, ch_page.get_key(ch_page.size() - 1));
+	// a key going down gives elements to the next child
+	if(compare(ch_key, page.get_key(ch_pos)) < 0)
+		++page_version(page.get_child(ch_pos));
+	// a longer key may make the page full as well
+	bool key_set = page.try_set_key(ch_pos, ch_key);
+	if(key_set && (!ch_ret.split || page.insert(ch_pos + 1, ch_largest, ch_ret.upper_pid)))
+		return ret;
+
+	// the rightmost page grows at its end, mostly by appends
+	bool append = ch_ret.split && ch_pos == page.size() - 1 && !page.next_page();
+	auto upper = page.split(pid, append ? BTREE_APPEND_SPLIT_PERCENT : 50);
+	++page_version(pid);
+	Page upper_page = upper.second;
+	Page lower_page = page;
+	bool in_lower = ch_pos < lower_page.size();
+	Page &half = in_lower ? lower_page : upper_page;
+	int pos = in_lower ? ch_pos : ch_pos - lower_page.size();
+	if(!key_set)
+		half.set_key(pos, ch_key);
+	if(ch_ret.split)
+	{
+		bool succ_ins = half.insert(pos + 1, ch_largest, ch_ret.upper_pid);
+		assert(succ_ins);
+		UNUSED(succ_ins);
 	}
 
+	ret.split = true;
+	ret.lower_half = lower_page.guard;
+	ret.upper_half = upper_page.guard;
+	ret.upper_pid  = upper.first;
 	return ret;
 }
 
 template<typename KeyType, typename Comparer, typename Copier>
 typename btree<KeyType, Comparer, Copier>::insert_ret
 btree<KeyType, Comparer, Copier>::insert_interior(
-	int now, char* addr, key_t key, const char *data, int data_size)
+	int now, const page_guard &addr, exclusive_latch &latch,
+	key_t key, const char *data, int data_size, std::vector<exclusive_latch*> &held)
 {
 	interior_page page { addr, pg };
 
-	int ch_pos = ::lower_bound(0, page.size(), [&](int id) {
-		return compare(page.get_key(id), key) < 0;
-	} );
+	// the pages above are left alone if this one cannot split
+	if(page.safe_for_insert())
+	{
+		for(exclusive_latch *l : held)
+			l->unlock();
+		held.clear();
+	}
 
+	int ch_pos = page_lower_bound(page, key, compare);
+
+	// the last key is raised unless the page is the rightmost, so this
+	// page and the ones above, which it may split, are kept latched
+	if(ch_pos < page.size() || !page.next_page())
+		held.push_back(&latch);
+	else held.clear();
 	ch_pos = std::min(page.size() - 1, ch_pos);
 
 	int ch_pid = page.get_child(ch_pos);
-	char *ch_addr = pg->read_for_write(ch_pid);
-	uint16_t ch_magic = general_page::get_magic_number(ch_addr);
+	page_guard ch_addr = pg->read(ch_pid);
+	exclusive_latch ch_latch(ch_addr.latch());
+	uint16_t ch_magic = general_page::get_magic_number(ch_addr.get());
 
-	if(ch_magic == PAGE_FIXED)
+	if(is_interior(ch_magic))
 	{
-		auto ch_ret = insert_interior(ch_pid, ch_addr, key, data, data_size);
+		auto ch_ret = insert_interior(ch_pid, ch_addr, ch_latch, key, data, data_size, held);
+		// a page below cannot split, nor can the child
+		if(!latch.owns_lock())
+			return ch_ret;
 		return insert_post_process<interior_page, interior_page>(
-			now, ch_pid, ch_pos, ch_ret
+			page, { ch_addr, pg }, now, ch_pos, ch_ret
 		);
 	} else {
 		// leaf page
-		assert(ch_magic == PAGE_VARIANT || ch_magic == PAGE_INDEX_LEAF);
+		assert(is_leaf(ch_magic));
 		auto ch_ret = insert_leaf(ch_pid, ch_addr, key, data, data_size);
 		return insert_post_process<interior_page, leaf_page>(
-			now, ch_pid, ch_pos, ch_ret
+			page, { ch_addr, pg }, now, ch_pos, ch_ret
 		);
 	}
 }
@@ -136,13 +336,12 @@ btree<KeyType, Comparer, Copier>::insert_interior(
 template<typename KeyType, typename Comparer, typename Copier>
 typename btree<KeyType, Comparer, Copier>::insert_ret 
 btree<KeyType, Comparer, Copier>::insert_leaf(
-	int now, char* addr, key_t key, const char *data, int data_size)
+	int now, const page_guard &addr, key_t key, const char *data, int data_size)
 {
 	leaf_page page { addr, pg };
+	page.guard.mark_dirty();
 
-	int ch_pos = ::lower_bound(0, page.size(), [&](int id) {
-		return compare(page.get_key(id), key) < 0;
-	} );
+	int ch_pos = page_lower_bound(page, key, compare);
 
 	insert_ret ret;
 	ret.split = false;
@@ -154,7 +353,10 @@ btree<KeyType, Comparer, Copier>::insert_leaf(
 
 	if(!succ_ins)
 	{
-		auto upper = page.split(now);
+		// appended to the rightmost leaf, the lower page stays nearly full
+		bool append = ch_pos == page.size() && !page.next_page();
+		auto upper = page.split(now, append ? BTREE_APPEND_SPLIT_PERCENT : 50);
+		++page_version(now);
 
 		leaf_page upper_page = upper.second;
 		leaf_page lower_page = page;
@@ -170,9 +372,13 @@ btree<KeyType, Comparer, Copier>::insert_leaf(
 		}
 
 		ret.split = true;
-		ret.lower_half = lower_page.buf;
-		ret.upper_half = upper_page.buf;
+		ret.lower_half = lower_page.guard;
+		ret.upper_half = upper_page.guard;
 		ret.upper_pid  = upper.first;
+		if(!upper_page.next_page())
+			last_leaf_pid = upper.first;
+	} else if(!page.next_page()) {
+		last_leaf_pid = now;
 	}
 
 	return ret;
@@ -182,171 +388,333 @@ template<typename KeyType, typename Comparer, typename Copier>
 typename btree<KeyType, Comparer, Copier>::search_result 
 btree<KeyType, Comparer, Copier>::lower_bound(key_t key)
 {
-	return lower_bound(root_page_id, key);
+	leaf_ref leaf;
+	find_leaf(key, false, leaf);
+	leaf_page page { leaf.guard, pg };
+	int pos = page_lower_bound(page, key, compare);
+
+	// past the rightmost leaf, or an empty root
+	if(pos == page.size())
+		return { page.next_page(), 0 };
+	else return { leaf.pid, pos };
 }
 
 template<typename KeyType, typename Comparer, typename Copier>
-typename btree<KeyType, Comparer, Copier>::search_result
-btree<KeyType, Comparer, Copier>::lower_bound(int now, key_t key)
+bool btree<KeyType, Comparer, Copier>::find(
+	key_t key, const std::function<void(leaf_page&, int)> &visit)
 {
-	char *addr = pg->read_for_write(now);
-	uint16_t magic = general_page::get_magic_number(addr);
-	if(magic == PAGE_FIXED)
-	{
-		interior_page page { addr, pg };
-		int ch_pos = ::lower_bound(0, page.size(), [&](int id) {
-			return compare(page.get_key(id), key) < 0;
-		} );
-
-		ch_pos = std::min(page.size() - 1, ch_pos);
-		return lower_bound(page.get_child(ch_pos), key);
-	} else {
-		assert(magic == PAGE_VARIANT || magic == PAGE_INDEX_LEAF);
-		leaf_page page { addr, pg };
-		int pos = ::lower_bound(0, page.size(), [&](int id) {
-			return compare(page.get_key(id), key) < 0;
-		} );
-
-		if(pos == page.size())
-			return { 0, 0 };
-		else return { now, pos };
-	}
+	leaf_ref leaf;
+	find_leaf(key, false, leaf);
+	leaf_page page { leaf.guard, pg };
+	int pos = page_lower_bound(page, key, compare);
+	if(pos == page.size())
+		return false;
+	visit(page, pos);
+	return true;
 }
 
+/* The child at `ch_pos` underflows. Borrow an element from or merge
+ * with its sibling under the same parent, and fix the keys of both. */
 template<typename KeyType, typename Comparer, typename Copier>
 template<typename Page>
-typename btree<KeyType, Comparer, Copier>::merge_ret
-btree<KeyType, Comparer, Copier>::erase_try_merge(int pid, char *addr)
+void btree<KeyType, Comparer, Copier>::erase_rebalance(
+	interior_page &page, int ch_pos, const page_guard &ch_addr)
 {
-	Page page { addr, pg };
-
-	if(page.underflow())
+	if(page.size() == 1)
 	{
-		char *next_addr = nullptr, *prev_addr = nullptr;
-		if(page.next_page())
-		{
-			next_addr = pg->read(page.next_page());
-			Page next_page { next_addr, pg };
-			if(!next_page.underflow_if_remove(0))
-			{
-				pg->mark_dirty(page.next_page());
-				page.move_from(next_page, 0, page.size());
-				return { false, false, 0 };
-			}
-		}
-
-		if(page.prev_page())
-		{
-			prev_addr = pg->read(page.prev_page());
-			Page prev_page { prev_addr, pg };
-			if(!prev_page.underflow_if_remove(prev_page.size() - 1))
-			{
-				pg->mark_dirty(page.prev_page());
-				page.move_from(prev_page, prev_page.size() - 1, 0);
-				return { false, false, 0 };
-			}
-		}
+		// only the root may have one child
+		Page ch_page { ch_addr, pg };
+		if(ch_page.size())
+			page.try_set_key(ch_pos, ch_page.get_key(ch_page.size() - 1));
+		return;
+	}
 
-		if(next_addr)
-		{
-			int next_pid = page.next_page();
-			bool succ_merge = page.merge( { next_addr, pg }, pid);
-			UNUSED(succ_merge);
-			assert(succ_merge);
-			pg->free_page(next_pid);
-			return { false, true, pid };
-		} else if(prev_addr) {
-			int prev_pid = page.prev_page();
-			Page prev_page { prev_addr, pg };
-			bool succ_merge = prev_page.merge(page, prev_pid);
-			UNUSED(succ_merge);
-			assert(succ_merge);
-			pg->free_page(pid);
-			return { true, false, prev_pid };
-		}
-	} 
+	// rebalance the pair (lpos, lpos + 1)
+	bool left_is_child = ch_pos + 1 < page.size();
+	int lpos = left_is_child ? ch_pos : ch_pos - 1;
+	int lpid = page.get_child(lpos);
+	int rpid = page.get_child(lpos + 1);
+	page_guard sibling = pg->read_for_write(left_is_child ? rpid : lpid);
+	exclusive_latch sibling_latch(sibling.latch());
+	Page left  { left_is_child ? ch_addr : sibling, pg };
+	Page right { left_is_child ? sibling : ch_addr, pg };
+	++page_version(lpid);
+	++page_version(rpid);
+
+	/* The key of the left one must follow a borrowed element, or the
+	 * element is given back. The key of the right one bounds both of
+	 * them after a merge. Other keys are set if they fit. */
+	bool merged = false;
+	if(left_is_child && right.size() && !right.underflow_if_remove(0))
+	{
+		left.move_from(right, 0, left.size());
+		if(!page.try_set_key(lpos, left.get_key(left.size() - 1)))
+			right.move_from(left, left.size() - 1, 0);
+	} else if(!left_is_child && left.size() && !left.underflow_if_remove(left.size() - 1)) {
+		right.move_from(left, left.size() - 1, 0);
+		if(!page.try_set_key(lpos, left.get_key(left.size() - 1)))
+			left.move_from(right, 0, left.size());
+	} else if(left.merge(right, lpid)) {
+		free_tree_page(rpid);
+		page.set_child(lpos + 1, lpid);
+		page.erase(lpos);
+		merged = true;
+	}
 
-	return { false, false, 0 };
+	if(left.size())
+		page.try_set_key(lpos, left.get_key(left.size() - 1));
+	if(!merged && right.size())
+		page.try_set_key(lpos + 1, right.get_key(right.size() - 1));
 }
 
 template<typename KeyType, typename Comparer, typename Copier>
 typename btree<KeyType, Comparer, Copier>::erase_ret
-btree<KeyType, Comparer, Copier>::erase(int now, key_t key)
+btree<KeyType, Comparer, Copier>::erase(const page_guard &addr, key_t key)
 {
-	char *addr = pg->read_for_write(now);
-	uint16_t magic = general_page::get_magic_number(addr);
-	if(magic == PAGE_FIXED)
+	uint16_t magic = general_page::get_magic_number(addr.get());
+	if(is_interior(magic))
 	{
 		interior_page page { addr, pg };
-		int ch_pos = ::lower_bound(0, page.size(), [&](int id) {
-			return compare(page.get_key(id), key) < 0;
-		} );
+		int ch_pos = page_lower_bound(page, key, compare);
 
 		ch_pos = std::min(page.size() - 1, ch_pos);
-		erase_ret ret = erase(page.get_child(ch_pos), key);
+		int ch_pid = page.get_child(ch_pos);
+		page_guard ch_addr = pg->read(ch_pid);
+		exclusive_latch ch_latch(ch_addr.latch());
+		erase_ret ret = erase(ch_addr, key);
 
 		if(!ret.found) return ret;
+		page.guard.mark_dirty();
+		// its key below may go down
+		++page_version(ch_pid);
 
-		addr = pg->read_for_write(now);
-		page = interior_page { addr, pg };
-		if(ret.merged_right)
+		uint16_t ch_magic = general_page::get_magic_number(ch_addr.get());
+		if(is_interior(ch_magic))
 		{
-			page.erase(ch_pos + 1);
-			page.set_key(ch_pos, ret.largest);
-			page.set_child(ch_pos, ret.merged_pid);
-		} else if(ret.merged_left) {
-			page.erase(ch_pos);
-			page.set_key(ch_pos - 1, ret.largest);
-			page.set_child(ch_pos - 1, ret.merged_pid);
+			if(ret.underflow)
+			{
+				erase_rebalance<interior_page>(page, ch_pos, ch_addr);
+			} else {
+				interior_page ch_page { ch_addr, pg };
+				page.try_set_key(ch_pos, ch_page.get_key(ch_page.size() - 1));
+			}
 		} else {
-			page.set_key(ch_pos, ret.largest);
+			if(ret.underflow)
+			{
+				erase_rebalance<leaf_page>(page, ch_pos, ch_addr);
+			} else {
+				leaf_page ch_page { ch_addr, pg };
+				page.try_set_key(ch_pos, ch_page.get_key(ch_page.size() - 1));
+			}
 		}
 
-		merge_ret mret = erase_try_merge<interior_page>(now, addr);
-		return { true, mret.merged_left, mret.merged_right,
-			mret.merged_pid, copy_to_temp(page.get_key(page.size() - 1)) };
+		return { true, page.underflow() };
 	} else {
-		assert(magic == PAGE_VARIANT || magic == PAGE_INDEX_LEAF);
+		assert(is_leaf(magic));
 		leaf_page page { addr, pg };
-		int pos = ::lower_bound(0, page.size(), [&](int id) {
-			return compare(page.get_key(id), key) < 0;
-		} );
+		int pos = page_lower_bound(page, key, compare);
 
 		if(pos == page.size() || compare(page.get_key(pos), key) != 0)
-			return { false, false, false, 0, 0};
+			return { false, false };
 
+		page.guard.mark_dirty();
 		page.erase(pos);
-		auto ret = erase_try_merge<leaf_page>(now, addr);
-
-		return { true, ret.merged_left, ret.merged_right, ret.merged_pid,
-			now == root_page_id ? 0 : copy_to_temp(page.get_key(page.size() - 1)) };
+		return { true, page.underflow() };
 	}
 }
 
+/* Erase from the leaf if it does not underflow, no other page changes
+ * then. `underflow` if the element is found but left to a rebalance. */
+template<typename KeyType, typename Comparer, typename Copier>
+typename btree<KeyType, Comparer, Copier>::erase_ret
+btree<KeyType, Comparer, Copier>::erase_in_leaf(key_t key)
+{
+	leaf_ref leaf;
+	// a key past the last one of a page is not there
+	find_leaf(key, true, leaf);
+	leaf_page page { leaf.guard, pg };
+	int pos = page_lower_bound(page, key, compare);
+	if(pos == page.size() || compare(page.get_key(pos), key) != 0)
+		return { false, false };
+
+	// the root may underflow
+	if(leaf.pid != root_page_id && page.underflow_if_remove(pos))
+		return { true, true };
+	// found and removed here, an erase does not fail
+	leaf.guard.mark_dirty();
+	page.erase(pos);
+	return { true, false };
+}
+
 template<typename KeyType, typename Comparer, typename Copier>
 bool btree<KeyType, Comparer, Copier>::erase(key_t key)
 {
-	erase_ret ret = erase(root_page_id, key);
+	erase_ret in_leaf = erase_in_leaf(key);
+	if(!in_leaf.found || !in_leaf.underflow)
+		return in_leaf.found;
 
-	char *addr = pg->read_for_write(root_page_id);
-	uint16_t magic = general_page::get_magic_number(addr);
-	if(magic == PAGE_FIXED)
+	// rebalancing moves elements left and frees pages
+	std::lock_guard<std::mutex> smo(smo_latch);
+	erase_ret ret;
 	{
-		interior_page page { addr, pg };
-		if(page.size() == 1 && page.get_child(0))
+		int root = root_page_id;
+		page_guard addr = pg->read(root);
+		exclusive_latch latch(addr.latch());
+		ret = erase(addr, key);
+
+		uint16_t magic = general_page::get_magic_number(addr.get());
+		if(is_interior(magic))
 		{
-			debug_puts("B-tree merge root.");
-			pg->free_page(root_page_id);
-			root_page_id = page.get_child(0);
+			interior_page page { addr, pg };
+			if(page.size() == 1 && page.get_child(0))
+			{
+				debug_puts("B-tree merge root.");
+				int child = page.get_child(0);
+				root_page_id = child;
+				free_tree_page(root);
+			}
 		}
 	}
 
 	return ret.found;
 }
 
+/* Free a page which is latched exclusively, with its parent if any.
+ * Whoever read its id before finds its version changed. */
+template<typename KeyType, typename Comparer, typename Copier>
+void btree<KeyType, Comparer, Copier>::free_tree_page(int pid)
+{
+	// set again only by a write holding the leaf's latch
+	int last = pid;
+	last_leaf_pid.compare_exchange_strong(last, 0);
+	++page_version(pid);
+	pg->free_page(pid);
+}
+
 /* Explicitly instantiate templates */
 template class btree<int, int(*)(int, int), int(*)(int)>;
-template class btree<const char*,
-		 index_btree::comparer_t,
-		 __impl::index_btree_copier_t
-	 >;
+template class btree<const char*, fixed_key_comparer, __impl::index_btree_copier_t>;
+template class btree<const char*, variable_key_comparer, __impl::index_btree_copier_t>;
+
+namespace
+{
+	/* One level of a bulk-loaded b-tree, whose pages are filled from
+	 * left to right up to `budget` bytes. The keys of a page are
+	 * gathered before it is written, as inserting a key of a fixed size
+	 * moves all the keys each time. Keys are kept `stride` bytes apart. */
+	template<typename Page>
+	struct bulk_level
+	{
+		pager *pg;
+		int field_size, stride, budget, first_pid, batch_size;
+		std::vector<int> pages;
+		std::vector<char> keys, last_keys;  // the largest key of each page
+		std::vector<int> children;
+
+		bulk_level(pager *pg, int field_size, int budget, int first_pid = 0)
+			: pg(pg), field_size(field_size), stride(field_size & ~Page::variable_keys),
+			  budget(budget), first_pid(first_pid), batch_size(0) {}
+
+		void push(const char *key, int child)
+		{
+			int entry_size = Page::entry_size(key, field_size);
+			if(children.size() >= 2 && batch_size + entry_size > budget)
+				flush();
+			batch_size += entry_size;
+			size_t end = keys.size();
+			keys.resize(end + stride);
+			std::memcpy(&keys[end], key, Page::key_size(key, field_size));
+			children.push_back(child);
+		}
+
+		void flush()
+		{
+			int prev_pid = pages.empty() ? 0 : pages.back();
+			int pid = first_pid && !prev_pid ? first_pid : pg->new_page(prev_pid);
+			Page page { pg->read_for_write(pid), pg };
+			page.init(field_size);
+			page.assign((int)children.size(), keys.data(), stride, children.data());
+			if(prev_pid)
+			{
+				Page prev { pg->read_for_write(prev_pid), pg };
+				prev.next_page_ref() = pid;
+				page.prev_page_ref() = prev_pid;
+			}
+
+			pages.push_back(pid);
+			last_keys.insert(last_keys.end(), keys.end() - stride, keys.end());
+			keys.clear();
+			children.clear();
+			batch_size = 0;
+		}
+
+		/* write the last page and fill it at least by half, borrowing
+		 * from or merging into its left neighbour */
+		void finish()
+		{
+			if(children.empty()) return;
+			flush();
+			if(pages.size() < 2) return;
+
+			int lpid = pages[pages.size() - 2], rpid = pages.back();
+			Page left { pg->read_for_write(lpid), pg };
+			Page right { pg->read_for_write(rpid), pg };
+			if(!right.underflow()) return;
+			bool merged = left.merge(right, lpid);
+			if(merged)
+			{
+				pg->free_page(rpid);
+				pages.pop_back();
+			} else {
+				while(right.underflow())
+					right.move_from(left, left.size() - 1, 0);
+			}
+
+			// the largest keys of both pages changed
+			last_keys.resize(last_keys.size() - 2 * stride);
+			for(Page *page : { &left, &right })
+			{
+				if(merged && page == &right) break;
+				const char *key = page->get_key(page->size() - 1);
+				size_t end = last_keys.size();
+				last_keys.resize(end + stride);
+				std::memcpy(&last_keys[end], key, Page::key_size(key, field_size));
+			}
+		}
+	};
+}
+
+template<typename Comparer>
+void index_btree<Comparer>::bulk_load(const std::function<const char*()> &next, int fill_percent)
+{
+	int usable;
+	{
+		leaf_page root { pg->read(root_page_id), pg };
+		assert(root.empty());
+		usable = leaf_page::usable_size(root.page_size, field_size);
+	}
+
+	int budget = std::max(usable * fill_percent / 100, usable / 2);
+	bulk_level<leaf_page> leaves { pg, field_size, budget, root_page_id };
+	while(const char *key = next())
+		leaves.push(key, index_key::rid(key, leaf_page::key_size(key, field_size)));
+	leaves.finish();
+
+	std::vector<int> pages = std::move(leaves.pages);
+	std::vector<char> last_keys = std::move(leaves.last_keys);
+	while(pages.size() > 1)
+	{
+		bulk_level<interior_page> upper { pg, field_size, budget };
+		for(size_t i = 0; i != pages.size(); ++i)
+			upper.push(&last_keys[i * upper.stride], pages[i]);
+		upper.finish();
+		pages = std::move(upper.pages);
+		last_keys = std::move(upper.last_keys);
+	}
+
+	if(!pages.empty())
+		root_page_id = pages[0];
+}
+
+template class index_btree<fixed_key_comparer>;
+template class index_btree<variable_key_comparer>;
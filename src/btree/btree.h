@@ -5,28 +5,67 @@
 #include "../page/pager.h"
 #include "../page/fixed_page.h"
 #include "../page/data_page.h"
-#include "../page/index_leaf_page.h"
+#include "../page/index_page.h"
+#include "index_key.h"
+#include <atomic>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <type_traits>
+#include <vector>
 
 /* Each node of the b-tree is a page.
  * For an interior node, the key of a page element is the largest
- * element of its children. */
+ * element of its children. An erase which changes only the leaf, or a
+ * variable-length key which would not fit after an erase, leaves a key
+ * as it was, then it is only an upper bound, still less than the
+ * elements of the next child. The last key of the rightmost pages may
+ * be less than the elements appended to the rightmost leaf, as a search
+ * past it goes to the last child anyway.
+ *
+ * Threads may insert, erase and search at the same time, each page is
+ * guarded by the latch of its frame (B-link tree):
+ *  - A page has a version, which changes when it splits, when elements
+ *    move between it and its sibling, when it is freed and when its key
+ *    in the parent goes down, all under its latch and its parent's. A
+ *    search takes the version of the next page with the page pointing
+ *    to it latched, and starts over if it changed by the time the next
+ *    page is latched (`page_version`).
+ *  - A search holds one latch at a time. A page split meanwhile only
+ *    moves elements to its right sibling, so a search past the last key
+ *    of a page which has a right sibling goes on there.
+ *  - An insert or erase which fits in the leaf changes only the leaf.
+ *    It follows the keys as a split would.
+ *  - Other inserts, and those past the last key of a page which is not
+ *    the rightmost, latch the path from the root down, letting the
+ *    pages above one which cannot split go on the way (lock coupling).
+ *  - Other erases latch the path from the root down, move elements
+ *    left and free pages.
+ * Iterators and bulk loading are not safe against concurrent writes. */
 
 template<typename KeyType, typename Comparer, typename Copier>
 class btree
 {
+protected:
 	pager *pg;
-	int root_page_id, field_size;
+	std::atomic<int> root_page_id;
+	int field_size;
+	std::atomic<int> last_leaf_pid;  // the rightmost leaf, 0 if not known
 	Comparer compare;
 	Copier copy_to_temp;
+	std::mutex smo_latch;  // splits and merges, one at a time
+	// versions of the pages, striped by page id
+	std::atomic<unsigned> page_versions[BTREE_PAGE_VERSIONS];
 public:
 	typedef KeyType key_t;
-	typedef fixed_page<key_t> interior_page;
 	typedef typename std::conditional<
 		std::is_same<KeyType, const char*>::value,
-		index_leaf_page<key_t>,
+		index_page<false>,
+		fixed_page<key_t>>::type interior_page;
+	typedef typename std::conditional<
+		std::is_same<KeyType, const char*>::value,
+		index_page<true>,
 		data_page<key_t>>::type leaf_page;
 	typedef std::pair<int, int> search_result;  // (page_id, pos)
 public:
@@ -40,41 +79,55 @@ public:
 	bool erase(key_t key);
 	// the first element x for which x >= key
 	search_result lower_bound(key_t key);
+	/* Call `visit` with the leaf of the first element x for which
+	 * x >= key and its position, while the leaf is latched. False if
+	 * there is no such element. */
+	bool find(key_t key, const std::function<void(leaf_page&, int)> &visit);
 
 	int get_root_page_id() { return root_page_id; }
 
 private:
+	typedef std::shared_lock<std::shared_mutex> shared_latch;
+	typedef std::unique_lock<std::shared_mutex> exclusive_latch;
+
 	struct insert_ret
 	{
 		bool split;
 		int upper_pid;
-		char *lower_half, *upper_half;
+		page_guard lower_half, upper_half;
 	};
 
-	struct erase_ret
+	// a leaf found by `find_leaf`, latched exclusively for a write
+	struct leaf_ref
 	{
-		bool found;
-		bool merged_left, merged_right;
-		int merged_pid;
-		key_t largest;
+		int pid;
+		page_guard guard;
+		shared_latch shared;
+		exclusive_latch exclusive;
 	};
 
-	struct merge_ret
+	struct erase_ret
 	{
-		bool merged_left, merged_right;
-		int merged_pid;
+		bool found;
+		bool underflow;
 	};
 
 	template<typename Page, typename ChPage>
-	insert_ret insert_post_process(int, int, int, insert_ret);
+	insert_ret insert_post_process(Page, ChPage, int, int, const insert_ret&);
 	template<typename Page>
-	void insert_split_root(insert_ret);
-	insert_ret insert_interior(int, char*, key_t, const char*, int);
-	insert_ret insert_leaf(int, char*, key_t, const char*, int);
-	search_result lower_bound(int now, key_t key);
-	erase_ret erase(int, key_t);
+	void insert_split_root(const insert_ret&);
+	bool insert_append(key_t, const char*, int);
+	bool insert_in_leaf(key_t, const char*, int);
+	insert_ret insert_interior(int, const page_guard&, exclusive_latch&,
+		key_t, const char*, int, std::vector<exclusive_latch*>&);
+	insert_ret insert_leaf(int, const page_guard&, key_t, const char*, int);
+	bool find_leaf(key_t key, bool for_write, leaf_ref &leaf);
+	std::atomic<unsigned>& page_version(int pid) { return page_versions[(unsigned)pid % BTREE_PAGE_VERSIONS]; }
+	void free_tree_page(int pid);
+	erase_ret erase_in_leaf(key_t);
+	erase_ret erase(const page_guard&, key_t);
 	template<typename Page>
-	merge_ret erase_try_merge(int pid, char *addr);
+	void erase_rebalance(interior_page&, int, const page_guard&);
 };
 
 class int_btree : public btree<int, int(*)(int, int), int(*)(int)>
@@ -97,45 +150,55 @@ namespace __impl
 
 	struct index_btree_copier_t
 	{
-		int size;
+		int field_size;
 		std::shared_ptr<char> buf;
 	public:
-		index_btree_copier_t(int size)
-			: size(size),
-			  buf(new char[size], array_deleter<char>()) {}
+		index_btree_copier_t(int field_size)
+			: field_size(field_size),
+			  buf(new char[field_size & ~index_page<true>::variable_keys], array_deleter<char>()) {}
 
 		char *operator () (const char *src)
 		{
-			std::memcpy(buf.get(), src, size);
+			std::memcpy(buf.get(), src, index_page<true>::key_size(src, field_size));
 			return buf.get();
 		}
 	};
 }
 
-class index_btree : public btree<const char*,
-	std::function<int(const char*, const char*)>,
-	__impl::index_btree_copier_t>
+/* An index b-tree whose keys are ordered by `Comparer`, one of those
+ * of `index_key.h`, made from the field size. */
+template<typename Comparer>
+class index_btree : public btree<const char*, Comparer, __impl::index_btree_copier_t>
 {
-	typedef std::function<int(const char*, const char*)> comparer_t;
-	typedef btree<const char*, comparer_t,
+	typedef btree<const char*, Comparer,
 		__impl::index_btree_copier_t> base_class;
+	using base_class::pg;
+	using base_class::root_page_id;
+	using base_class::field_size;
 public:
-	index_btree(pager *pg,
-			int root_page_id,
-			int size,
-			comparer_t comparer
-		) : btree(
+	typedef typename base_class::leaf_page leaf_page;
+	typedef typename base_class::interior_page interior_page;
+
+	/* keys of `field_size` bytes, or-ed with `leaf_page::variable_keys`
+	 * for keys which take their actual length */
+	index_btree(pager *pg, int root_page_id, int field_size)
+		: base_class(
 			pg,
 			root_page_id,
-			size,
-			comparer,
-			__impl::index_btree_copier_t(size)
+			field_size,
+			Comparer(field_size),
+			__impl::index_btree_copier_t(field_size)
 		) {}
 
 	void insert(const char* key, int rid)
 	{
 		base_class::insert(key, key, rid);
 	}
+
+	/* Build an empty tree bottom up from keys given in ascending order
+	 * by `next`, which returns nullptr at the end. Pages are filled to
+	 * `fill_percent` (50 to 100) of their capacity. */
+	void bulk_load(const std::function<const char*()> &next, int fill_percent);
 };
 
 #endif
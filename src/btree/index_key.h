@@ -0,0 +1,192 @@
+#ifndef __TRIVIALDB_INDEX_KEY__
+#define __TRIVIALDB_INDEX_KEY__
+
+#include <cstring>
+#include <stdint.h>
+#ifdef _MSC_VER
+#include <stdlib.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+/* A key of an index is [nullmark, data, rid], encoded so that keys are
+ * ordered as byte strings, by their data with NULL first, then by the
+ * rid. The nullmark is 0 for NULL, whose data is all 0 or, for a string,
+ * empty. Ints are big-endian with the sign bit flipped, floats are their
+ * IEEE bits with the sign bit flipped, or all of them if negative, and
+ * strings end with a 0. A key is never a prefix of another one. */
+namespace index_key
+{
+	inline void encode_uint(char *dest, uint32_t x)
+	{
+		dest[0] = (char)(x >> 24);
+		dest[1] = (char)(x >> 16);
+		dest[2] = (char)(x >> 8);
+		dest[3] = (char)x;
+	}
+
+	inline uint32_t decode_uint(const char *src)
+	{
+		const unsigned char *s = (const unsigned char*)src;
+		return (uint32_t)s[0] << 24 | (uint32_t)s[1] << 16 | (uint32_t)s[2] << 8 | s[3];
+	}
+
+	inline void encode_int(char *dest, int x)
+	{
+		encode_uint(dest, (uint32_t)x ^ 0x80000000u);
+	}
+
+	inline int decode_int(const char *src)
+	{
+		return (int)(decode_uint(src) ^ 0x80000000u);
+	}
+
+	/* the first 8 bytes at `src` as a big-endian word */
+	inline uint64_t decode_word(const char *src)
+	{
+#if defined(_MSC_VER)
+		uint64_t x;
+		std::memcpy(&x, src, sizeof(x));
+		return _byteswap_uint64(x);
+#elif defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		uint64_t x;
+		std::memcpy(&x, src, sizeof(x));
+		return __builtin_bswap64(x);
+#else
+		return (uint64_t)decode_uint(src) << 32 | decode_uint(src + 4);
+#endif
+	}
+
+	inline void encode_float(char *dest, float x)
+	{
+		if(x == 0) x = 0;  // -0 equals 0
+		uint32_t bits;
+		std::memcpy(&bits, &x, sizeof(bits));
+		encode_uint(dest, bits ^ (bits >> 31 ? 0xffffffffu : 0x80000000u));
+	}
+
+	// the rid of a key of `size` bytes
+	inline int rid(const char *key, int size)
+	{
+		return decode_int(key + size - sizeof(int));
+	}
+}
+
+/* Keys of a column of 4 bytes (INT, DATE, FLOAT) are 9 bytes, the
+ * first 8 of which are compared at once as a big-endian word. */
+static constexpr int scalar_key_size = 1 + 4 + sizeof(int);
+
+/* keys of `size` bytes */
+struct fixed_key_comparer
+{
+	int size;
+	fixed_key_comparer(int field_size) : size(field_size) {}
+
+	int operator () (const char *a, const char *b) const
+	{
+		if(size != scalar_key_size)
+			return std::memcmp(a, b, size);
+		uint64_t x = index_key::decode_word(a), y = index_key::decode_word(b);
+		if(x != y)
+			return x < y ? -1 : 1;
+		return (unsigned char)a[8] - (unsigned char)b[8];
+	}
+};
+
+namespace index_key
+{
+	/* how many of the 4 keys of `scalar_key_size` bytes at `k`, `stride`
+	 * bytes apart, are less than the key of `word` and `last` byte */
+	inline int count_less4(const char *k, int stride, uint64_t word, int last)
+	{
+#ifdef __AVX2__
+		// the words are loaded as they are and their bytes reversed
+		const __m256i reverse = _mm256_setr_epi8(
+			7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+			7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+		// the words are unsigned, the compare is signed
+		const __m256i flip = _mm256_set1_epi64x(INT64_MIN);
+		long long w0, w1, w2, w3;
+		std::memcpy(&w0, k, sizeof(w0));
+		std::memcpy(&w1, k + stride, sizeof(w1));
+		std::memcpy(&w2, k + 2 * stride, sizeof(w2));
+		std::memcpy(&w3, k + 3 * stride, sizeof(w3));
+		__m256i w = _mm256_xor_si256(
+			_mm256_shuffle_epi8(_mm256_setr_epi64x(w0, w1, w2, w3), reverse), flip);
+		__m256i b = _mm256_setr_epi64x((unsigned char)k[8], (unsigned char)k[stride + 8],
+			(unsigned char)k[2 * stride + 8], (unsigned char)k[3 * stride + 8]);
+		__m256i word4 = _mm256_set1_epi64x((long long)(word ^ (1ull << 63)));
+		__m256i last4 = _mm256_set1_epi64x(last);
+		__m256i lt = _mm256_or_si256(_mm256_cmpgt_epi64(word4, w),
+			_mm256_and_si256(_mm256_cmpeq_epi64(word4, w), _mm256_cmpgt_epi64(last4, b)));
+		int mask = _mm256_movemask_pd(_mm256_castsi256_pd(lt));
+		return (mask & 1) + (mask >> 1 & 1) + (mask >> 2 & 1) + (mask >> 3);
+#else
+		int count = 0;
+		for(int i = 0; i != 4; ++i, k += stride)
+		{
+			uint64_t w = decode_word(k);
+			count += (w < word) | ((w == word) & ((unsigned char)k[8] < last));
+		}
+		return count;
+#endif
+	}
+}
+
+/* The first of the `n` keys of `scalar_key_size` bytes at `keys`, in
+ * ascending order, which is not less than `key`. Each step compares
+ * the key with 4 keys at once, dividing the range by 5, down to a few
+ * keys which are counted. The compares are vectorized with AVX2. */
+inline int scalar_key_lower_bound(const char *keys, int n, const char *key)
+{
+	const int stride = scalar_key_size;
+	uint64_t word = index_key::decode_word(key);
+	int last = (unsigned char)key[8];
+
+	int base = 0;
+	while(n > 16)
+	{
+		// the key lies after `c` of the steps
+		int step = (n + 4) / 5;
+		int c = index_key::count_less4(keys + (base + step) * stride, step * stride, word, last);
+		base += c * step;
+		n = c == 4 ? n - 4 * step : step;
+	}
+
+	const char *k = keys + base * stride;
+	int count = 0, i = 0;
+	for(; i + 4 <= n; i += 4)
+		count += index_key::count_less4(k + i * stride, stride, word, last);
+	for(; i != n; ++i)
+	{
+		uint64_t w = index_key::decode_word(k + i * stride);
+		count += (w < word) | ((w == word) & ((unsigned char)k[i * stride + 8] < last));
+	}
+
+	return base + count;
+}
+
+/* keys of a string column, compared as by memcmp, the string by strcmp
+ * as it ends with the first 0 */
+struct variable_key_comparer
+{
+	variable_key_comparer(int) {}
+
+	int operator () (const char *a, const char *b) const
+	{
+		if(a[0] != b[0])
+			return (unsigned char)a[0] - (unsigned char)b[0];
+		int offset = 1;
+		if(a[0])
+		{
+			int r = std::strcmp(a + 1, b + 1);
+			if(r != 0) return r;
+			offset += std::strlen(a + 1) + 1;
+		}
+
+		return std::memcmp(a + offset, b + offset, sizeof(int));
+	}
+};
+
+#endif
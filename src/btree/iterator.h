@@ -3,7 +3,11 @@
 
 #include "btree.h"
 #include "../defs.h"
+#include "../fs/page_fs.h"
+#include "../page/variant_page.h"
+#include <algorithm>
 #include <utility>
+#include <vector>
 
 template<typename PageType>
 class btree_iterator
@@ -13,23 +17,83 @@ private:
 	int pid, pos;
 	int cur_size, prev_pid, next_pid;
 
-	void load_info(int p)
+	/* readahead: number of consecutive steps to a page a little further
+	 * in the file, the last window and the first page not read ahead */
+	int seq_steps, ra_window, ra_next;
+
+	void load_info(int p, bool forward = false)
 	{
+		bool seq = forward && p > pid && p - pid <= PAGE_READAHEAD_MIN;
+		seq_steps = seq ? seq_steps + 1 : 0;
 		pid = p;
 		if(p)
 		{
 			PageType page { pg->read(p), pg };
-			assert(page.magic() == PAGE_VARIANT || page.magic() == PAGE_INDEX_LEAF);
+			assert(page.magic() == PAGE_VARIANT || page.magic() == PAGE_INDEX_LEAF
+				|| page.magic() == PAGE_KEY_LEAF);
 			cur_size = page.size();
 			next_pid = page.next_page();
 			prev_pid = page.prev_page();
+			if(forward) readahead(page);
+		}
+	}
+
+	/* Leaves written in key order lie one after another in the file,
+	 * with the overflow pages of their records in between. Once the
+	 * scan is found to walk through the file sequentially, read the
+	 * following pages ahead, doubling the window each time up to the
+	 * configured size. Otherwise only the next leaf is read ahead. */
+	void readahead(PageType &page)
+	{
+		int max_window = page_fs::get_instance()->get_readahead();
+		if(!max_window) return;
+
+		if(seq_steps >= PAGE_READAHEAD_TRIGGER)
+		{
+			if(ra_next <= pid)
+			{
+				ra_next = pid + 1;
+				ra_window = 0;
+			}
+
+			// start the next window when half of the last one is used
+			if(ra_next - pid - 1 <= ra_window / 2)
+			{
+				int window = ra_window ? ra_window * 2 : PAGE_READAHEAD_MIN;
+				window = std::min(window, max_window);
+				int ids[PAGE_READAHEAD_MAX_WINDOW];
+				for(int i = 0; i != window; ++i)
+					ids[i] = ra_next + i;
+				pg->prefetch(ids, window);
+				ra_next += window;
+				ra_window = window;
+			}
+		} else {
+			ra_next = 0;
+			if(next_pid) pg->prefetch(&next_pid, 1);
+
+			if(page.magic() == PAGE_VARIANT)
+			{
+				// overflow pages of the records in this leaf
+				variant_page vp { page.guard, pg };
+				std::vector<int> ids;
+				for(int i = 0; i != vp.size(); ++i)
+				{
+					int ov_page = vp.get_block(i).first.ov_page;
+					if(ov_page) ids.push_back(ov_page);
+				}
+				if(!ids.empty()) pg->prefetch(ids.data(), (int)ids.size());
+			}
 		}
 	}
 public:
 	typedef std::pair<int, int> value_t;
 public:
 	btree_iterator(pager *pg, int pid, int pos)
-		: pg(pg), pid(pid), pos(pos) { load_info(pid); }
+		: pg(pg), pid(pid), pos(pos), seq_steps(0), ra_window(0), ra_next(0)
+	{
+		load_info(pid);
+	}
 
 	btree_iterator(pager *pg, value_t p)
 		: btree_iterator(pg, p.first, p.second) {}
@@ -42,7 +106,7 @@ public:
 		assert(pid);
 		if(++pos == cur_size)
 		{
-			load_info(next_pid);
+			load_info(next_pid, true);
 			pos = 0;
 		}
 
@@ -31,30 +31,81 @@ database::~database()
 	if(is_opened()) close();
 }
 
+inline bool file_exists(const std::string &filename) {
+	struct stat st;
+	return stat(filename.c_str(), &st) == 0;
+}
+
 void database::open(const char *db_name)
 {
 	assert(!is_opened());
 	ensure_database_folder();
-	std::string filename = get_db_file_path(db_name);
-	filename += ".database";
-	std::ifstream ifs(filename, std::ios::binary);
-	ifs.read((char*)&info, sizeof(info));
+	// older files end before `page_size`
+	std::memset(&info, 0, sizeof(info));
+	std::string space_file = get_db_file_path(db_name) + ".tablespace";
+	if(file_exists(space_file))
+	{
+		space = std::make_shared<pager>(space_file.c_str());
+		if(!space->read_overflow(TABLESPACE_CATALOG_PAGE, &info, sizeof(info)))
+			std::fprintf(stderr, "[Error] fail to read the catalog of %s.\n", space_file.c_str());
+	} else {
+		std::string filename = get_db_file_path(db_name);
+		filename += ".database";
+		std::ifstream ifs(filename, std::ios::binary);
+		ifs.read((char*)&info, sizeof(info));
+	}
+	saved_info = info;
 	std::memset(tables, 0, sizeof(tables));
 	for(int i = 0; i < info.table_num; ++i)
 	{
 		tables[i] = new table_manager;
-		tables[i]->open(info.table_name[i]);
+		tables[i]->open(info.table_name[i], space, info.header_page[i]);
 	}
 	opened = true;
 }
 
-void database::create(const char *db_name)
+bool database::create(const char *db_name, int page_size, bool tablespace)
 {
 	assert(!is_opened());
+	ensure_database_folder();
+	std::string path = get_db_file_path(db_name);
+	if(file_exists(path + ".tablespace") || file_exists(path + ".database"))
+	{
+		std::fprintf(stderr, "[Error] database `%s` already exists.\n", db_name);
+		return false;
+	}
+
 	std::memset(&info, 0, sizeof(info));
+	std::memset(&saved_info, 0, sizeof(saved_info));
 	std::memset(tables, 0, sizeof(tables));
 	std::strncpy(info.db_name, db_name, MAX_NAME_LEN);
+	info.page_size = page_size;
+	info.tablespace = tablespace;
+	if(tablespace)
+	{
+		std::string space_file = path + ".tablespace";
+		space = std::make_shared<pager>(space_file.c_str(), page_size);
+		// the first page of the new file
+		if(space->write_overflow(0, &info, sizeof(info)) != TABLESPACE_CATALOG_PAGE)
+		{
+			std::fprintf(stderr, "[Error] fail to create %s.\n", space_file.c_str());
+			space.reset();
+			return false;
+		}
+	}
 	opened = true;
+	return true;
+}
+
+/* write the info where it is kept, the .database file or the catalog of
+ * the tablespace */
+bool database::write_info()
+{
+	if(space)
+		return space->write_overflow(TABLESPACE_CATALOG_PAGE, &info, sizeof(info)) == TABLESPACE_CATALOG_PAGE;
+	std::string filename = get_db_file_path(info.db_name);
+	filename += ".database";
+	return page_fs::get_instance()->write_file(filename.c_str(), &info, sizeof(info));
 }
 
 void database::close()
@@ -70,13 +121,64 @@ void database::close()
 		}
 	}
 
-	std::string filename = get_db_file_path(info.db_name);
-	filename += ".database";
-	std::ofstream ofs(filename, std::ios::binary);
-	ofs.write((char*)&info, sizeof(info));
+	write_info();
+	if(space)
+	{
+		space->close();
+		space = nullptr;
+	}
 	opened = false;
 }
 
+void database::commit()
+{
+	if(!is_opened() || !page_fs::get_instance()->is_logging())
+		return;
+	for(int i = 0; i != info.table_num; ++i)
+	{
+		if(tables[i]) tables[i]->commit();
+	}
+
+	if(std::memcmp(&info, &saved_info, sizeof(info)) == 0)
+		return;
+	saved_info = info;
+	write_info();
+}
+
+bool database::begin_backup(const char *dir, std::vector<std::pair<int, std::string>> &data_files)
+{
+	assert(is_opened());
+	std::vector<int> file_ids;
+	data_files.clear();
+	for(int i = 0; i != info.table_num; ++i)
+	{
+		int fid = tables[i]->backup_header(dir);
+		if(!fid) return false;
+		if(space) continue;
+		file_ids.push_back(fid);
+		data_files.push_back({ fid, std::string(dir) + "/" + info.table_name[i] + ".tdata" });
+	}
+
+	// the headers and the catalog are pages of the tablespace
+	if(space)
+	{
+		if(!write_info())
+			return false;
+		file_ids.push_back(space->get_fid());
+		data_files.push_back({ space->get_fid(), std::string(dir) + "/" + info.db_name + ".tablespace" });
+		return page_fs::get_instance()->begin_snapshot(file_ids.data(), (int)file_ids.size());
+	}
+
+	std::string filename = std::string(dir) + "/" + info.db_name + ".database";
+	std::ofstream ofs(filename, std::ios::binary);
+	if(!ofs || !ofs.write((char*)&info, sizeof(info)))
+	{
+		std::fprintf(stderr, "[Error] fail to write %s.\n", filename.c_str());
+		return false;
+	}
+	return page_fs::get_instance()->begin_snapshot(file_ids.data(), (int)file_ids.size());
+}
+
 void database::create_table(const table_header_t *header)
 {
 	if(!is_opened())
@@ -88,7 +190,8 @@ void database::create_table(const table_header_t *header)
 		int id = info.table_num++;
 		std::strncpy(info.table_name[id], header->table_name, MAX_NAME_LEN);
 		tables[id] = new table_manager;
-		tables[id]->create(header->table_name, header);
+		tables[id]->create(header->table_name, header, get_page_size(), space);
+		info.header_page[id] = tables[id]->get_header_page();
 	}
 }
 
@@ -97,16 +200,18 @@ void database::drop()
 	assert(is_opened());
 	for(int i = 0; i != info.table_num; ++i)
 	{
-		tables[i]->drop();
+		// the whole tablespace goes below
+		if(space) tables[i]->close();
+		else tables[i]->drop();
 		delete tables[i];
 		tables[i] = nullptr;
 	}
 
 	info.table_num = 0;
 	std::string filename = get_db_file_path(info.db_name);
-	filename += ".database";
+	filename += space ? ".tablespace" : ".database";
 	close();
-	std::remove(filename.c_str());
+	page_fs::get_instance()->remove_file(filename.c_str());
 }
 
 table_manager* database::get_table(const char *name)
@@ -153,7 +258,9 @@ void database::drop_table(const char *name)
 	{
 		tables[i] = tables[i + 1];
 		std::strcpy(info.table_name[i], info.table_name[i + 1]);
+		info.header_page[i] = info.header_page[i + 1];
 	}
+	info.header_page[info.table_num] = 0;
 
 	tables[info.table_num] = nullptr;
 }
@@ -177,6 +284,15 @@ void database::rename_table(const char *old_name, const char *new_name)
 		return;
 	}
 	
+	// 表空间中的表没有自己的文件，只需更新目录和表头
+	if(space) {
+		std::strncpy(info.table_name[id], new_name, MAX_NAME_LEN);
+		tables[id]->update_table_name(new_name);
+		write_info();
+		std::printf("[Info] Table renamed from `%s` to `%s`\n", old_name, new_name);
+		return;
+	}
+	
 	// 先关闭当前表，然后重命名文件
 	table_manager *old_table = tables[id];
 	old_table->close();
@@ -187,8 +303,9 @@ void database::rename_table(const char *old_name, const char *new_name)
 	std::string new_data_file = get_db_file_path(new_name) + ".tdata";
 	std::string new_head_file = get_db_file_path(new_name) + ".thead";
 	
-	if(rename(old_data_file.c_str(), new_data_file.c_str()) != 0 ||
-	   rename(old_head_file.c_str(), new_head_file.c_str()) != 0) {
+	page_fs *fs = page_fs::get_instance();
+	if(!fs->rename_file(old_data_file.c_str(), new_data_file.c_str()) ||
+	   !fs->rename_file(old_head_file.c_str(), new_head_file.c_str())) {
 		std::fprintf(stderr, "[Error] RENAME TABLE: failed to rename table files!\n");
 		// 重命名失败，重新打开原表
 		old_table->open(old_name);
@@ -204,8 +321,8 @@ void database::rename_table(const char *old_name, const char *new_name)
 		std::fprintf(stderr, "[Error] RENAME TABLE: failed to reopen table!\n");
 		delete tables[id];
 		// 重命名失败，恢复原文件名并重新打开
-		rename(new_data_file.c_str(), old_data_file.c_str());
-		rename(new_head_file.c_str(), old_head_file.c_str());
+		fs->rename_file(new_data_file.c_str(), old_data_file.c_str());
+		fs->rename_file(new_head_file.c_str(), old_head_file.c_str());
 		old_table->open(old_name);
 		tables[id] = old_table;
 		return;
@@ -302,6 +419,8 @@ void database::show_info()
 {
 	std::printf("======== Database Info Begin ========\n");
 	std::printf("Database name = %s\n", info.db_name);
+	std::printf("Page size     = %d\n", get_page_size());
+	std::printf("Tablespace    = %s\n", space ? "single file" : "file per table");
 	std::printf("Table number  = %d\n", info.table_num);
 	for(int i = 0; i != info.table_num; ++i)
 		std::printf("  [table] name = %s\n", info.table_name[i]);
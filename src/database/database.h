@@ -6,6 +6,9 @@
 #include <cstdio>
 #include <cstring>
 #include <cstdlib>
+#include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
 class database
@@ -15,9 +18,21 @@ class database
 		int table_num;
 		char db_name[MAX_NAME_LEN];
 		char table_name[MAX_TABLE_NUM][MAX_NAME_LEN];
+		int page_size;  // of the table files, 0 (older databases) for PAGE_SIZE
+		// 1 if all tables are in the tablespace, with their header
+		// starting at `header_page`
+		int tablespace;
+		int header_page[MAX_TABLE_NUM];
 	} info;
+	// as last written to the file
+	database_info saved_info;
 
 	table_manager *tables[MAX_TABLE_NUM];
+	// the file of a tablespace, whose catalog (the info) starts at page
+	// TABLESPACE_CATALOG_PAGE
+	std::shared_ptr<pager> space;
+
+	bool write_info();
 
 	bool opened;
 public:
@@ -25,10 +40,19 @@ public:
 	~database();
 	bool is_opened() { return opened; }
 	void open(const char *db_name);
-	void create(const char *db_name);
+	/* with `tablespace`, all tables go into one file instead of a
+	 * pair of files each. False if the database exists already. */
+	bool create(const char *db_name, int page_size = 0, bool tablespace = false);
 	void drop();
 	void close();
+	/* write the table headers and the info which changed */
+	void commit();
+	/* take the snapshot of a backup into `dir`: the table headers and the
+	 * info are written there now, the data files are left to be copied
+	 * by `page_fs::copy_snapshot` and returned as (file id, path) */
+	bool begin_backup(const char *dir, std::vector<std::pair<int, std::string>> &data_files);
 	const char *get_name() { return info.db_name; }
+	int get_page_size() { return info.page_size ? info.page_size : PAGE_SIZE; }
 
 	table_manager *get_table(const char *name);
 	table_manager *get_table(int id);
@@ -6,12 +6,19 @@
 #include "../utils/type_cast.h"
 #include "../table/record.h"
 #include "../logger/logger.h"
+#include "../fs/page_fs.h"
+#include "../utils/comparer.h"
+#include "../utils/byte_size.h"
 #include <vector>
+#include <climits>
 #include <limits>
 #include <algorithm>
 #include <unordered_set>  // 添加这行
 #include <limits>
 #include <memory>  // 如果还没有包含
+#include <chrono>
+#include <cerrno>
+#include <sys/stat.h>
 
 struct __cache_clear_guard
 {
@@ -19,12 +26,17 @@ struct __cache_clear_guard
 };
 
 dbms::dbms()
-    : output_file(stdout), cur_db(nullptr), current_user(nullptr)
+    : output_file(stdout), cur_db(nullptr), current_user(nullptr),
+      backup_running(false), backup_bytes(0), backup_us(0),
+      index_fill_percent(INDEX_FILL_PERCENT),
+      dirtied_at_commit(0), statement_dirtied(0)
 {
 }
 
 dbms::~dbms()
 {
+    if (backup_thread.joinable())
+        backup_thread.join();
     close_database();
 }
 
@@ -37,6 +49,161 @@ void dbms::switch_select_output(const char* filename)
     else output_file = std::fopen(filename, "w");
 }
 
+static bool parse_int_in_range(const char* value, int lo, int hi, int& result)
+{
+    char* end;
+    long val = std::strtol(value, &end, 10);
+    if (*value == 0 || *end != 0 || val < lo || val > hi)
+        return false;
+    result = (int)val;
+    return true;
+}
+
+void dbms::set_variable(const char* name, const char* value)
+{
+    if (strcasecmp(name, "buffer_pool_size") == 0)
+    {
+        std::uint64_t bytes;
+        if (!parse_byte_size(value, bytes))
+        {
+            std::fprintf(stderr, "[Error] invalid size '%s'.\n", value);
+            return;
+        }
+
+        int frame_size = page_fs::get_instance()->get_frame_size();
+        std::uint64_t pages = bytes / frame_size;
+        if (pages < PAGE_CACHE_MIN_CAPACITY || pages > INT_MAX)
+        {
+            std::fprintf(stderr, "[Error] buffer pool size must be at least %d KB.\n",
+                PAGE_CACHE_MIN_CAPACITY * (frame_size / 1024));
+            return;
+        }
+
+        if (page_fs::get_instance()->resize((int)pages))
+            std::printf("[Info] Buffer pool resized to %d pages.\n", (int)pages);
+    } else if (strcasecmp(name, "buffer_pool_policy") == 0) {
+        if (!page_fs::get_instance()->set_policy(value))
+            std::fprintf(stderr, "[Error] unknown buffer pool policy '%s', use 'lru' or '2q'.\n", value);
+    } else if (strcasecmp(name, "readahead_window") == 0) {
+        int pages;
+        if (!parse_int_in_range(value, 0, PAGE_READAHEAD_MAX_WINDOW, pages))
+        {
+            std::fprintf(stderr, "[Error] readahead window must be 0 to %d pages.\n",
+                PAGE_READAHEAD_MAX_WINDOW);
+            return;
+        }
+        page_fs::get_instance()->set_readahead(pages);
+    } else if (strcasecmp(name, "bg_writer_clean_percent") == 0) {
+        int percent;
+        if (!parse_int_in_range(value, 0, 100, percent))
+        {
+            std::fprintf(stderr, "[Error] bg_writer_clean_percent must be 0 to 100.\n");
+            return;
+        }
+        page_fs::get_instance()->set_writer_clean_percent(percent);
+    } else if (strcasecmp(name, "file_extent_pages") == 0) {
+        int pages;
+        if (!parse_int_in_range(value, 1, PAGE_FILE_MAX_EXTENT, pages))
+        {
+            std::fprintf(stderr, "[Error] file extent must be 1 to %d pages.\n",
+                PAGE_FILE_MAX_EXTENT);
+            return;
+        }
+        page_fs::get_instance()->set_extent(pages);
+    } else if (strcasecmp(name, "wal_sync_interval_ms") == 0) {
+        int ms;
+        if (!parse_int_in_range(value, 0, PAGE_LOG_MAX_SYNC_INTERVAL, ms))
+        {
+            std::fprintf(stderr, "[Error] wal_sync_interval_ms must be 0 to %d.\n",
+                PAGE_LOG_MAX_SYNC_INTERVAL);
+            return;
+        }
+        page_fs::get_instance()->set_log_sync_interval(ms);
+    } else if (strcasecmp(name, "index_fill_percent") == 0) {
+        if (!parse_int_in_range(value, 50, 100, index_fill_percent))
+            std::fprintf(stderr, "[Error] index_fill_percent must be 50 to 100.\n");
+    } else {
+        std::fprintf(stderr, "[Error] unknown variable '%s'.\n", name);
+    }
+}
+
+void dbms::show_variable(const char* name)
+{
+    page_fs* fs = page_fs::get_instance();
+    if (strcasecmp(name, "status") == 0)
+    {
+        page_fs_stats_t stats = fs->get_stats();
+        std::uint64_t total = stats.hits + stats.misses;
+        std::printf("======== Status Begin ========\n");
+        std::printf("buffer_pool_size     = %llu\n", (unsigned long long)fs->get_capacity() * fs->get_frame_size());
+        std::printf("buffer_pool_policy   = %s\n", fs->get_policy());
+        std::printf("buffer_pool_frame_size = %d\n", fs->get_frame_size());
+        std::printf("buffer_pool_hits     = %llu\n", (unsigned long long)stats.hits);
+        std::printf("buffer_pool_misses   = %llu\n", (unsigned long long)stats.misses);
+        std::printf("buffer_pool_hit_rate = %.2f%%\n", total ? 100.0 * stats.hits / total : 0.0);
+        std::printf("readahead_window     = %d\n", fs->get_readahead());
+        std::printf("page_table_avg_probe = %.2f\n", stats.lookups ? (double)stats.probes / stats.lookups : 0.0);
+        std::printf("page_writes          = %llu\n", (unsigned long long)stats.writes);
+        std::printf("pages_dirtied        = %llu\n", (unsigned long long)stats.pages_dirtied);
+        std::printf("statement_dirtied_pages = %llu\n", (unsigned long long)statement_dirtied);
+        std::printf("page_prefetches      = %llu\n", (unsigned long long)stats.prefetches);
+        std::printf("bg_writer_clean_percent = %d\n", fs->get_writer_clean_percent());
+        std::printf("bg_writer_pages      = %llu\n", (unsigned long long)stats.bg_writes);
+        std::printf("bg_writer_rate       = %llu pages/s\n", (unsigned long long)fs->get_writer_rate());
+        std::printf("file_extent_pages    = %d\n", fs->get_extent());
+        std::printf("page_compress_ratio  = %.2f\n", stats.compress_raw_bytes
+            ? (double)stats.compress_stored_bytes / stats.compress_raw_bytes : 1.0);
+        std::printf("page_compress_time   = %.2f us/page\n", stats.compress_pages
+            ? stats.compress_ns / 1e3 / stats.compress_pages : 0.0);
+        std::printf("page_decompress_time = %.2f us/page\n", stats.decompress_pages
+            ? stats.decompress_ns / 1e3 / stats.decompress_pages : 0.0);
+        std::printf("wal_enabled          = %s\n", fs->is_logging() ? "on" : "off");
+        std::printf("wal_sync_interval_ms = %d\n", fs->get_log_sync_interval());
+        std::printf("wal_commits          = %llu\n", (unsigned long long)stats.log_commits);
+        std::printf("wal_syncs            = %llu\n", (unsigned long long)stats.log_syncs);
+        std::printf("wal_bytes            = %llu\n", (unsigned long long)stats.log_bytes);
+        std::printf("backup_running       = %s\n", backup_running ? "on" : "off");
+        std::printf("backup_bytes         = %llu\n", (unsigned long long)backup_bytes);
+        std::printf("backup_throughput    = %.2f MB/s\n", backup_us
+            ? backup_bytes / (double)backup_us : 0.0);
+        std::printf("backup_cow_pages     = %llu\n", (unsigned long long)stats.snapshot_cow_pages);
+        std::printf("backup_cow_time      = %.2f us/page\n", stats.snapshot_cow_pages
+            ? stats.snapshot_cow_ns / 1e3 / stats.snapshot_cow_pages : 0.0);
+        std::printf("======== Status End   ========\n");
+    } else if (strcasecmp(name, "buffer_pool_size") == 0) {
+        std::printf("buffer_pool_size = %llu\n", (unsigned long long)fs->get_capacity() * fs->get_frame_size());
+    } else if (strcasecmp(name, "buffer_pool_policy") == 0) {
+        std::printf("buffer_pool_policy = %s\n", fs->get_policy());
+    } else if (strcasecmp(name, "readahead_window") == 0) {
+        std::printf("readahead_window = %d\n", fs->get_readahead());
+    } else if (strcasecmp(name, "bg_writer_clean_percent") == 0) {
+        std::printf("bg_writer_clean_percent = %d\n", fs->get_writer_clean_percent());
+    } else if (strcasecmp(name, "file_extent_pages") == 0) {
+        std::printf("file_extent_pages = %d\n", fs->get_extent());
+    } else if (strcasecmp(name, "wal_sync_interval_ms") == 0) {
+        std::printf("wal_sync_interval_ms = %d\n", fs->get_log_sync_interval());
+    } else if (strcasecmp(name, "index_fill_percent") == 0) {
+        std::printf("index_fill_percent = %d\n", index_fill_percent);
+    } else {
+        std::fprintf(stderr, "[Error] unknown variable '%s'.\n", name);
+    }
+}
+
+void dbms::save_buffer_pool()
+{
+    if (!page_fs::get_instance()->save_resident(PAGE_WARMUP_FILE))
+        std::fprintf(stderr, "[Warning] fail to save buffer pool pages to %s.\n", PAGE_WARMUP_FILE);
+}
+
+void dbms::warm_up_buffer_pool(std::uint64_t max_bytes)
+{
+    std::uint64_t pages = std::min<std::uint64_t>(max_bytes / page_fs::get_instance()->get_frame_size(), INT_MAX);
+    if (pages == 0)
+        return;
+    // the first run has no list yet
+    page_fs::get_instance()->load_warmup(PAGE_WARMUP_FILE, (int)pages);
+}
+
 template<typename Callback>
 void dbms::iterate(
     std::vector<table_manager*> required_tables,
@@ -448,6 +615,87 @@ bool dbms::iterate_many_tables_impl(
     return true;
 }
 
+void dbms::commit()
+{
+    page_fs* fs = page_fs::get_instance();
+    if (cur_db)
+        cur_db->commit();
+    fs->commit();
+
+    // a read only statement dirties no page
+    std::uint64_t dirtied = fs->get_dirtied_pages();
+    statement_dirtied = dirtied - dirtied_at_commit;
+    dirtied_at_commit = dirtied;
+}
+
+void dbms::checkpoint()
+{
+    commit();
+    page_fs::get_instance()->checkpoint();
+}
+
+void dbms::backup_database(const char* dir)
+{
+    if (!assert_db_open())
+        return;
+    if (backup_running)
+    {
+        std::fprintf(stderr, "[Error] a backup is running.\n");
+        return;
+    }
+    if (backup_thread.joinable())
+        backup_thread.join();
+
+#ifdef _WIN32
+    int ret = mkdir(dir);
+#else
+    int ret = mkdir(dir, 0755);
+#endif
+    if (ret != 0 && errno != EEXIST)
+    {
+        std::fprintf(stderr, "[Error] fail to create directory `%s`.\n", dir);
+        return;
+    }
+
+    // every table as of now, the pages changed meanwhile are kept by page_fs
+    std::vector<std::pair<int, std::string>> files;
+    if (!cur_db->begin_backup(dir, files))
+    {
+        std::fprintf(stderr, "[Error] fail to back up database `%s`.\n", cur_db->get_name());
+        return;
+    }
+
+    backup_running = true;
+    std::string target = dir;
+    backup_thread = std::thread([this, files, target] {
+        page_fs* fs = page_fs::get_instance();
+        auto begin = std::chrono::steady_clock::now();
+        std::uint64_t bytes = 0;
+        bool ok = true;
+        for (const auto& f : files)
+        {
+            std::int64_t n = fs->copy_snapshot(f.first, f.second.c_str());
+            if (n < 0) ok = false;
+            else bytes += n;
+        }
+        fs->end_snapshot();
+
+        std::uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - begin).count();
+        backup_bytes = bytes;
+        backup_us = std::max<std::uint64_t>(us, 1);
+        if (ok)
+        {
+            std::printf("[Info] backup to `%s` done, %llu bytes at %.2f MB/s.\n", target.c_str(),
+                (unsigned long long)bytes, bytes / (double)backup_us);
+        } else {
+            std::fprintf(stderr, "[Error] backup to `%s` failed.\n", target.c_str());
+        }
+        backup_running = false;
+    });
+    std::printf("[Info] backup of `%s` to `%s` started.\n", cur_db->get_name(), dir);
+}
+
 void dbms::close_database()
 {
     if (cur_db)
@@ -475,10 +723,23 @@ void dbms::switch_database(const char* db_name)
         std::string("Switched to database '") + db_name + "'");
 }
 
-void dbms::create_database(const char* db_name)
+void dbms::create_database(const char* db_name, const char* page_size, bool tablespace)
 {
+    std::uint64_t bytes = PAGE_SIZE;
+    if (page_size && (!parse_byte_size(page_size, bytes) || bytes > PAGE_MAX_SIZE
+            || !page_fs::valid_page_size((int)bytes)))
+    {
+        std::fprintf(stderr, "[Error] page size must be a power of two from %d KB to %d KB.\n",
+            PAGE_SIZE / 1024, PAGE_MAX_SIZE / 1024);
+        return;
+    }
+
     database db;
-    db.create(db_name);
+    if (!db.create(db_name, (int)bytes, tablespace)) {
+        Logger::get_instance()->log_database_op(OperationType::DB_CREATE, db_name, false,
+            std::string("Database '") + db_name + "' not created");
+        return;
+    }
     db.close();
     
     // 日志记录
@@ -542,12 +803,40 @@ void dbms::show_table(const char* table_name)
         }
         else {
             tm->dump_table_info();
+            std::printf("compression = %s\n", tm->get_compression() ? "lz" : "none");
             // 日志记录成功
             Logger::get_instance()->log_table_op(OperationType::TABLE_SHOW, table_name, true);
         }
     }
 }
 
+void dbms::set_table_option(const char* table_name, const char* name, const char* value)
+{
+    if (!check_privilege(table_name, PRIV_ALTER)) {
+        fprintf(stderr, "[Access Denied] ALTER TABLE denied.\n");
+        return;
+    }
+    if (!assert_db_open())
+        return;
+
+    table_manager* tm = cur_db->get_table(table_name);
+    if (tm == nullptr)
+    {
+        std::fprintf(stderr, "[Error] Table `%s` not found.\n", table_name);
+    } else if (strcasecmp(name, "compression") == 0) {
+        if (strcasecmp(value, "lz") == 0 || strcmp(value, "1") == 0) {
+            if (!tm->set_compression(true))
+                std::fprintf(stderr, "[Error] pages of table `%s` are too small to compress, "
+                    "it needs pages larger than %d bytes.\n", table_name, PAGE_COMPRESS_BLOCK);
+        } else if (strcasecmp(value, "none") == 0 || strcmp(value, "0") == 0)
+            tm->set_compression(false);
+        else
+            std::fprintf(stderr, "[Error] unknown compression '%s', use 'lz' or 'none'.\n", value);
+    } else {
+        std::fprintf(stderr, "[Error] unknown table option '%s'.\n", name);
+    }
+}
+
 void dbms::create_table(const table_header_t* header)
 {
     if (!check_privilege(header->table_name, PRIV_CREATE)) {
@@ -1868,6 +2157,8 @@ void dbms::delete_rows(const delete_info_t* info)
     int counter = 0;
     for (int rid : delete_list)
         counter += tm->remove_record(rid);
+    if (counter)
+        tm->compact(true);
     std::printf("[Info] %d row(s) deleted.\n", counter);
     
     // 日志记录
@@ -1991,7 +2282,7 @@ void dbms::create_index(const char* tb_name, const char* col_name)
             std::string("Table '") + tb_name + "' not exists");
     }
     else {
-        tb->create_index(col_name);
+        tb->create_index(col_name, index_fill_percent);
         // 日志记录成功
         std::string sql = Logger::format_create_index_sql(tb_name, col_name);
         Logger::get_instance()->log(LogLevel::INFO, OperationType::INDEX_CREATE, sql, true,
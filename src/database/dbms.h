@@ -5,8 +5,11 @@
 #include "../parser/defs.h"
 #include "../expression/expression.h"
 #include <cstdio>
+#include <cstdint>
 #include <string>
 #include <unordered_map>
+#include <atomic>
+#include <thread>
 
 // Privilege Constants
 enum Privilege {
@@ -32,6 +35,14 @@ class dbms
 		FILE *output_file;
 	database *cur_db;
 	UserSession *current_user;
+	// the backup copying its snapshot in the background
+	std::thread backup_thread;
+	std::atomic<bool> backup_running;
+	std::atomic<std::uint64_t> backup_bytes, backup_us;
+	// page fill of indexes built by CREATE INDEX
+	int index_fill_percent;
+	// pages dirtied in all at the last commit, and by the last statement
+	std::uint64_t dirtied_at_commit, statement_dirtied;
 private:
 	dbms();
 
@@ -42,10 +53,16 @@ public:
 	void show_database(const char *db_name);
 	void switch_database(const char *db_name);
 	void drop_database(const char *db_name);
-	void create_database(const char *db_name);
+	/* `page_size` like `16K` sets the page size of the tables, PAGE_SIZE if null.
+	 * With `tablespace` all tables are kept in a single file. */
+	void create_database(const char *db_name, const char *page_size = nullptr, bool tablespace = false);
+	/* copy a snapshot of the current database into `dir` while
+	 * statements go on, the copy is done in the background */
+	void backup_database(const char *dir);
 
 	void create_table(const table_header_t *header);
 	void show_table(const char *table_name);
+	void set_table_option(const char *table_name, const char *name, const char *value);
 	void drop_table(const char *table_name);
 	void rename_table(const char *old_name, const char *new_name);
 	void alter_table_add_column(const char *table_name, const field_item_t *field);
@@ -62,6 +79,17 @@ public:
 	void update_rows(const update_info_t *info);
 
 	void switch_select_output(const char *filename);
+	void set_variable(const char *name, const char *value);
+	void show_variable(const char *name);
+
+	/* end of a statement, its changes are logged and durable */
+	void commit();
+	/* write everything back so that the log can be emptied */
+	void checkpoint();
+
+	// Buffer pool warmup across runs
+	void save_buffer_pool();
+	void warm_up_buffer_pool(std::uint64_t max_bytes);
 
 	void select_rows_with_groupby(
 		const select_info_t* info,
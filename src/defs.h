@@ -2,26 +2,63 @@
 #define __TRIVIALDB_DEFS__
 
 /* filesystem */
-#define PAGE_SIZE 4096
-#define PAGE_CACHE_CAPACITY 8192
+#define PAGE_SIZE 4096       // default page size, and the size of file headers
+#define PAGE_MAX_SIZE 65536  // page offsets are 16-bit
+#define PAGE_CACHE_CAPACITY 8192   // default number of cached pages
+#define PAGE_CACHE_MIN_CAPACITY 256
+#define PAGE_CACHE_POLICY "2q"
+#define PAGE_CACHE_SHARDS 8
+#define PAGE_PIN_WAIT_MS 1000   // a miss waits this long for a frame to be unpinned
+#define PAGE_IO_QUEUE_DEPTH 64   // io_uring entries
+#define PAGE_IO_THREADS 4        // I/O threads without io_uring
+#define PAGE_WRITER_CLEAN_PERCENT 10   // frames next to be evicted kept clean
+#define PAGE_WRITER_INTERVAL_MS 100
+#define PAGE_WRITER_MAX_RUN 64         // pages in one coalesced write
+#define PAGE_READAHEAD_WINDOW 32      // default readahead window of scans (pages)
+#define PAGE_READAHEAD_MAX_WINDOW 1024
+#define PAGE_READAHEAD_MIN 4
+#define PAGE_READAHEAD_TRIGGER 2      // sequential steps before reading ahead
+#define PAGE_FILE_EXTENT 64           // default pages a file grows by at once
+#define PAGE_FILE_MAX_EXTENT 16384
+#define PAGE_COMPACT_MIN_FREE 64       // pages freed since the last compaction before a DELETE compacts the file
+#define PAGE_COMPACT_FREE_PERCENT 10   // ... and their percent of the pages of the file
+#define PAGE_FREEMAP_BITS (PAGE_SIZE * 8)   // pages in one free-map page
+#define PAGE_COMPRESS_BLOCK 4096      // compressed pages are stored in whole blocks
+#define PAGE_WARMUP_FILE "../../database/buffer_pool.warmup"   // pages cached at the last exit
+#define PAGE_LOG_FILE "../../database/trivialdb.wal"   // write-ahead log
+#define PAGE_LOG_BUFFER_SIZE (4 << 20)        // log bytes buffered before they are written
+#define PAGE_LOG_CHECKPOINT_SIZE (64 << 20)   // log size which triggers a checkpoint
+#define PAGE_LOG_MAX_SYNC_INTERVAL 10000      // ms
+#define PAGE_BACKUP_READ_SIZE (1 << 20)       // bytes of one read of a backup
 #define MAX_FILE_ID 1024
 
+/* index info */
+#define INDEX_FILL_PERCENT 90                 // default page fill of a bulk-loaded index
+#define INDEX_BULK_SORT_BUFFER (64 << 20)     // bytes of keys sorted in memory before a run is spilled
+#define INDEX_KEY_VERSION 1                   // encoding of index keys, older indices are built again
+#define BTREE_APPEND_SPLIT_PERCENT 90         // kept in the lower page when the rightmost page splits at its end
+#define BTREE_PAGE_VERSIONS 1024              // versions of b-tree pages, shared by page ids alike modulo this
+
 /* database info */
 #define MAX_TABLE_NUM   32
+#define TABLESPACE_CATALOG_PAGE 1   // first page of the catalog in a tablespace file
 
 /* page info */
 #define PAGE_FREEBLOCK  0x45455246
 #define PAGE_BLOCK_MIN_NUM   4
-#define PAGE_BLOCK_MAX_SIZE  ((PAGE_SIZE - 12) / PAGE_BLOCK_MIN_NUM - 2)
+#define PAGE_BLOCK_MAX_SIZE(page_size)  (((page_size) - 12) / PAGE_BLOCK_MIN_NUM - 2)
 #define PAGE_OV_KEEP_SIZE    64
 #define PAGE_FREE_BLOCK_MIN_SIZE 16
-#define PAGE_FREE_SPACE_MAX  (PAGE_SIZE / 4 * 3)
+#define PAGE_FREE_SPACE_MAX(page_size)  ((page_size) / 4 * 3)
 
 /* page type (2 bytes) */
 #define PAGE_FIXED      0x4946
 #define PAGE_INDEX_LEAF 0x4947
+#define PAGE_KEY_INTERIOR 0x4b49   // index pages of variable-length keys
+#define PAGE_KEY_LEAF     0x4b4c
 #define PAGE_VARIANT    0x4156
 #define PAGE_OVERFLOW   0x564f
+#define PAGE_COMPRESSED 0x5a4c4350   // 4 bytes, only found on disk
 
 /* table info */
 #define MAX_COL_NUM     32
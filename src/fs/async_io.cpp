@@ -0,0 +1,281 @@
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <deque>
+#include <thread>
+#include <vector>
+
+#include "async_io.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define TRIVIALDB_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#endif
+
+/* finish what the kernel left undone, synchronously */
+static void complete_sync(io_request *req, std::size_t transferred)
+{
+	char *buf = (char*)req->buf + transferred;
+	std::int64_t offset = req->offset + transferred;
+	std::size_t size = req->size - transferred;
+	req->result = size == 0 || (req->write
+		? req->file->write(offset, buf, size)
+		: req->file->read(offset, buf, size));
+	req->done(req);
+}
+
+/* Requests are queued and served by a few threads doing pread/pwrite */
+class thread_pool_io : public async_io
+{
+	std::mutex latch;
+	std::condition_variable cv;
+	std::deque<io_request*> queue;
+	std::vector<std::thread> workers;
+	bool stopping;
+
+	void work()
+	{
+		for(;;)
+		{
+			io_request *req;
+			{
+				std::unique_lock<std::mutex> lock(latch);
+				cv.wait(lock, [this] { return stopping || !queue.empty(); });
+				if(queue.empty()) return;
+				req = queue.front();
+				queue.pop_front();
+			}
+			complete_sync(req, 0);
+		}
+	}
+
+public:
+	thread_pool_io(int threads) : stopping(false)
+	{
+		for(int i = 0; i < threads; ++i)
+			workers.emplace_back([this] { work(); });
+	}
+
+	~thread_pool_io()
+	{
+		{
+			std::lock_guard<std::mutex> lock(latch);
+			stopping = true;
+		}
+		cv.notify_all();
+		for(auto &t : workers) t.join();
+	}
+
+	const char* name() const { return "threads"; }
+
+	void submit(io_request **reqs, int num)
+	{
+		{
+			std::lock_guard<std::mutex> lock(latch);
+			queue.insert(queue.end(), reqs, reqs + num);
+		}
+		cv.notify_all();
+	}
+};
+
+#ifdef TRIVIALDB_IO_URING
+/* io_uring through the raw system calls. Submitting threads share the
+ * submission queue under a latch, one thread reaps the completions.
+ * Requests beyond the completion queue size wait in `backlog`. */
+class uring_io : public async_io
+{
+	int ring_fd;
+	unsigned sq_entries, cq_entries;
+	void *sq_ptr, *cq_ptr;
+	std::size_t sq_bytes, cq_bytes;
+	io_uring_sqe *sqes;
+	unsigned *sq_tail, *sq_mask, *sq_array;
+	unsigned *cq_head, *cq_tail, *cq_mask;
+	io_uring_cqe *cqes;
+
+	std::mutex latch;
+	std::deque<io_request*> backlog;
+	unsigned inflight;
+	std::thread reaper;
+
+	static int enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+	{
+		return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+	}
+
+	// the latch is held
+	void push(std::uint8_t opcode, io_request *req)
+	{
+		unsigned tail = *sq_tail;
+		unsigned idx = tail & *sq_mask;
+		io_uring_sqe *sqe = sqes + idx;
+		std::memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode = opcode;
+		if(req)
+		{
+			sqe->fd = req->file->get_fd();
+			sqe->addr = (std::uint64_t)(std::uintptr_t)req->buf;
+			sqe->len = (unsigned)req->size;
+			sqe->off = (std::uint64_t)req->offset;
+		} else sqe->fd = -1;
+		sqe->user_data = (std::uint64_t)(std::uintptr_t)req;
+		sq_array[idx] = idx;
+		__atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+		++inflight;
+	}
+
+	// the latch is held
+	void flush()
+	{
+		unsigned num = 0;
+		while(!backlog.empty() && inflight < cq_entries && num < sq_entries)
+		{
+			io_request *req = backlog.front();
+			backlog.pop_front();
+			push(req->write ? IORING_OP_WRITE : IORING_OP_READ, req);
+			++num;
+		}
+
+		while(num)
+		{
+			int ret = enter(ring_fd, num, 0, 0);
+			if(ret < 0 && errno == EINTR) continue;
+			if(ret < 0) break;
+			num -= ret;
+		}
+	}
+
+	void reap()
+	{
+		for(;;)
+		{
+			if(enter(ring_fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+				break;
+
+			// completions seen under the latch belong to requests whose
+			// submission is over, the kernel alone is no synchronization
+			// as far as the language is concerned
+			unsigned tail;
+			{
+				std::lock_guard<std::mutex> lock(latch);
+				tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+			}
+
+			unsigned head = *cq_head, done = 0;
+			bool stop = false;
+			while(head != tail)
+			{
+				io_uring_cqe *cqe = cqes + (head & *cq_mask);
+				io_request *req = (io_request*)(std::uintptr_t)cqe->user_data;
+				int res = cqe->res;
+				__atomic_store_n(cq_head, ++head, __ATOMIC_RELEASE);
+				++done;
+
+				if(!req)
+				{
+					stop = true;
+				} else if(res < 0) {
+					// e.g. IORING_OP_READ is not supported before Linux 5.6
+					complete_sync(req, 0);
+				} else {
+					complete_sync(req, (std::size_t)res);
+				}
+			}
+
+			std::lock_guard<std::mutex> lock(latch);
+			inflight -= done;
+			if(stop) return;
+			flush();
+		}
+	}
+
+public:
+	uring_io() : ring_fd(-1), sq_ptr(MAP_FAILED), cq_ptr(MAP_FAILED),
+		sqes((io_uring_sqe*)MAP_FAILED), inflight(0) {}
+
+	~uring_io()
+	{
+		if(reaper.joinable())
+		{
+			{
+				// the reaper stops at the completion of this
+				std::lock_guard<std::mutex> lock(latch);
+				push(IORING_OP_NOP, nullptr);
+				enter(ring_fd, 1, 0, 0);
+			}
+			reaper.join();
+		}
+
+		if(sqes != MAP_FAILED) munmap(sqes, sq_entries * sizeof(io_uring_sqe));
+		if(cq_ptr != MAP_FAILED && cq_ptr != sq_ptr) munmap(cq_ptr, cq_bytes);
+		if(sq_ptr != MAP_FAILED) munmap(sq_ptr, sq_bytes);
+		if(ring_fd >= 0) close(ring_fd);
+	}
+
+	bool setup(unsigned entries)
+	{
+		io_uring_params p;
+		std::memset(&p, 0, sizeof(p));
+		ring_fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+		if(ring_fd < 0) return false;
+
+		sq_entries = p.sq_entries;
+		cq_entries = p.cq_entries;
+		sq_bytes = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+		cq_bytes = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+		if(p.features & IORING_FEAT_SINGLE_MMAP)
+			sq_bytes = cq_bytes = std::max(sq_bytes, cq_bytes);
+
+		sq_ptr = mmap(nullptr, sq_bytes, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+		if(sq_ptr == MAP_FAILED) return false;
+		if(p.features & IORING_FEAT_SINGLE_MMAP)
+			cq_ptr = sq_ptr;
+		else cq_ptr = mmap(nullptr, cq_bytes, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+		if(cq_ptr == MAP_FAILED) return false;
+		sqes = (io_uring_sqe*)mmap(nullptr, sq_entries * sizeof(io_uring_sqe),
+				PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+				ring_fd, IORING_OFF_SQES);
+		if(sqes == MAP_FAILED) return false;
+
+		sq_tail  = (unsigned*)((char*)sq_ptr + p.sq_off.tail);
+		sq_mask  = (unsigned*)((char*)sq_ptr + p.sq_off.ring_mask);
+		sq_array = (unsigned*)((char*)sq_ptr + p.sq_off.array);
+		cq_head  = (unsigned*)((char*)cq_ptr + p.cq_off.head);
+		cq_tail  = (unsigned*)((char*)cq_ptr + p.cq_off.tail);
+		cq_mask  = (unsigned*)((char*)cq_ptr + p.cq_off.ring_mask);
+		cqes     = (io_uring_cqe*)((char*)cq_ptr + p.cq_off.cqes);
+
+		reaper = std::thread([this] { reap(); });
+		return true;
+	}
+
+	const char* name() const { return "io_uring"; }
+
+	void submit(io_request **reqs, int num)
+	{
+		std::lock_guard<std::mutex> lock(latch);
+		backlog.insert(backlog.end(), reqs, reqs + num);
+		flush();
+	}
+};
+#endif
+
+async_io* async_io::create(int queue_depth, int threads)
+{
+#ifdef TRIVIALDB_IO_URING
+	uring_io *ring = new uring_io;
+	if(ring->setup((unsigned)queue_depth))
+		return ring;
+	delete ring;
+#else
+	UNUSED(queue_depth);
+#endif
+	return new thread_pool_io(threads);
+}
@@ -0,0 +1,70 @@
+#ifndef __TRIVIALDB_ASYNC_IO__
+#define __TRIVIALDB_ASYNC_IO__
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <condition_variable>
+
+#include "file_io.h"
+
+/* An asynchronous transfer. `done` is called from an I/O thread once
+ * the transfer has finished, the request must stay alive until then. */
+struct io_request
+{
+	file_io *file;
+	std::int64_t offset;
+	void *buf;
+	std::size_t size;
+	bool write;
+	bool result;
+	void (*done)(io_request*);
+	void *data;
+};
+
+/* Counts the unfinished requests of a batch, so that the submitter
+ * can wait for all of them. */
+class io_batch
+{
+	std::mutex latch;
+	std::condition_variable cv;
+	int pending;
+public:
+	io_batch() : pending(0) {}
+
+	void add(int num)
+	{
+		std::lock_guard<std::mutex> lock(latch);
+		pending += num;
+	}
+
+	void finish()
+	{
+		std::lock_guard<std::mutex> lock(latch);
+		if(--pending == 0)
+			cv.notify_all();
+	}
+
+	void wait()
+	{
+		std::unique_lock<std::mutex> lock(latch);
+		cv.wait(lock, [this] { return pending == 0; });
+	}
+};
+
+/* Asynchronous page I/O. Many requests are submitted at once and
+ * complete in any order. io_uring is used when the kernel supports
+ * it, otherwise a small pool of threads does positional I/O. */
+class async_io
+{
+public:
+	virtual ~async_io() {}
+	virtual const char* name() const = 0;
+	virtual void submit(io_request **reqs, int num) = 0;
+
+	/* io_uring with `queue_depth` entries if possible,
+	 * else `threads` I/O threads */
+	static async_io* create(int queue_depth, int threads);
+};
+
+#endif
@@ -4,25 +4,21 @@
 #include <cstring>
 
 #include "../defs.h"
+#include "cache_policy.h"
 
-class cache_manager
+/* LRU */
+class cache_manager : public cache_policy
 {
 private:
-	int head;
+	int head, capacity;
 	struct node_t
 	{
 		int prev, next;
 	} *nodes;
 public:
-	cache_manager()
+	cache_manager(int capacity) : head(0), capacity(0), nodes(nullptr)
 	{
-		head = 0;
-		nodes = new node_t[PAGE_CACHE_CAPACITY];
-		for(int i = 0; i != PAGE_CACHE_CAPACITY; ++i)
-		{
-			nodes[i].next = (i + 1 == PAGE_CACHE_CAPACITY) ? 0 : i + 1;
-			nodes[i].prev = i ? i - 1 : PAGE_CACHE_CAPACITY - 1;
-		}
+		resize(capacity);
 	}
 
 	~cache_manager()
@@ -31,9 +27,41 @@ public:
 	}
 
 public:
+	const char* name() const { return "lru"; }
+
+	/* Keep the LRU order of the ids below `new_capacity` and put
+	 * the new ids at the tail, so they are handed out first. */
+	void resize(int new_capacity)
+	{
+		assert(new_capacity > 0);
+		int *order = new int[new_capacity];
+		int num = 0;
+		for(int i = 0, k = head; i != capacity; ++i, k = nodes[k].next)
+		{
+			if(k < new_capacity)
+				order[num++] = k;
+		}
+		for(int i = capacity; i < new_capacity; ++i)
+			order[num++] = i;
+		assert(num == new_capacity);
+
+		delete[] nodes;
+		nodes = new node_t[new_capacity];
+		for(int i = 0; i != new_capacity; ++i)
+		{
+			nodes[order[i]].next = order[(i + 1) % new_capacity];
+			nodes[order[i]].prev = order[(i + new_capacity - 1) % new_capacity];
+		}
+
+		head = order[0];
+		capacity = new_capacity;
+		delete[] order;
+		assert(_check_valid());
+	}
+
 	void access(int id)
 	{
-		assert(0 <= id && id < PAGE_CACHE_CAPACITY);
+		assert(0 <= id && id < capacity);
 
 		if(id == head) return;
 
@@ -57,15 +85,49 @@ public:
 		return nodes[head].prev;
 	}
 
+	void load(int id, std::uint64_t key)
+	{
+		UNUSED(key);
+		access(id);
+	}
+
+	void remove(int id)
+	{
+		// move to the tail
+		access(id);
+		head = nodes[id].next;
+	}
+
+	int victim(const std::atomic<int> *pin_count, const std::atomic<char> *held)
+	{
+		for(int i = 0, k = last(); i != capacity; ++i, k = nodes[k].prev)
+		{
+			if(!pin_count[k] && !(held && held[k]))
+				return k;
+		}
+		return -1;
+	}
+
+	int candidates(const std::atomic<int> *pin_count, const std::atomic<char> *held, int *out, int num)
+	{
+		int ret = 0;
+		for(int i = 0, k = last(); i != capacity && ret != num; ++i, k = nodes[k].prev)
+		{
+			if(!pin_count[k] && !(held && held[k]))
+				out[ret++] = k;
+		}
+		return ret;
+	}
+
 private:
 	int _check_valid() const
 	{
-		char *mark = new char[PAGE_CACHE_CAPACITY];
-		std::memset(mark, 0, PAGE_CACHE_CAPACITY);
-		for(int i = 0, k = head; i != PAGE_CACHE_CAPACITY; ++i, k = nodes[k].next)
+		char *mark = new char[capacity];
+		std::memset(mark, 0, capacity);
+		for(int i = 0, k = head; i != capacity; ++i, k = nodes[k].next)
 			mark[k] = 1;
 		int ret = 1;
-		for(int i = 0; i != PAGE_CACHE_CAPACITY; ++i)
+		for(int i = 0; i != capacity; ++i)
 			ret &= mark[i];
 		delete[] mark;
 		return ret;
@@ -0,0 +1,35 @@
+#ifndef __TRIVIALDB_CACHE_POLICY__
+#define __TRIVIALDB_CACHE_POLICY__
+
+#include <atomic>
+#include <cstdint>
+
+/* Replacement policy over the frames of `page_fs`.
+ * Frames are identified by their index, and pages by
+ * `(file_id << 32) | page_id`. A frame holding no page is free. */
+class cache_policy
+{
+public:
+	virtual ~cache_policy() {}
+
+	virtual const char* name() const = 0;
+
+	/* page in frame `id` is hit */
+	virtual void access(int id) = 0;
+	/* free frame `id` is filled with page `key` */
+	virtual void load(int id, std::uint64_t key) = 0;
+	/* page in frame `id` is dropped, the frame becomes free */
+	virtual void remove(int id) = 0;
+	/* the frame to be reused next, free frames come first and
+	 * frames with nonzero `pin_count`, or `held` if given, are
+	 * skipped, -1 if none */
+	virtual int victim(const std::atomic<int> *pin_count, const std::atomic<char> *held) = 0;
+	/* up to `num` frames not skipped in the order they would be
+	 * chosen as victims, return the number of frames */
+	virtual int candidates(const std::atomic<int> *pin_count, const std::atomic<char> *held,
+		int *out, int num) = 0;
+	/* frames beyond `new_capacity` must be free */
+	virtual void resize(int new_capacity) = 0;
+};
+
+#endif
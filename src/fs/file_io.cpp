@@ -0,0 +1,192 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+
+#include "file_io.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+bool file_io::open(const char *filename, bool direct, bool &created)
+{
+	close();
+#ifdef _WIN32
+	UNUSED(direct);
+	this->direct = false;
+	fd = ::_open(filename, _O_RDWR | _O_BINARY);
+	created = fd < 0;
+	if(created)
+		fd = ::_open(filename, _O_RDWR | _O_BINARY | _O_CREAT, _S_IREAD | _S_IWRITE);
+#else
+	int flags = O_RDWR;
+#ifdef O_DIRECT
+	if(direct) flags |= O_DIRECT;
+#endif
+	fd = ::open(filename, flags);
+	if(fd < 0 && errno == ENOENT)
+	{
+		created = true;
+		fd = ::open(filename, flags | O_CREAT, 0644);
+	} else created = false;
+
+#ifdef O_DIRECT
+	if(fd < 0 && direct && errno == EINVAL)
+	{
+		// e.g. tmpfs
+		std::fprintf(stderr, "[Info] direct I/O is not supported for %s.\n", filename);
+		return open(filename, false, created);
+	}
+#elif defined(F_NOCACHE)
+	if(fd >= 0 && direct)
+		fcntl(fd, F_NOCACHE, 1);
+#endif
+	this->direct = direct;
+#endif
+	return fd >= 0;
+}
+
+void file_io::close()
+{
+	if(fd >= 0)
+	{
+#ifdef _WIN32
+		::_close(fd);
+#else
+		::close(fd);
+#endif
+		fd = -1;
+	}
+	page_size = PAGE_SIZE;
+}
+
+std::int64_t file_io::size()
+{
+#ifdef _WIN32
+	return ::_filelengthi64(fd);
+#else
+	struct stat st;
+	if(::fstat(fd, &st) != 0)
+		return -1;
+	return st.st_size;
+#endif
+}
+
+bool file_io::extend(std::int64_t length)
+{
+	std::int64_t cur = size();
+	if(cur < 0)
+		return false;
+	if(cur >= length)
+		return true;
+#ifdef _WIN32
+	return ::_chsize_s(fd, length) == 0;
+#else
+#ifdef __linux__
+	// allocate real blocks, so that writing the pages later does not
+	// have to allocate them one at a time
+	int ret;
+	do ret = ::fallocate(fd, 0, cur, length - cur);
+	while(ret != 0 && errno == EINTR);
+	if(ret == 0)
+		return true;
+	if(errno != EOPNOTSUPP && errno != ENOSYS)
+		return false;
+#endif
+	// a sparse tail reads as zeros as well
+	return ::ftruncate(fd, length) == 0;
+#endif
+}
+
+bool file_io::truncate(std::int64_t length)
+{
+#ifdef _WIN32
+	return ::_chsize_s(fd, length) == 0;
+#else
+	return ::ftruncate(fd, length) == 0;
+#endif
+}
+
+bool file_io::punch_hole(std::int64_t offset, std::int64_t length)
+{
+#if defined(__linux__) && defined(FALLOC_FL_PUNCH_HOLE)
+	return ::fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, length) == 0;
+#else
+	UNUSED(offset);
+	UNUSED(length);
+	return false;
+#endif
+}
+
+bool file_io::sync()
+{
+#ifdef _WIN32
+	return ::_commit(fd) == 0;
+#elif defined(__linux__)
+	// the file size counts as data, other metadata need not be synced
+	return ::fdatasync(fd) == 0;
+#else
+	return ::fsync(fd) == 0;
+#endif
+}
+
+bool file_io::read(std::int64_t offset, void *buf, std::size_t size)
+{
+	char *p = (char*)buf;
+#ifdef _WIN32
+	std::lock_guard<std::mutex> lock(latch);
+	if(::_lseeki64(fd, offset, SEEK_SET) < 0)
+		return false;
+#endif
+	while(size)
+	{
+#ifdef _WIN32
+		int ret = ::_read(fd, p, (unsigned)size);
+#else
+		ssize_t ret = ::pread(fd, p, size, offset);
+#endif
+		if(ret < 0 && errno == EINTR)
+			continue;
+		if(ret <= 0)
+		{
+			// beyond the end of file
+			if(ret == 0) std::memset(p, 0, size);
+			return ret == 0;
+		}
+		p += ret;
+		offset += ret;
+		size -= ret;
+	}
+	return true;
+}
+
+bool file_io::write(std::int64_t offset, const void *buf, std::size_t size)
+{
+	const char *p = (const char*)buf;
+#ifdef _WIN32
+	std::lock_guard<std::mutex> lock(latch);
+	if(::_lseeki64(fd, offset, SEEK_SET) < 0)
+		return false;
+#endif
+	while(size)
+	{
+#ifdef _WIN32
+		int ret = ::_write(fd, p, (unsigned)size);
+#else
+		ssize_t ret = ::pwrite(fd, p, size, offset);
+#endif
+		if(ret < 0 && errno == EINTR)
+			continue;
+		if(ret <= 0)
+			return false;
+		p += ret;
+		offset += ret;
+		size -= ret;
+	}
+	return true;
+}
@@ -0,0 +1,64 @@
+#ifndef __TRIVIALDB_FILE_IO__
+#define __TRIVIALDB_FILE_IO__
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "../defs.h"
+
+/* Page I/O by positional reads and writes, so that several threads
+ * may transfer pages of the same file at once and no stdio buffer
+ * sits between the file and the buffer pool.
+ * In direct mode the OS page cache is bypassed as well (O_DIRECT),
+ * buffers and offsets must then be aligned to PAGE_SIZE.
+ * Pages of the file are `page_size` bytes, PAGE_SIZE until it is set. */
+class file_io
+{
+	int fd;
+	bool direct;
+	int page_size;
+#ifdef _WIN32
+	// no positional I/O on CRT file descriptors
+	std::mutex latch;
+#endif
+public:
+	file_io() : fd(-1), direct(false), page_size(PAGE_SIZE) {}
+	~file_io() { close(); }
+
+	/* open or create `filename`, `created` tells which one happened.
+	 * Fall back to buffered I/O if direct I/O is not supported. */
+	bool open(const char *filename, bool direct, bool &created);
+	void close();
+	bool is_open() const { return fd >= 0; }
+	int get_fd() const { return fd; }
+	bool is_direct() const { return direct; }
+	int get_page_size() const { return page_size; }
+	void set_page_size(int size) { page_size = size; }
+
+	/* size of the file in bytes, -1 on error */
+	std::int64_t size();
+	/* grow the file to at least `length` bytes, the new bytes read as
+	 * zeros. The space is reserved on disk where the OS supports it. */
+	bool extend(std::int64_t length);
+	/* cut the file to `length` bytes */
+	bool truncate(std::int64_t length);
+	/* give the blocks of the range back to the file system, the range
+	 * reads as zeros then. False if the OS cannot do it. */
+	bool punch_hole(std::int64_t offset, std::int64_t length);
+	/* wait until the data written so far is on disk */
+	bool sync();
+
+	bool read(std::int64_t offset, void *buf, std::size_t size);
+	bool write(std::int64_t offset, const void *buf, std::size_t size);
+
+	bool read_page(int page_id, void *buf) {
+		return read((std::int64_t)page_size * page_id, buf, page_size);
+	}
+
+	bool write_page(int page_id, const void *buf) {
+		return write((std::int64_t)page_size * page_id, buf, page_size);
+	}
+};
+
+#endif
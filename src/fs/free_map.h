@@ -0,0 +1,147 @@
+#ifndef __TRIVIALDB_FREE_MAP__
+#define __TRIVIALDB_FREE_MAP__
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "../defs.h"
+
+/* Free pages of a file, one bit per page, set if the page is free.
+ * The bits are kept in groups of `PAGE_FREEMAP_BITS` pages, each group
+ * is stored in one page of the file (`map_page`), 0 if it has none. */
+class free_map
+{
+	static const int WORD_BITS = 64;
+	static const int GROUP_WORDS = PAGE_FREEMAP_BITS / WORD_BITS;
+
+	std::vector<std::uint64_t> bits;
+	std::vector<int> map_pages;
+	// the group changed since it was written
+	std::vector<char> dirty;
+	// pages [0, page_num] are covered
+	int page_num, free_num;
+
+	// `x` is not 0
+#ifdef _MSC_VER
+	static int ctz(std::uint64_t x) { unsigned long i; _BitScanForward64(&i, x); return (int)i; }
+	static int clz(std::uint64_t x) { unsigned long i; _BitScanReverse64(&i, x); return 63 - (int)i; }
+	static int popcount(std::uint64_t x) { return (int)__popcnt64(x); }
+#else
+	static int ctz(std::uint64_t x) { return __builtin_ctzll(x); }
+	static int clz(std::uint64_t x) { return __builtin_clzll(x); }
+	static int popcount(std::uint64_t x) { return __builtin_popcountll(x); }
+#endif
+public:
+	free_map() : page_num(0), free_num(0) {}
+
+	void clear()
+	{
+		bits.clear();
+		map_pages.clear();
+		dirty.clear();
+		page_num = free_num = 0;
+	}
+
+	/* cover pages [0, new_page_num], pages cut off are forgotten */
+	void resize(int new_page_num)
+	{
+		for(int i = new_page_num + 1; i <= page_num; ++i)
+			if(is_free(i)) set_used(i);
+		page_num = new_page_num;
+		int groups = page_num / PAGE_FREEMAP_BITS + 1;
+		bits.resize((std::size_t)groups * GROUP_WORDS, 0);
+		map_pages.resize(groups, 0);
+		dirty.resize(groups, 0);
+	}
+
+	int get_free_num() const { return free_num; }
+	int get_groups() const { return (int)map_pages.size(); }
+	int& map_page(int group) { return map_pages[group]; }
+
+	bool is_free(int page_id) const
+	{
+		assert(0 <= page_id && page_id <= page_num);
+		return bits[page_id / WORD_BITS] >> (page_id % WORD_BITS) & 1;
+	}
+
+	void set_free(int page_id)
+	{
+		assert(1 <= page_id && page_id <= page_num && !is_free(page_id));
+		bits[page_id / WORD_BITS] |= std::uint64_t(1) << (page_id % WORD_BITS);
+		dirty[page_id / PAGE_FREEMAP_BITS] = 1;
+		++free_num;
+	}
+
+	void set_used(int page_id)
+	{
+		assert(is_free(page_id));
+		bits[page_id / WORD_BITS] &= ~(std::uint64_t(1) << (page_id % WORD_BITS));
+		dirty[page_id / PAGE_FREEMAP_BITS] = 1;
+		--free_num;
+	}
+
+	/* the nearest free page from `hint` on, or else the nearest one
+	 * before it, 0 if there is none */
+	int find(int hint) const
+	{
+		if(!free_num) return 0;
+		hint = std::max(1, std::min(hint, page_num));
+
+		int w = hint / WORD_BITS;
+		std::uint64_t x = bits[w] & (~std::uint64_t(0) << (hint % WORD_BITS));
+		for(;;)
+		{
+			if(x) return w * WORD_BITS + ctz(x);
+			if(++w == (int)bits.size()) break;
+			x = bits[w];
+		}
+
+		w = hint / WORD_BITS;
+		x = bits[w] & ((std::uint64_t(1) << (hint % WORD_BITS)) - 1);
+		for(;;)
+		{
+			if(x) return w * WORD_BITS + WORD_BITS - 1 - clz(x);
+			if(w-- == 0) break;
+			x = bits[w];
+		}
+		return 0;
+	}
+
+	bool group_dirty(int group) const { return dirty[group]; }
+	void mark_dirty() { std::fill(dirty.begin(), dirty.end(), 1); }
+
+	bool group_has_free(int group) const
+	{
+		for(int i = 0; i != GROUP_WORDS; ++i)
+			if(bits[(std::size_t)group * GROUP_WORDS + i]) return true;
+		return false;
+	}
+
+	void load_group(int group, const char *page)
+	{
+		std::uint64_t *g = bits.data() + (std::size_t)group * GROUP_WORDS;
+		std::memcpy(g, page, PAGE_SIZE);
+		// bits past the end of the file are stale
+		int end = std::min(page_num + 1, (group + 1) * PAGE_FREEMAP_BITS);
+		for(int i = end; i < (group + 1) * PAGE_FREEMAP_BITS; ++i)
+			g[(i / WORD_BITS) % GROUP_WORDS] &= ~(std::uint64_t(1) << (i % WORD_BITS));
+		if(group == 0) g[0] &= ~std::uint64_t(1);
+		for(int i = 0; i != GROUP_WORDS; ++i)
+			free_num += popcount(g[i]);
+		dirty[group] = 0;
+	}
+
+	void save_group(int group, char *page)
+	{
+		std::memcpy(page, bits.data() + (std::size_t)group * GROUP_WORDS, PAGE_SIZE);
+		dirty[group] = 0;
+	}
+};
+
+#endif
@@ -0,0 +1,201 @@
+#ifndef __TRIVIALDB_LZ_CODEC__
+#define __TRIVIALDB_LZ_CODEC__
+
+#include <cstdint>
+#include <cstring>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/* A small LZ77 codec for pages, in the spirit of LZ4. The output is a
+ * list of sequences, each a token byte (literal length in the high
+ * nibble, match length - 4 in the low one, 15 means more length bytes
+ * follow, 255 each), the literals, a 16-bit match offset and the extra
+ * match length bytes. The last sequence has literals only.
+ * Offsets are 16-bit, so the input is at most 64 KB. */
+class lz_codec
+{
+	static const int MIN_MATCH = 4;
+	static const int HASH_BITS = 12;
+
+	static std::uint32_t read32(const unsigned char *p)
+	{
+		std::uint32_t x;
+		std::memcpy(&x, p, sizeof(x));
+		return x;
+	}
+
+	static std::uint64_t read64(const unsigned char *p)
+	{
+		std::uint64_t x;
+		std::memcpy(&x, p, sizeof(x));
+		return x;
+	}
+
+	// trailing zero bits of `x`, which is not 0
+	static int ctz(std::uint64_t x)
+	{
+#ifdef _MSC_VER
+		unsigned long i;
+		_BitScanForward64(&i, x);
+		return (int)i;
+#else
+		return __builtin_ctzll(x);
+#endif
+	}
+
+	static int hash(std::uint32_t x)
+	{
+		return (int)((x * 2654435761u) >> (32 - HASH_BITS));
+	}
+
+	/* write `len` in the nibble of `token` and the bytes after it,
+	 * false if the output is full */
+	static bool put_length(unsigned char *&op, const unsigned char *end,
+		unsigned char &token, int shift, int len)
+	{
+		if(len < 15)
+		{
+			token |= (unsigned char)(len << shift);
+			return true;
+		}
+		token |= (unsigned char)(15 << shift);
+		for(len -= 15; ; len -= 255)
+		{
+			if(op == end) return false;
+			*op++ = (unsigned char)(len < 255 ? len : 255);
+			if(len < 255) return true;
+		}
+	}
+
+	static bool get_length(const unsigned char *&ip, const unsigned char *end, int &len)
+	{
+		if(len != 15) return true;
+		for(;;)
+		{
+			if(ip == end) return false;
+			int b = *ip++;
+			len += b;
+			if(b != 255) return true;
+		}
+	}
+
+	static bool put_sequence(unsigned char *&op, const unsigned char *end,
+		const unsigned char *lit, int lit_len, int offset, int match_len)
+	{
+		if(op == end) return false;
+		unsigned char *token = op++;
+		*token = 0;
+		if(!put_length(op, end, *token, 4, lit_len) || end - op < lit_len)
+			return false;
+		std::memcpy(op, lit, lit_len);
+		op += lit_len;
+		if(!match_len) return true;
+
+		if(end - op < 2) return false;
+		*op++ = (unsigned char)offset;
+		*op++ = (unsigned char)(offset >> 8);
+		return put_length(op, end, *token, 0, match_len - MIN_MATCH);
+	}
+
+public:
+	/* compress `size` bytes into at most `capacity` bytes, return the
+	 * compressed size or 0 if it does not fit */
+	static int compress(const char *src, int size, char *dst, int capacity)
+	{
+		const unsigned char *in = (const unsigned char*)src;
+		unsigned char *op = (unsigned char*)dst, *end = op + capacity;
+		// input position + 1 of the last sequence with the hash, 0 if none
+		int table[1 << HASH_BITS];
+		std::memset(table, 0, sizeof(table));
+
+		// step faster through data which does not compress
+		int ip = 0, anchor = 0, misses = 0;
+		while(ip + MIN_MATCH <= size)
+		{
+			std::uint32_t seq = read32(in + ip);
+			int h = hash(seq), ref = table[h] - 1;
+			table[h] = ip + 1;
+			if(ref < 0 || ip - ref > 0xffff || read32(in + ref) != seq)
+			{
+				ip += 1 + (misses++ >> 6);
+				// the literals alone would not fit
+				if(ip - anchor > end - op)
+					return 0;
+				continue;
+			}
+			misses = 0;
+
+			// eight bytes at a time, the first different byte is the
+			// lowest one on little-endian machines
+			int len = MIN_MATCH;
+			while(ip + len + 8 <= size)
+			{
+				std::uint64_t diff = read64(in + ref + len) ^ read64(in + ip + len);
+				if(diff)
+				{
+					len += ctz(diff) >> 3;
+					break;
+				}
+				len += 8;
+			}
+			if(ip + len + 8 > size)
+			{
+				while(ip + len < size && in[ref + len] == in[ip + len])
+					++len;
+			}
+			if(!put_sequence(op, end, in + anchor, ip - anchor, ip - ref, len))
+				return 0;
+			ip += len;
+			anchor = ip;
+		}
+
+		if(!put_sequence(op, end, in + anchor, size - anchor, 0, 0))
+			return 0;
+		return (int)(op - (unsigned char*)dst);
+	}
+
+	/* decompress `size` bytes of `src` into `dst`, return the size of
+	 * the output or -1 if the input is corrupted or too long */
+	static int decompress(const char *src, int size, char *dst, int capacity)
+	{
+		const unsigned char *ip = (const unsigned char*)src, *in_end = ip + size;
+		unsigned char *out = (unsigned char*)dst, *op = out, *end = out + capacity;
+
+		while(ip != in_end)
+		{
+			int token = *ip++;
+			int lit_len = token >> 4;
+			if(!get_length(ip, in_end, lit_len)
+				|| in_end - ip < lit_len || end - op < lit_len)
+				return -1;
+			std::memcpy(op, ip, lit_len);
+			ip += lit_len;
+			op += lit_len;
+			// the last sequence
+			if(ip == in_end) break;
+
+			if(in_end - ip < 2) return -1;
+			int offset = ip[0] | ip[1] << 8;
+			ip += 2;
+			int match_len = token & 15;
+			if(!get_length(ip, in_end, match_len))
+				return -1;
+			match_len += MIN_MATCH;
+			if(offset == 0 || offset > op - out || end - op < match_len)
+				return -1;
+
+			// the match may overlap its own output, copy forwards
+			const unsigned char *ref = op - offset;
+			if(offset == 1)
+				std::memset(op, *ref, match_len);
+			else for(int i = 0; i != match_len; ++i)
+				op[i] = ref[i];
+			op += match_len;
+		}
+
+		return (int)(op - out);
+	}
+};
+
+#endif
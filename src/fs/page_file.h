@@ -8,14 +8,15 @@ class page_file
 	int fid;
 public:
 	page_file() : fid(0) {}
-	page_file(const char* filename) : fid(0) { open(filename); }
+	page_file(const char* filename, int page_size = 0) : fid(0) { open(filename, page_size); }
 	~page_file() { close(); }
 	
-	bool open(const char* filename)
+	/* `page_size` is only used if the file is created */
+	bool open(const char* filename, int page_size = 0)
 	{
 		page_fs *fs = page_fs::get_instance();
 		if(fid) fs->close(fid);
-		fid = fs->open(filename);
+		fid = fs->open(filename, page_size);
 		return fid;
 	}
 
@@ -26,14 +27,17 @@ public:
 		fid = 0;
 	}
 
+	int get_fid() const { return fid; }
+
 	void flush()
 	{
 		page_fs::get_instance()->writeback(fid);
 	}
 
-	int new_page()
+	/* a free page near `hint` is taken first */
+	int new_page(int hint = 0)
 	{
-		return page_fs::get_instance()->allocate(fid);
+		return page_fs::get_instance()->allocate(fid, hint);
 	}
 
 	void free_page(int page_id)
@@ -41,16 +45,36 @@ public:
 		page_fs::get_instance()->deallocate(fid, page_id);
 	}
 
-	char* read(int page_id)
+	bool set_compression(bool enable)
+	{
+		return page_fs::get_instance()->set_compression(fid, enable);
+	}
+
+	bool get_compression()
+	{
+		return page_fs::get_instance()->get_compression(fid);
+	}
+
+	int compact(bool when_due = false)
+	{
+		return page_fs::get_instance()->compact(fid, when_due);
+	}
+
+	page_guard read(int page_id)
 	{
 		return page_fs::get_instance()->read(fid, page_id);
 	}
 
-	char* read_for_write(int page_id)
+	page_guard read_for_write(int page_id)
 	{
 		return page_fs::get_instance()->read_for_write(fid, page_id);
 	}
 
+	int prefetch(const int *page_ids, int num)
+	{
+		return page_fs::get_instance()->prefetch(fid, page_ids, num);
+	}
+
 	void mark_dirty(int page_id)
 	{
 		page_fs::get_instance()->mark_dirty(fid, page_id);
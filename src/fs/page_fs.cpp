@@ -1,46 +1,666 @@
 #include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <vector>
 
 #include "page_fs.h"
+#include "lz_codec.h"
+#include "cache_manager.h"
+#include "twoq_cache_manager.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#define HUGE_PAGE_SIZE (2 << 20)
+
+inline std::uint64_t page_key(int file_id, int page_id)
+{
+	return ((std::uint64_t)file_id << 32) | (std::uint32_t)page_id;
+}
+
+static cache_policy* create_policy(const char *name, int capacity)
+{
+	if(std::strcmp(name, "lru") == 0)
+		return new cache_manager(capacity);
+	if(std::strcmp(name, "2q") == 0)
+		return new twoq_cache_manager(capacity);
+	return nullptr;
+}
+
+/* The frames are backed by an anonymous mapping, so that physical
+ * memory is only committed when a frame is first used. Try explicit
+ * huge pages first and fall back to transparent huge pages. */
+static char* map_frames(std::size_t &bytes)
+{
+	bytes = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+#ifdef _WIN32
+	return (char*)VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+	void *ptr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+	// no MAP_NORESERVE here, or touching an unbacked huge page raises SIGBUS
+	ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+	if(ptr == MAP_FAILED)
+	{
+		ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if(ptr == MAP_FAILED)
+			return nullptr;
+#ifdef MADV_HUGEPAGE
+		madvise(ptr, bytes, MADV_HUGEPAGE);
+#endif
+	}
+	return (char*)ptr;
+#endif
+}
+
+/* staging buffer of the calling thread for compressed pages */
+alignas(PAGE_SIZE) static thread_local char codec_buffer[PAGE_MAX_SIZE];
+
+static std::uint64_t ns_since(std::chrono::steady_clock::time_point begin)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - begin).count();
+}
+
+static void unmap_frames(char *ptr, std::size_t bytes)
+{
+#ifdef _WIN32
+	UNUSED(bytes);
+	VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+	munmap(ptr, bytes);
+#endif
+}
 
 /* page_fs code */
 page_fs::page_fs()
+	: capacity(0), frame_size(PAGE_SIZE), buffer(nullptr), buffer_bytes(0),
+	  dirty(nullptr), unlogged(nullptr), pin_count(nullptr), frame_latches(nullptr), index2page(nullptr),
+	  frame_io(nullptr), aio(nullptr), loading(nullptr),
+	  zip_pages(0), zip_raw_bytes(0), zip_stored_bytes(0), zip_ns(0),
+	  unzip_pages(0), unzip_ns(0), logging(false), log_pending(false),
+	  snapshot_active(false), cow_pages(0), cow_ns(0), dirtied_pages(0),
+	  writer_stop(false), writer_clean_percent(PAGE_WRITER_CLEAN_PERCENT),
+	  writer_rate(0), writer_buffer(nullptr), writer_buffer_bytes(0),
+	  direct_io(false), readahead(PAGE_READAHEAD_WINDOW), extent(PAGE_FILE_EXTENT)
 {
-	std::memset(dirty, 0, sizeof(dirty));
-	std::memset(index2page, 0, sizeof(index2page));
+	for(auto &c : compress)
+		c = 0;
+	for(auto &c : log_named)
+		c = 0;
+	layout_shards(PAGE_CACHE_CAPACITY);
+	for(shard_t &s : shards)
+	{
+		s.page2index.reserve(s.capacity);
+		s.policy = create_policy(PAGE_CACHE_POLICY, s.capacity);
+		s.stats = page_fs_stats_t();
+	}
+	capacity = PAGE_CACHE_CAPACITY;
+
+	dirty = new std::atomic<char>[capacity];
+	unlogged = new std::atomic<char>[capacity];
+	pin_count = new std::atomic<int>[capacity];
+	frame_latches = new std::shared_mutex[capacity];
+	index2page = new file_page_t[capacity];
+	frame_io = new frame_io_t[capacity];
+	loading = new std::atomic<char>[capacity];
+	for(int i = 0; i != capacity; ++i)
+		dirty[i] = 0, unlogged[i] = 0, pin_count[i] = 0, loading[i] = 0;
+	std::fill(index2page, index2page + capacity, file_page_t(0, 0));
+
+	writer = std::thread([this] { writer_main(); });
 }
 
-inline bool file_exists(const char* filename)
+void page_fs::writer_main()
 {
-	FILE *f = std::fopen(filename, "r");
-	if(f) std::fclose(f);
-	return f;
+	using clock = std::chrono::steady_clock;
+	auto window_begin = clock::now();
+	std::uint64_t window_pages = 0;
+
+	std::unique_lock<std::mutex> lock(writer_wake_latch);
+	while(!writer_stop)
+	{
+		writer_wake.wait_for(lock, std::chrono::milliseconds(PAGE_WRITER_INTERVAL_MS));
+		if(writer_stop) break;
+
+		lock.unlock();
+		window_pages += write_behind();
+		auto now = clock::now();
+		if(now - window_begin >= std::chrono::seconds(1))
+		{
+			double sec = std::chrono::duration<double>(now - window_begin).count();
+			writer_rate = (std::uint64_t)(window_pages / sec);
+			window_begin = now;
+			window_pages = 0;
+		}
+		lock.lock();
+	}
+}
+
+static void write_behind_complete(io_request *req)
+{
+	if(!req->result)
+		std::fprintf(stderr, "[Error] fail to write pages at offset %lld.\n", (long long)req->offset);
+	((io_batch*)req->data)->finish();
+}
+
+/* One pass of the background writer. Write the dirty pages among the
+ * frames next to be evicted, so that a miss seldom has to write before
+ * it can read. Return the number of pages written. */
+int page_fs::write_behind()
+{
+	std::lock_guard<std::mutex> lock(writer_latch);
+	int percent = writer_clean_percent;
+	if(!percent || !buffer.load())
+		return 0;
+
+	std::vector<std::pair<file_page_t, int>> pages;
+	std::vector<int> cand;
+	for(shard_t &s : shards)
+	{
+		std::lock_guard<std::mutex> shard_lock(s.latch);
+		cand.resize(std::max(1, s.capacity * percent / 100));
+		// pages changed by the statement going on stay until it commits
+		int num = s.policy->candidates(pin_count + s.begin, unlogged + s.begin,
+			cand.data(), (int)cand.size());
+		for(int j = 0; j != num; ++j)
+		{
+			int i = s.begin + cand[j];
+			if(!dirty[i] || !index2page[i].first)
+				continue;
+			// nobody holds the page, whoever takes it for write later marks it dirty again
+			++pin_count[i];
+			set_clean(i);
+			++s.stats.writes;
+			++s.stats.bg_writes;
+			pages.push_back({ index2page[i], i });
+		}
+	}
+
+	write_frames(pages);
+	return (int)pages.size();
 }
 
-int page_fs::open(const char* filename)
+/* Write the pinned frames of `pages`, (file, page) -> frame, and
+ * unpin them. The pages are sorted and written in runs of adjacent
+ * pages. `writer_latch` is held, it guards the staging buffer. */
+void page_fs::write_frames(std::vector<std::pair<file_page_t, int>> &pages)
 {
-	// allocate file id and open file
-	int fid = fm.allocate();
-	if(!fid) return 0;   // fail
+	if(pages.empty())
+		return;
 
-	bool exists = file_exists(filename);
-	FILE *f = std::fopen(filename, exists ? "rb+" : "wb+");
-	if(!f) return 0;
+	std::sort(pages.begin(), pages.end());
+	std::size_t bytes = pages.size() * frame_size;
+	if(writer_buffer_bytes < bytes)
+	{
+		if(writer_buffer) unmap_frames(writer_buffer, writer_buffer_bytes);
+		writer_buffer_bytes = bytes;
+		writer_buffer = map_frames(writer_buffer_bytes);
+	}
 
-	// setup file header
-	page_fs_header_t header;
-	if(!exists)
+	if(!writer_buffer)
 	{
-		header.page_num       = 0;
-		header.first_freepage = 0;
-		std::memset(tmp_buffer, 0, PAGE_SIZE);
-		std::memcpy(tmp_buffer, &header, sizeof(header));
-		std::fwrite(tmp_buffer, PAGE_SIZE, 1, f);
+		// write them one by one
+		writer_buffer_bytes = 0;
+		for(auto &p : pages)
+			write_page_to_file(p.first.first, p.first.second, frame(p.second));
 	} else {
-		std::fread(&header, sizeof(header), 1, f);
+		std::vector<io_request> reqs;
+		// tails of compressed pages, (file, offset, length)
+		std::vector<std::pair<int, std::pair<std::int64_t, std::int64_t>>> holes;
+		for(std::size_t i = 0, j; i < pages.size(); i = j)
+		{
+			// pages [i, j) are adjacent in the same file, compressed
+			// pages are written one by one
+			int file_id = pages[i].first.first;
+			bool zip = compress[file_id] == 1;
+			for(j = i + 1; !zip && j < pages.size() && j - i < PAGE_WRITER_MAX_RUN; ++j)
+			{
+				if(pages[j].first.first != file_id
+					|| pages[j].first.second != pages[i].first.second + (int)(j - i))
+					break;
+			}
+
+			// the run fits into the frames' share of the buffer
+			std::size_t page_size = files[file_id].get_page_size();
+			std::int64_t offset = (std::int64_t)page_size * pages[i].first.second;
+			char *run = writer_buffer + i * frame_size;
+			std::size_t size = (j - i) * page_size;
+			if(zip)
+				size = compress_page(file_id, frame(pages[i].second), run);
+			if(size < page_size)
+				holes.push_back({ file_id, { offset + size, page_size - size } });
+			else for(std::size_t k = i; k != j; ++k)
+				std::memcpy(run + (k - i) * page_size, frame(pages[k].second), page_size);
+
+			io_request req;
+			req.file   = files + file_id;
+			req.offset = offset;
+			req.buf    = run;
+			req.size   = size;
+			req.write  = true;
+			req.result = false;
+			req.done   = write_behind_complete;
+			reqs.push_back(req);
+		}
+
+		io_batch batch;
+		std::vector<io_request*> ptrs;
+		for(io_request &req : reqs)
+		{
+			req.data = &batch;
+			ptrs.push_back(&req);
+		}
+		batch.add((int)ptrs.size());
+		get_aio()->submit(ptrs.data(), (int)ptrs.size());
+		batch.wait();
+
+		for(auto &h : holes)
+			files[h.first].punch_hole(h.second.first, h.second.second);
+	}
+
+	for(auto &p : pages)
+		--pin_count[p.second];
+}
+
+async_io* page_fs::get_aio()
+{
+	std::call_once(aio_once, [this] {
+		aio = async_io::create(PAGE_IO_QUEUE_DEPTH, PAGE_IO_THREADS);
+	} );
+	return aio;
+}
+
+static int shard_capacity(int capacity, int shard)
+{
+	return capacity / PAGE_CACHE_SHARDS + (shard < capacity % PAGE_CACHE_SHARDS);
+}
+
+/* Split `new_capacity` frames among the shards. */
+void page_fs::layout_shards(int new_capacity)
+{
+	int begin = 0;
+	for(int i = 0; i != PAGE_CACHE_SHARDS; ++i)
+	{
+		shards[i].begin = begin;
+		shards[i].capacity = shard_capacity(new_capacity, i);
+		begin += shards[i].capacity;
+	}
+}
+
+page_fs::shard_t& page_fs::shard_of(int file_id, int page_id)
+{
+	std::uint64_t h = page_key(file_id, page_id) * 0x9e3779b97f4a7c15ull;
+	return shards[(h >> 32) % PAGE_CACHE_SHARDS];
+}
+
+void page_fs::map_buffer()
+{
+	std::lock_guard<std::mutex> lock(map_latch);
+	if(buffer.load())
+		return;
+	std::size_t bytes = (std::size_t)capacity * frame_size;
+	char *ptr = map_frames(bytes);
+	if(!ptr)
+	{
+		std::fprintf(stderr, "[Error] fail to allocate %zu bytes for buffer pool.\n", bytes);
+		std::abort();
+	}
+	buffer_bytes = bytes;
+	buffer = ptr;
+}
+
+bool page_fs::resize(int new_capacity)
+{
+	return relayout(new_capacity, frame_size);
+}
+
+/* Make the pool `new_capacity` frames of `new_frame_size` bytes. Frames
+ * keep their pages if the frame size stays, otherwise all are evicted.
+ * False if a page is pinned, the frames are then left as they are. */
+bool page_fs::relayout(int new_capacity, int new_frame_size)
+{
+	assert(new_capacity >= PAGE_CACHE_MIN_CAPACITY);
+	std::lock_guard<std::mutex> writer_lock(writer_latch);
+
+	// readaheads and the warmup may still be reading into the frames
+	for(int i = 0; i != capacity; ++i)
+		wait_loaded(i);
+
+	std::unique_lock<std::mutex> locks[PAGE_CACHE_SHARDS];
+	for(int i = 0; i != PAGE_CACHE_SHARDS; ++i)
+		locks[i] = std::unique_lock<std::mutex>(shards[i].latch);
+
+	for(int i = 0; i != capacity; ++i)
+	{
+		if(pin_count[i] || loading[i])
+		{
+			std::fprintf(stderr, "[Error] page %d of file %d is in use, the buffer pool is not resized.\n",
+				index2page[i].second, index2page[i].first);
+			return false;
+		}
+	}
+	if(new_capacity == capacity && new_frame_size == frame_size)
+		return true;
+
+	// frames keep their position inside the shard
+	int old_begin[PAGE_CACHE_SHARDS], old_capacity[PAGE_CACHE_SHARDS];
+	for(int i = 0; i != PAGE_CACHE_SHARDS; ++i)
+	{
+		old_begin[i] = shards[i].begin;
+		old_capacity[i] = shards[i].capacity;
+	}
+
+	for(int i = 0; i != PAGE_CACHE_SHARDS; ++i)
+	{
+		int keep = new_frame_size == frame_size ? shard_capacity(new_capacity, i) : 0;
+		for(int k = keep; k < old_capacity[i]; ++k)
+			evict(shards[i], k);
+	}
+	layout_shards(new_capacity);
+
+	char *old_buffer = buffer;
+	std::size_t old_bytes = buffer_bytes;
+	int old_frame_size = frame_size;
+	frame_size = new_frame_size;
+	if(old_buffer)
+	{
+		buffer = nullptr;
+		capacity = new_capacity;
+		map_buffer();
+	}
+
+	std::atomic<char> *new_dirty = new std::atomic<char>[new_capacity];
+	std::atomic<char> *new_unlogged = new std::atomic<char>[new_capacity];
+	file_page_t *new_index2page = new file_page_t[new_capacity];
+	for(int i = 0; i != new_capacity; ++i)
+		new_dirty[i] = 0, new_unlogged[i] = 0;
+	std::fill(new_index2page, new_index2page + new_capacity, file_page_t(0, 0));
+	for(int i = 0; i != PAGE_CACHE_SHARDS; ++i)
+	{
+		int keep = std::min(old_capacity[i], shards[i].capacity);
+		for(int k = 0; k != keep; ++k)
+		{
+			int from = old_begin[i] + k, to = shards[i].begin + k;
+			new_dirty[to] = dirty[from].load();
+			new_unlogged[to] = unlogged[from].load();
+			new_index2page[to] = index2page[from];
+			if(old_buffer && index2page[from].first)
+				std::memcpy(frame(to), old_buffer + (std::size_t)from * old_frame_size, frame_size);
+		}
+		shards[i].policy->resize(shards[i].capacity);
+		shards[i].page2index.reserve(shards[i].capacity);
+	}
+
+	if(old_buffer)
+		unmap_frames(old_buffer, old_bytes);
+	delete[] dirty;
+	delete[] unlogged;
+	delete[] pin_count;
+	delete[] frame_latches;
+	delete[] index2page;
+	delete[] frame_io;
+	delete[] loading;
+	dirty = new_dirty;
+	unlogged = new_unlogged;
+	index2page = new_index2page;
+	pin_count = new std::atomic<int>[new_capacity];
+	for(int i = 0; i != new_capacity; ++i)
+		pin_count[i] = 0;
+	frame_latches = new std::shared_mutex[new_capacity];
+	frame_io = new frame_io_t[new_capacity];
+	loading = new std::atomic<char>[new_capacity];
+	for(int i = 0; i != new_capacity; ++i)
+		loading[i] = 0;
+	capacity = new_capacity;
+	return true;
+}
+
+bool page_fs::set_policy(const char *name)
+{
+	cache_policy *new_policy[PAGE_CACHE_SHARDS];
+	for(int i = 0; i != PAGE_CACHE_SHARDS; ++i)
+	{
+		std::lock_guard<std::mutex> lock(shards[i].latch);
+		new_policy[i] = create_policy(name, shards[i].capacity);
+		if(!new_policy[i])
+		{
+			while(i--) delete new_policy[i];
+			return false;
+		}
+
+		shard_t &s = shards[i];
+		for(int k = 0; k != s.capacity; ++k)
+		{
+			file_page_t info = index2page[s.begin + k];
+			if(info.first)
+				new_policy[i]->load(k, page_key(info.first, info.second));
+		}
+
+		delete s.policy;
+		s.policy = new_policy[i];
+	}
+
+	return true;
+}
+
+page_fs_stats_t page_fs::get_stats()
+{
+	page_fs_stats_t ret = page_fs_stats_t();
+	for(shard_t &s : shards)
+	{
+		std::lock_guard<std::mutex> lock(s.latch);
+		ret.hits   += s.stats.hits;
+		ret.misses += s.stats.misses;
+		ret.writes += s.stats.writes;
+		ret.prefetches += s.stats.prefetches;
+		ret.bg_writes += s.stats.bg_writes;
+		ret.lookups += s.page2index.get_lookups();
+		ret.probes  += s.page2index.get_probes();
+	}
+	ret.compress_pages        = zip_pages;
+	ret.compress_raw_bytes    = zip_raw_bytes;
+	ret.compress_stored_bytes = zip_stored_bytes;
+	ret.compress_ns           = zip_ns;
+	ret.decompress_pages      = unzip_pages;
+	ret.decompress_ns         = unzip_ns;
+	log.get_stats(ret.log_commits, ret.log_syncs, ret.log_bytes);
+	ret.snapshot_cow_pages    = cow_pages;
+	ret.snapshot_cow_ns       = cow_ns;
+	ret.pages_dirtied         = dirtied_pages;
+	return ret;
+}
+
+void page_fs::reset_stats()
+{
+	for(shard_t &s : shards)
+	{
+		std::lock_guard<std::mutex> lock(s.latch);
+		s.stats = page_fs_stats_t();
+		s.page2index.reset_stats();
+	}
+	zip_pages = zip_raw_bytes = zip_stored_bytes = zip_ns = 0;
+	unzip_pages = unzip_ns = 0;
+	cow_pages = cow_ns = 0;
+	dirtied_pages = 0;
+	log.reset_stats();
+}
+
+/* The list holds two lines per file, the number of pages and the file
+ * name, then the page ids in ascending order. */
+bool page_fs::save_resident(const char *path)
+{
+	std::vector<std::pair<std::string, std::vector<int>>> list;
+	{
+		std::lock_guard<std::mutex> lock(meta_latch);
+		for(int fid = 1; fid <= MAX_FILE_ID; ++fid)
+		{
+			if(!fm.is_used(fid))
+				continue;
+			std::vector<int> page_ids;
+			{
+				file_pages_t &f = file_pages[fid];
+				std::lock_guard<std::mutex> file_lock(f.latch);
+				page_ids.assign(f.cached.begin(), f.cached.end());
+			}
+			if(page_ids.empty())
+				continue;
+			std::sort(page_ids.begin(), page_ids.end());
+			list.push_back({ file_names[fid], std::move(page_ids) });
+		}
+	}
+
+	if(list.empty())
+		return true;
+
+	std::ofstream ofs(path);
+	if(!ofs)
+		return false;
+	for(auto &f : list)
+	{
+		ofs << f.second.size() << ' ' << f.first << '\n';
+		for(std::size_t i = 0; i != f.second.size(); ++i)
+			ofs << (i ? " " : "") << f.second[i];
+		ofs << '\n';
+	}
+	return (bool)ofs;
+}
+
+bool page_fs::load_warmup(const char *path, int max_pages)
+{
+	std::ifstream ifs(path);
+	if(!ifs)
+		return false;
+
+	// more pages than frames would only evict the first ones again
+	max_pages = std::min(max_pages, capacity);
+	std::lock_guard<std::mutex> lock(warmup_latch);
+	warmup.clear();
+	std::size_t num;
+	std::string name;
+	while(max_pages > 0 && ifs >> num && ifs.get() == ' ' && std::getline(ifs, name))
+	{
+		std::vector<int> &page_ids = warmup[name];
+		int page_id;
+		for(std::size_t i = 0; i != num && ifs >> page_id; ++i)
+		{
+			if(max_pages > 0)
+			{
+				page_ids.push_back(page_id);
+				--max_pages;
+			}
+		}
+	}
+
+	return true;
+}
+
+int page_fs::open(const char* filename, int page_size)
+{
+	if(page_size && !valid_page_size(page_size))
+	{
+		std::fprintf(stderr, "[Error] invalid page size %d.\n", page_size);
+		return 0;
+	}
+
+	int fid;
+	{
+		std::lock_guard<std::mutex> lock(meta_latch);
+
+		// allocate file id and open file
+		fid = fm.allocate();
+		if(!fid) return 0;   // fail
+
+		bool created;
+		if(!files[fid].open(filename, direct_io, created))
+		{
+			fm.deallocate(fid);
+			return 0;
+		}
+
+		// setup file header
+		page_fs_header_t header;
+		if(created)
+		{
+			header.page_num       = 0;
+			header.first_freepage = 0;
+			header.freemap_num    = 0;
+			header.page_size      = page_size ? page_size : PAGE_SIZE;
+			header.compression    = 0;
+			files[fid].set_page_size(header.page_size);
+			std::memset(tmp_buffer, 0, header.page_size);
+			std::memcpy(tmp_buffer, &header, sizeof(header));
+			files[fid].write_page(0, tmp_buffer);
+		} else {
+			// the header is in the first PAGE_SIZE bytes whatever the page size
+			files[fid].read(0, tmp_buffer, PAGE_SIZE);
+			std::memcpy(&header, tmp_buffer, sizeof(header));
+			if(!header.page_size)
+				header.page_size = PAGE_SIZE;
+			if(!valid_page_size(header.page_size))
+			{
+				std::fprintf(stderr, "[Error] invalid page size %d of file %s.\n", header.page_size, filename);
+				files[fid].close();
+				fm.deallocate(fid);
+				return 0;
+			}
+			files[fid].set_page_size(header.page_size);
+		}
+
+		file_info[fid] = header;
+		file_names[fid] = filename;
+		compress[fid] = header.compression;
+		file_log[fid] = file_log_t();
+		log_named[fid] = 0;
+		if(created && logging)
+		{
+			// recovery starts the file over from here
+			log_file_name(fid);
+			page_log_file_t rec = { fid, header.page_size };
+			log.append(LOG_CREATE, &rec, sizeof(rec));
+			log_pending = true;
+		}
+		std::int64_t size = files[fid].size();
+		file_end[fid] = std::max(1, (int)(size / header.page_size));
+		freed_pages[fid] = 0;
+		load_free_map(fid);
+		page_size = header.page_size;
+	}
+
+	if(page_size > frame_size)
+	{
+		// the pages of the file would not fit in the frames
+		std::int64_t bytes = (std::int64_t)capacity * frame_size;
+		if(!relayout(std::max(PAGE_CACHE_MIN_CAPACITY, (int)(bytes / page_size)), page_size))
+		{
+			std::fprintf(stderr, "[Error] fail to open %s with pages of %d bytes.\n", filename, page_size);
+			close(fid);
+			return 0;
+		}
 	}
 
-	files[fid] = f;
-	file_info[fid] = header;
+	// read the pages the file had cached in the last run in the background
+	std::vector<int> page_ids;
+	{
+		std::lock_guard<std::mutex> lock(warmup_latch);
+		auto it = warmup.find(filename);
+		if(it != warmup.end())
+		{
+			page_ids.swap(it->second);
+			warmup.erase(it);
+		}
+	}
+	if(!page_ids.empty())
+		prefetch(fid, page_ids.data(), (int)page_ids.size());
 	return fid;
 }
 
@@ -48,51 +668,321 @@ void page_fs::close(int file_id)
 {
 	assert(fm.is_used(file_id));
 
-	writeback(file_id);
+	// a backup may still be copying the file
+	{
+		std::unique_lock<std::mutex> lock(snapshot_latch);
+		snapshot_released.wait(lock, [this, file_id] { return !snapshot_files.count(file_id); });
+	}
+
+	// the background writer may still be writing pages of the file
+	std::lock_guard<std::mutex> writer_lock(writer_latch);
+	flush(file_id);
+	// the file id may be reused by another file
+	drop(file_id);
+
+	std::lock_guard<std::mutex> lock(meta_latch);
+	if(free_maps[file_id].get_free_num())
+		shrink(file_id);
+	if(logging)
+	{
+		// closing makes the file durable, checkpoints skip it
+		log_meta(file_id);
+		if(!files[file_id].sync())
+			std::fprintf(stderr, "[Error] fail to sync file %s.\n", file_names[file_id].c_str());
+	}
 	fm.deallocate(file_id);
-	std::fclose(files[file_id]);
+	files[file_id].close();
+	file_names[file_id].clear();
+	compress[file_id] = 0;
 }
 
 void page_fs::writeback(int file_id)
 {
 	assert(fm.is_used(file_id));
-	FILE *file = files[file_id];
-	for(int i = 0; i != PAGE_CACHE_CAPACITY; ++i)
+	std::lock_guard<std::mutex> writer_lock(writer_latch);
+	flush(file_id);
+}
+
+/* Write the dirty pages and the header of the file.
+ * `writer_latch` is held. */
+void page_fs::flush(int file_id)
+{
+	std::vector<int> page_ids;
+	{
+		file_pages_t &f = file_pages[file_id];
+		std::lock_guard<std::mutex> lock(f.latch);
+		page_ids.assign(f.dirty.begin(), f.dirty.end());
+	}
+
+	std::vector<std::pair<file_page_t, int>> pages;
+	for(int page_id : page_ids)
+	{
+		shard_t &s = shard_of(file_id, page_id);
+		std::lock_guard<std::mutex> lock(s.latch);
+		int k = s.page2index.find(page_key(file_id, page_id));
+		// written by an eviction in between
+		if(k < 0 || !dirty[s.begin + k])
+			continue;
+
+		int i = s.begin + k;
+		// debug_printf("Writeback: fid = %d, pid = %d\n", file_id, page_id);
+		++pin_count[i];
+		set_clean(i);
+		++s.stats.writes;
+		pages.push_back({ { file_id, page_id }, i });
+	}
+	write_frames(pages);
+	// misses may still be writing pages they cleaned before
+	{
+		std::unique_lock<std::shared_mutex> evict_lock(evict_latch);
+	}
+
+	std::lock_guard<std::mutex> lock(meta_latch);
+	write_header(file_id);
+}
+
+/* Read the free map of the file being opened, its header page is in
+ * `tmp_buffer`. `meta_latch` is held. */
+void page_fs::load_free_map(int file_id)
+{
+	page_fs_header_t &info = file_info[file_id];
+	free_map &map = free_maps[file_id];
+	map.clear();
+	map.resize(info.page_num);
+
+	int num = std::min(info.freemap_num, std::min(map.get_groups(), PAGE_FREEMAP_MAX_NUM));
+	int map_pages[PAGE_FREEMAP_MAX_NUM];
+	std::memcpy(map_pages, tmp_buffer + sizeof(page_fs_header_t), sizeof(map_pages));
+	for(int g = 0; g < num; ++g)
+	{
+		if(map_pages[g] < 1 || map_pages[g] > info.page_num)
+			continue;
+		map.map_page(g) = map_pages[g];
+		if(files[file_id].read_page(map_pages[g], tmp_buffer))
+			map.load_group(g, tmp_buffer);
+	}
+
+	// the free-page list of an older file
+	int page_id = info.first_freepage;
+	for(int n = 0; page_id && n != info.page_num; ++n)
+	{
+		if(page_id < 1 || page_id > info.page_num || map.is_free(page_id))
+			break;
+		int data[2];
+		files[file_id].read_page(page_id, tmp_buffer);
+		std::memcpy(data, tmp_buffer, sizeof(data));
+		if(data[0] != PAGE_FREEBLOCK)
+			break;
+		map.set_free(page_id);
+		page_id = data[1];
+	}
+	info.first_freepage = 0;
+}
+
+/* Write the changed groups of the free map, then the header page.
+ * `meta_latch` is held. */
+void page_fs::write_header(int file_id)
+{
+	page_fs_header_t &info = file_info[file_id];
+	free_map &map = free_maps[file_id];
+	for(int g = 0; g < map.get_groups() && g < PAGE_FREEMAP_MAX_NUM; ++g)
+	{
+		if(!map.group_dirty(g))
+			continue;
+		if(!map.map_page(g))
+		{
+			// a group without free pages needs no map page
+			if(!map.group_has_free(g))
+				continue;
+			// at the end of the file, where no freed page can still be cached
+			map.map_page(g) = ++info.page_num;
+			map.resize(info.page_num);
+			file_end[file_id] = std::max(file_end[file_id], info.page_num + 1);
+		}
+		std::memset(tmp_buffer, 0, info.page_size);
+		map.save_group(g, tmp_buffer);
+		files[file_id].write_page(map.map_page(g), tmp_buffer);
+	}
+
+	// direct I/O needs whole pages
+	info.freemap_num = std::min(map.get_groups(), PAGE_FREEMAP_MAX_NUM);
+	info.compression = compress[file_id];
+	std::memset(tmp_buffer, 0, info.page_size);
+	std::memcpy(tmp_buffer, &info, sizeof(page_fs_header_t));
+	for(int g = 0; g != info.freemap_num; ++g)
+	{
+		int page_id = map.map_page(g);
+		std::memcpy(tmp_buffer + sizeof(page_fs_header_t) + g * sizeof(int), &page_id, sizeof(int));
+	}
+	files[file_id].write_page(0, tmp_buffer);
+}
+
+int page_fs::compact(int file_id, bool when_due)
+{
+	assert(fm.is_used(file_id));
+	std::lock_guard<std::mutex> writer_lock(writer_latch);
+	std::lock_guard<std::mutex> lock(meta_latch);
+	if(!free_maps[file_id].get_free_num())
+		return 0;
+	if(when_due && freed_pages[file_id] < std::max(PAGE_COMPACT_MIN_FREE,
+		file_info[file_id].page_num / 100 * PAGE_COMPACT_FREE_PERCENT))
+		return 0;
+	{
+		// a backup is still to read the pages
+		std::lock_guard<std::mutex> snapshot_lock(snapshot_latch);
+		if(snapshot_files.count(file_id))
+			return 0;
+	}
+	return shrink(file_id);
+}
+
+/* Cut the free pages off the end of the file and punch holes for the
+ * other free pages. Pages still held by someone stay.
+ * `meta_latch` is held. */
+int page_fs::shrink(int file_id)
+{
+	page_fs_header_t &info = file_info[file_id];
+	free_map &map = free_maps[file_id];
+
+	// map pages are cut off like free pages, and written again after
+	// the new end of the file
+	std::vector<int> map_pages(map.get_groups());
+	for(int g = 0; g != map.get_groups(); ++g)
+	{
+		map_pages[g] = map.map_page(g);
+		if(map_pages[g]) map.set_free(map_pages[g]);
+	}
+
+	freed_pages[file_id] = 0;
+	int old_num = info.page_num;
+	while(info.page_num && map.is_free(info.page_num) && discard(file_id, info.page_num))
+		--info.page_num;
+	map.resize(info.page_num);
+
+	for(int g = 0; g != map.get_groups(); ++g)
 	{
-		file_page_t info = index2page[i];
-		if(info.first == file_id && dirty[i])
+		if(map_pages[g] > info.page_num)
+			map.map_page(g) = 0;
+		else if(map_pages[g])
+			map.set_used(map_pages[g]);
+	}
+	map.mark_dirty();
+	if(logging && info.page_num < old_num)
+	{
+		file_log[file_id].changed = true;
+		file_log[file_id].truncated = true;
+		log_pending = true;
+	}
+	std::int64_t page_size = info.page_size;
+	if(info.page_num < old_num && files[file_id].truncate(page_size * (info.page_num + 1)))
+		file_end[file_id] = info.page_num + 1;
+	write_header(file_id);
+
+	for(int i = 1, j; i <= info.page_num; i = j + 1)
+	{
+		if(!map.is_free(i))
 		{
-			// debug_printf("Writeback: fid = %d, pid = %d\n", file_id, info.second);
-			std::fseek(file, (long)PAGE_SIZE * info.second, SEEK_SET);
-			std::fwrite(buffer + i * PAGE_SIZE, PAGE_SIZE, 1, file);
-			page2index.erase(page2index.find(info));
-			index2page[i] = { 0, 0 };
+			j = i;
+			continue;
 		}
+		// pages [i, j) are free
+		for(j = i + 1; j <= info.page_num && map.is_free(j); ++j);
+		files[file_id].punch_hole(page_size * i, page_size * (j - i));
+	}
+
+	return std::max(old_num - info.page_num, 0);
+}
+
+/* Drop the page from the cache without writing it, false if it is
+ * pinned. `meta_latch` is held. */
+bool page_fs::discard(int file_id, int page_id)
+{
+	shard_t &s = shard_of(file_id, page_id);
+	std::lock_guard<std::mutex> lock(s.latch);
+	int k = s.page2index.find(page_key(file_id, page_id));
+	if(k < 0)
+		return true;
+	// a page being read ahead is pinned as well
+	int i = s.begin + k;
+	if(pin_count[i])
+		return false;
+	if(dirty[i])
+		set_clean(i, false);
+	evict(s, k);
+	return true;
+}
+
+/* Drop the cached pages of the flushed file. `writer_latch` is held. */
+void page_fs::drop(int file_id)
+{
+	std::vector<int> page_ids;
+	{
+		file_pages_t &f = file_pages[file_id];
+		std::lock_guard<std::mutex> lock(f.latch);
+		page_ids.assign(f.cached.begin(), f.cached.end());
 	}
 
-	std::fseek(file, 0, SEEK_SET);
-	std::fwrite(file_info + file_id, sizeof(page_fs_header_t), 1, file);
+	for(int page_id : page_ids)
+	{
+		shard_t &s = shard_of(file_id, page_id);
+		std::unique_lock<std::mutex> lock(s.latch);
+		int k = s.page2index.find(page_key(file_id, page_id));
+		// a readahead may still be reading the page
+		while(k >= 0 && loading[s.begin + k])
+		{
+			lock.unlock();
+			wait_loaded(s.begin + k);
+			lock.lock();
+			k = s.page2index.find(page_key(file_id, page_id));
+		}
+
+		if(k < 0)
+			continue;
+		if(pin_count[s.begin + k])
+		{
+			std::fprintf(stderr, "[Error] page %d of file %d is pinned on close.\n", page_id, file_id);
+			continue;
+		}
+		evict(s, k);
+	}
 }
 
-int page_fs::allocate(int file_id)
+int page_fs::allocate(int file_id, int hint)
 {
 	assert(fm.is_used(file_id));
 
+	std::lock_guard<std::mutex> lock(meta_latch);
 	page_fs_header_t &info = file_info[file_id];
-	int page_id;
-	if(info.first_freepage == 0)
+	free_map &map = free_maps[file_id];
+	int page_id = map.find(hint);
+	if(page_id)
 	{
-		page_id = ++info.page_num;
-		std::memset(tmp_buffer, 0, PAGE_SIZE);
-		std::fseek(files[file_id], 0, SEEK_END);
-		std::fwrite(tmp_buffer, PAGE_SIZE, 1, files[file_id]);
-		read(file_id, page_id);
+		map.set_used(page_id);
 	} else {
-		page_id = info.first_freepage;
-		const char *data = read(file_id, info.first_freepage);
-		info.first_freepage = reinterpret_cast<const int*>(data)[1];
+		page_id = ++info.page_num;
+		map.resize(info.page_num);
+		if(page_id >= file_end[file_id])
+		{
+			// grow by a whole extent, the next pages need no system call
+			int end = page_id + extent;
+			if(files[file_id].extend((std::int64_t)info.page_size * end))
+				file_end[file_id] = end;
+			else std::fprintf(stderr, "[Error] fail to extend file %d to %d pages.\n", file_id, end);
+		}
 	}
 
+	// whatever a reused page held is garbage, it is not read either
+	if(!create(file_id, page_id))
+	{
+		map.set_free(page_id);
+		return 0;
+	}
+	if(logging)
+	{
+		file_log[file_id].changed = true;
+		file_log[file_id].ops.push_back(-page_id);
+		log_pending = true;
+	}
 	return page_id;
 }
 
@@ -101,42 +991,344 @@ void page_fs::deallocate(int file_id, int page_id)
 	assert(fm.is_used(file_id));
 	assert(1 <= page_id && page_id <= file_info[file_id].page_num);
 
-	page_fs_header_t &info = file_info[file_id];
-	char *page_buf = read_for_write(file_id, page_id);
-	int data[2] = { PAGE_FREEBLOCK, info.first_freepage };
-	std::memcpy(page_buf, data, sizeof(data));
-	info.first_freepage = page_id;
+	std::lock_guard<std::mutex> lock(meta_latch);
+	free_maps[file_id].set_free(page_id);
+	++freed_pages[file_id];
+	if(logging)
+	{
+		file_log[file_id].changed = true;
+		file_log[file_id].ops.push_back(page_id);
+		log_pending = true;
+	}
+	// nobody reads a free page, so it need not be written either
+	discard(file_id, page_id);
 }
 
-char* page_fs::read(int file_id, int page_id, int& index)
+/* Take a frame of the shard for the page, -1 if all are pinned.
+ * A page changed by the statement going on is not written before it
+ * commits, as the log cannot undo it, unless the statement changed
+ * all the pages of the shard. The shard latch is held by `lock`. A
+ * dirty victim is written with the latch dropped, then -2 is returned
+ * and the page is to be looked up again. */
+int page_fs::install(std::unique_lock<std::mutex> &lock, shard_t &s, int file_id, int page_id)
+{
+	if(!buffer.load()) map_buffer();
+	int k = s.policy->victim(pin_count + s.begin, unlogged + s.begin);
+	if(k < 0) k = s.policy->victim(pin_count + s.begin, nullptr);
+	if(k < 0) return -1;
+
+	int index = s.begin + k;
+	if(dirty[index])
+	{
+		write_victim(lock, s, index);
+		return -2;
+	}
+	evict(s, k);
+	s.policy->load(k, page_key(file_id, page_id));
+	s.page2index.insert(page_key(file_id, page_id), k);
+	assert(!index2page[index].first && !index2page[index].second);
+	index2page[index] = { file_id, page_id };
+
+	file_pages_t &f = file_pages[file_id];
+	std::lock_guard<std::mutex> file_lock(f.latch);
+	f.cached.insert(page_id);
+	return index;
+}
+
+/* Write the dirty frame with the shard latch dropped, pinned meanwhile
+ * as by the background writer. It is clean from now on, so `flush`
+ * waits for the write by `evict_latch` before the file is synced. */
+void page_fs::write_victim(std::unique_lock<std::mutex> &lock, shard_t &s, int index)
+{
+	file_page_t key = index2page[index];
+	++pin_count[index];
+	set_clean(index);
+	++s.stats.writes;
+	std::shared_lock<std::shared_mutex> evict_lock(evict_latch);
+	lock.unlock();
+
+	debug_printf("Free cache and writeback: fid = %d, pid = %d\n", key.first, key.second);
+	write_page_to_file(key.first, key.second, frame(index));
+	--pin_count[index];
+	evict_lock.unlock();
+	// the background writer is behind
+	writer_wake.notify_one();
+	lock.lock();
+}
+
+/* The frame of the page, installed if not cached, `hit` tells which.
+ * -1 if every frame of the shard stays pinned for PAGE_PIN_WAIT_MS.
+ * The shard latch is held by `lock`, it is dropped while waiting. */
+int page_fs::lookup(std::unique_lock<std::mutex> &lock, shard_t &s, int file_id, int page_id, bool &hit)
+{
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(PAGE_PIN_WAIT_MS);
+	for(;;)
+	{
+		int k = s.page2index.find(page_key(file_id, page_id));
+		hit = k >= 0;
+		if(hit) return s.begin + k;
+		int index = install(lock, s, file_id, page_id);
+		if(index >= 0) return index;
+		if(index == -1)
+		{
+			if(std::chrono::steady_clock::now() >= deadline)
+				return -1;
+			// pages are unpinned without the latch, look again later
+			lock.unlock();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			lock.lock();
+		}
+	}
+}
+
+page_guard page_fs::read(int file_id, int page_id, bool for_write)
 {
 	assert(fm.is_used(file_id));
 	assert(1 <= page_id && page_id <= file_info[file_id].page_num);
 
-	file_page_t key = { file_id, page_id };
-	auto it = page2index.find(key);
-	if(it == page2index.end())
+	page_guard guard;
+	bool hit;
+	{
+		shard_t &s = shard_of(file_id, page_id);
+		std::unique_lock<std::mutex> lock(s.latch);
+
+		int index = lookup(lock, s, file_id, page_id, hit);
+		if(index < 0)
+		{
+			std::fprintf(stderr, "[Error] all pages in buffer pool are pinned, page %d of file %d is not read.\n",
+				page_id, file_id);
+			return guard;
+		}
+
+		if(hit)
+		{
+			s.policy->access(index - s.begin);
+			++s.stats.hits;
+		} else {
+			// read with the latch dropped, whoever finds the page meanwhile waits
+			++s.stats.misses;
+			loading[index] = 1;
+		}
+
+		// pinned under the shard latch, so the frame cannot be evicted in between
+		guard = page_guard(this, index, frame(index), files[file_id].get_page_size());
+	}
+
+	if(!hit)
+	{
+		if(!files[file_id].read_page(page_id, guard.get()) || !decompress_page(file_id, guard.get()))
+			std::fprintf(stderr, "[Error] fail to read page %d of file %d.\n", page_id, file_id);
+		{
+			std::lock_guard<std::mutex> lock(load_latch);
+			loading[guard.index] = 0;
+		}
+		load_done.notify_all();
+	} else if(loading[guard.index]) {
+		// the page may still be on its way in from a prefetch or a miss
+		wait_loaded(guard.index);
+	}
+
+	// not before the page is in, see `set_dirty`
+	if(for_write) set_dirty(guard.index);
+	return guard;
+}
+
+/* Take a frame for the newly allocated page and zero it instead of
+ * reading it. The page reaches the file when the frame is written.
+ * An empty guard if all the frames of the shard stay pinned. */
+page_guard page_fs::create(int file_id, int page_id)
+{
+	page_guard guard;
+	{
+		shard_t &s = shard_of(file_id, page_id);
+		std::unique_lock<std::mutex> lock(s.latch);
+
+		// a readahead may have seen the page first
+		bool hit;
+		int index = lookup(lock, s, file_id, page_id, hit);
+		if(index < 0)
+		{
+			std::fprintf(stderr, "[Error] all pages in buffer pool are pinned, page %d of file %d is not created.\n",
+				page_id, file_id);
+			return guard;
+		}
+
+		guard = page_guard(this, index, frame(index), files[file_id].get_page_size());
+	}
+
+	if(loading[guard.index])
+		wait_loaded(guard.index);
+	// the frame may not hold the page, the file does
+	if(snapshot_active)
+		preserve(file_id, page_id, nullptr);
+	std::memset(guard.get(), 0, guard.size());
+	set_dirty(guard.index);
+	return guard;
+}
+
+int page_fs::prefetch(int file_id, const int *page_ids, int num, io_batch *batch)
+{
+	assert(fm.is_used(file_id));
+
+	std::vector<io_request*> reqs;
+	for(int i = 0; i != num; ++i)
+	{
+		int page_id = page_ids[i];
+		if(page_id < 1 || page_id > file_info[file_id].page_num)
+			continue;
+
+		shard_t &s = shard_of(file_id, page_id);
+		std::unique_lock<std::mutex> lock(s.latch);
+		int index = -2;
+		while(!s.page2index.contains(page_key(file_id, page_id))
+			&& (index = install(lock, s, file_id, page_id)) == -2);
+
+		// a prefetch is only a hint, give up if every frame is pinned
+		if(index < 0) continue;
+
+		++s.stats.prefetches;
+		loading[index] = 1;
+		++pin_count[index];
+		reqs.push_back(frame_request(index, file_id, page_id, false, batch));
+	}
+
+	if(!reqs.empty())
+	{
+		if(batch) batch->add((int)reqs.size());
+		get_aio()->submit(reqs.data(), (int)reqs.size());
+	}
+
+	return (int)reqs.size();
+}
+
+void page_fs::read_batch(int file_id, const int *page_ids, int num, page_guard *pages)
+{
+	prefetch(file_id, page_ids, num);
+	for(int i = 0; i != num; ++i)
+		pages[i] = read(file_id, page_ids[i]);
+}
+
+io_request* page_fs::frame_request(int index, int file_id, int page_id, bool write, io_batch *batch)
+{
+	frame_io_t &f = frame_io[index];
+	f.req.file   = files + file_id;
+	f.req.offset = (std::int64_t)files[file_id].get_page_size() * page_id;
+	f.req.buf    = frame(index);
+	f.req.size   = files[file_id].get_page_size();
+	f.req.write  = write;
+	f.req.result = false;
+	f.req.done   = io_complete;
+	f.req.data   = this;
+	f.batch = batch;
+	return &f.req;
+}
+
+/* called from an I/O thread, the frame was pinned by the submitter */
+void page_fs::io_complete(io_request *req)
+{
+	page_fs *fs = (page_fs*)req->data;
+	frame_io_t *f = reinterpret_cast<frame_io_t*>(req);
+	int index = (int)(f - fs->frame_io);
+	io_batch *batch = f->batch;
+	if(req->result && !req->write)
+		req->result = fs->decompress_page((int)(req->file - fs->files), (char*)req->buf);
+
+	if(!req->result)
+	{
+		std::fprintf(stderr, "[Error] fail to %s page %d.\n",
+			req->write ? "write" : "read", (int)(req->offset / req->size));
+	}
+
+	// the frame may be reused at once after unpinning it
+	if(!req->write)
 	{
-		// not in cache
-		free_last_cache();
-		index = cm.last();
-		cm.access(index);
-		dirty[index] = 0;
-		page2index[key] = index;
-		assert(!index2page[index].first && !index2page[index].second);
-		index2page[index] = key;
+		{
+			// unpinned under the latch, so the frame is no longer
+			// pinned by the read when `wait_loaded` returns
+			std::lock_guard<std::mutex> lock(fs->load_latch);
+			fs->loading[index] = 0;
+			--fs->pin_count[index];
+		}
+		fs->load_done.notify_all();
+	} else {
+		--fs->pin_count[index];
+	}
+
+	if(batch) batch->finish();
+}
 
-		std::fseek(files[file_id], (long)PAGE_SIZE * page_id, SEEK_SET);
-		std::fread(buffer + index * PAGE_SIZE, PAGE_SIZE, 1, files[file_id]);
-	} else cm.access(index = it->second);
-	return buffer + index * PAGE_SIZE;
+void page_fs::wait_loaded(int index)
+{
+	std::unique_lock<std::mutex> lock(load_latch);
+	load_done.wait(lock, [this, index] { return !loading[index]; });
 }
 
 void page_fs::mark_dirty(int file_id, int page_id)
 {
 	assert(fm.is_used(file_id));
 	assert(1 <= page_id && page_id <= file_info[file_id].page_num);
-	dirty[page2index[ file_page_t(file_id, page_id) ]] = 1;
+	shard_t &s = shard_of(file_id, page_id);
+	std::lock_guard<std::mutex> lock(s.latch);
+	int k = s.page2index.find(page_key(file_id, page_id));
+	assert(k >= 0);
+	set_dirty(s.begin + k);
+}
+
+/* The frame is pinned or the shard latch is held, so that it keeps its
+ * page. Once dirty, only writing the page makes it clean again. While
+ * logging, the page is also to be logged again, even if still dirty.
+ * The pages of a snapshot were clean when it was taken, so a clean page
+ * may be changing for the first time since. */
+void page_fs::set_dirty(int index)
+{
+	if(snapshot_active && !dirty[index])
+	{
+		file_page_t key = index2page[index];
+		// a page being read in has nothing in its frame yet
+		preserve(key.first, key.second, loading[index] ? nullptr : frame(index));
+	}
+	bool log_change = logging;
+	if(dirty[index] && (!log_change || unlogged[index]))
+		return;
+	file_page_t key = index2page[index];
+	file_pages_t &f = file_pages[key.first];
+	std::lock_guard<std::mutex> lock(f.latch);
+	bool changed = false;
+	if(!dirty[index])
+	{
+		dirty[index] = 1;
+		f.dirty.insert(key.second);
+		changed = true;
+	}
+	if(log_change && !unlogged[index])
+	{
+		unlogged[index] = 1;
+		f.unlogged.insert(key.second);
+		log_pending = true;
+		changed = true;
+	}
+	if(changed)
+		++dirtied_pages;
+}
+
+/* The shard latch is held. A page changed since it was logged is
+ * logged now, before it can leave the frame, unless its change is
+ * dropped (`log_change` false). */
+void page_fs::set_clean(int index, bool log_change)
+{
+	file_page_t key = index2page[index];
+	if(unlogged[index] && log_change)
+		log_page(key.first, key.second, frame(index));
+
+	file_pages_t &f = file_pages[key.first];
+	std::lock_guard<std::mutex> lock(f.latch);
+	dirty[index] = 0;
+	f.dirty.erase(key.second);
+	if(unlogged[index])
+	{
+		unlogged[index] = 0;
+		f.unlogged.erase(key.second);
+	}
 }
 
 void page_fs::write_page_to_file(int file_id, int page_id, const char* data)
@@ -144,32 +1336,675 @@ void page_fs::write_page_to_file(int file_id, int page_id, const char* data)
 	assert(fm.is_used(file_id));
 	assert(1 <= page_id && page_id <= file_info[file_id].page_num);
 
-	std::fseek(files[file_id], (long)PAGE_SIZE * page_id, SEEK_SET);
-	std::fwrite(data, PAGE_SIZE, 1, files[file_id]);
+	bool ok;
+	int page_size = files[file_id].get_page_size();
+	int size = compress_page(file_id, data, codec_buffer);
+	if(size < page_size)
+	{
+		std::int64_t offset = (std::int64_t)page_size * page_id;
+		ok = files[file_id].write(offset, codec_buffer, size);
+		files[file_id].punch_hole(offset + size, page_size - size);
+	} else ok = files[file_id].write_page(page_id, data);
+
+	if(!ok)
+		std::fprintf(stderr, "[Error] fail to write page %d of file %d.\n", page_id, file_id);
+}
+
+bool page_fs::set_compression(int file_id, bool enable)
+{
+	assert(fm.is_used(file_id));
+	// a compressed page takes one block less at least, see `compress_page`
+	if(enable && files[file_id].get_page_size() <= PAGE_COMPRESS_BLOCK)
+		return false;
+	// pages compressed so far stay so until they are written again
+	compress[file_id] = enable ? 1 : compress[file_id] ? 2 : 0;
+	std::lock_guard<std::mutex> lock(meta_latch);
+	file_info[file_id].compression = compress[file_id];
+	if(logging)
+	{
+		file_log[file_id].changed = true;
+		log_pending = true;
+	}
+	return true;
+}
+
+/* Compress the page into `out` if the file is compressed and it saves
+ * a block at least. Return the number of bytes to write from `out`,
+ * or the page size if the page is to be written as it is. */
+int page_fs::compress_page(int file_id, const char *page, char *out)
+{
+	int page_size = files[file_id].get_page_size();
+	if(compress[file_id] != 1)
+		return page_size;
+
+	auto begin = std::chrono::steady_clock::now();
+	const int header_size = sizeof(page_zip_header_t);
+	int capacity = page_size - PAGE_COMPRESS_BLOCK - header_size;
+	int size = capacity > 0 ? lz_codec::compress(page, page_size, out + header_size, capacity) : 0;
+	int stored = page_size;
+	if(size)
+	{
+		page_zip_header_t header = { PAGE_COMPRESSED, (std::uint32_t)size };
+		std::memcpy(out, &header, header_size);
+		stored = (header_size + size + PAGE_COMPRESS_BLOCK - 1) / PAGE_COMPRESS_BLOCK * PAGE_COMPRESS_BLOCK;
+		std::memset(out + header_size + size, 0, stored - header_size - size);
+	}
+
+	++zip_pages;
+	zip_raw_bytes += page_size;
+	zip_stored_bytes += stored;
+	zip_ns += ns_since(begin);
+	return stored;
+}
+
+/* Undo the compression of a page just read, pages stored as they are
+ * are left alone, as are all pages of a file never compressed. False
+ * if the page is corrupted. */
+bool page_fs::decompress_page(int file_id, char *page)
+{
+	if(!compress[file_id])
+		return true;
+	page_zip_header_t header;
+	std::memcpy(&header, page, sizeof(header));
+	if(header.magic != PAGE_COMPRESSED)
+		return true;
+
+	auto begin = std::chrono::steady_clock::now();
+	int page_size = files[file_id].get_page_size();
+	if(header.size > page_size - sizeof(header))
+		return false;
+	std::memcpy(codec_buffer, page + sizeof(header), header.size);
+	int size = lz_codec::decompress(codec_buffer, header.size, page, page_size);
+
+	++unzip_pages;
+	unzip_ns += ns_since(begin);
+	return size == page_size;
+}
+
+static bool file_exists(const std::string &filename)
+{
+	std::FILE *f = std::fopen(filename.c_str(), "rb");
+	if(f) std::fclose(f);
+	return f != nullptr;
+}
+
+static bool sync_file(const std::string &filename)
+{
+	file_io f;
+	bool created;
+	return f.open(filename.c_str(), false, created) && f.sync();
+}
+
+void page_fs::log_file_name(int file_id)
+{
+	if(log_named[file_id].exchange(1))
+		return;
+	page_log_file_t rec = { file_id, files[file_id].get_page_size() };
+	const std::string &name = file_names[file_id];
+	log.append(LOG_FILE, &rec, sizeof(rec), name.data(), name.size());
+}
+
+/* Log the page as it is now, compressed if that saves anything. */
+void page_fs::log_page(int file_id, int page_id, const char *data)
+{
+	log_file_name(file_id);
+	int page_size = files[file_id].get_page_size();
+	int size = lz_codec::compress(data, page_size, codec_buffer, page_size - 1);
+	page_log_page_t rec = { file_id, page_id, size ? size : page_size };
+	log.append(LOG_PAGE, &rec, sizeof(rec), size ? codec_buffer : data, rec.size);
+}
+
+/* Log the free-map changes of the file. `meta_latch` is held. */
+void page_fs::log_meta(int file_id)
+{
+	file_log_t &m = file_log[file_id];
+	if(!m.changed)
+		return;
+	log_file_name(file_id);
+	page_log_meta_t rec = { file_id, file_info[file_id].page_num, m.truncated,
+		compress[file_id], (int)m.ops.size() };
+	log.append(LOG_META, &rec, sizeof(rec), m.ops.data(), m.ops.size() * sizeof(int));
+	m.changed = m.truncated = false;
+	m.ops.clear();
+}
+
+void page_fs::commit()
+{
+	if(!logging || !log_pending.exchange(false))
+		return;
+
+	for(int fid = 1; fid <= MAX_FILE_ID; ++fid)
+	{
+		{
+			std::lock_guard<std::mutex> lock(meta_latch);
+			if(!fm.is_used(fid))
+				continue;
+			// before the pages, they may lie past the end the file had
+			log_meta(fid);
+		}
+
+		file_pages_t &f = file_pages[fid];
+		std::vector<int> page_ids;
+		{
+			std::lock_guard<std::mutex> lock(f.latch);
+			page_ids.assign(f.unlogged.begin(), f.unlogged.end());
+		}
+		for(int page_id : page_ids)
+		{
+			shard_t &s = shard_of(fid, page_id);
+			std::lock_guard<std::mutex> lock(s.latch);
+			int k = s.page2index.find(page_key(fid, page_id));
+			// logged when it left the frame
+			if(k < 0 || !unlogged[s.begin + k])
+				continue;
+			int i = s.begin + k;
+			log_page(fid, page_id, frame(i));
+			std::lock_guard<std::mutex> file_lock(f.latch);
+			unlogged[i] = 0;
+			f.unlogged.erase(page_id);
+		}
+	}
+
+	log.commit();
+	if(log.size() >= PAGE_LOG_CHECKPOINT_SIZE)
+		checkpoint();
+}
+
+void page_fs::checkpoint()
+{
+	if(!logging)
+		return;
+
+	std::lock_guard<std::mutex> writer_lock(writer_latch);
+	for(int fid = 1; fid <= MAX_FILE_ID; ++fid)
+	{
+		if(!fm.is_used(fid))
+			continue;
+		flush(fid);
+		if(!files[fid].sync())
+			std::fprintf(stderr, "[Error] fail to sync file %s.\n", file_names[fid].c_str());
+	}
+
+	std::set<std::string> names;
+	{
+		std::lock_guard<std::mutex> lock(log_files_latch);
+		names.swap(log_files);
+	}
+	for(const std::string &name : names)
+	{
+		if(!sync_file(name))
+			std::fprintf(stderr, "[Error] fail to sync file %s.\n", name.c_str());
+	}
+
+	// the files hold everything the log does
+	if(!log.truncate())
+		std::fprintf(stderr, "[Error] fail to truncate the log.\n");
+	for(auto &c : log_named)
+		c = 0;
+}
+
+bool page_fs::open_log(const char *path)
+{
+	assert(!logging);
+	// log file id -> name, files opened to redo changes
+	std::unordered_map<int, std::string> names;
+	std::unordered_map<std::string, int> opened;
+	std::set<std::string> images;
+
+	auto close_file = [&](std::string name) {
+		auto it = opened.find(name);
+		if(it == opened.end())
+			return;
+		close(it->second);
+		opened.erase(it);
+		if(!sync_file(name))
+			std::fprintf(stderr, "[Error] fail to sync file %s.\n", name.c_str());
+	};
+
+	auto file_of = [&](int log_id) {
+		auto it = names.find(log_id);
+		if(it == names.end())
+			return 0;
+		const std::string &name = it->second;
+		auto o = opened.find(name);
+		if(o != opened.end())
+			return o->second;
+		// removed later on, nothing of it is left to redo
+		if(!file_exists(name))
+			return 0;
+		int fid = open(name.c_str());
+		if(fid) opened[name] = fid;
+		return fid;
+	};
+
+	int groups = page_log::replay(path, [&](int type, const char *data, std::size_t size) {
+		switch(type)
+		{
+			case LOG_FILE:
+			case LOG_CREATE: {
+				page_log_file_t rec;
+				std::memcpy(&rec, data, sizeof(rec));
+				if(type == LOG_FILE)
+				{
+					names[rec.file_id] = std::string(data + sizeof(rec), size - sizeof(rec));
+					break;
+				}
+				auto it = names.find(rec.file_id);
+				if(it == names.end())
+					break;
+				// the changes logged from here on make up the file
+				std::string name = it->second;
+				close_file(name);
+				std::remove(name.c_str());
+				int fid = open(name.c_str(), rec.page_size);
+				if(fid) opened[name] = fid;
+				break;
+			}
+			case LOG_META: {
+				page_log_meta_t rec;
+				std::memcpy(&rec, data, sizeof(rec));
+				std::vector<int> ops(rec.op_num);
+				std::memcpy(ops.data(), data + sizeof(rec), ops.size() * sizeof(int));
+				if(int fid = file_of(rec.file_id))
+					redo_meta(fid, rec, ops.data());
+				break;
+			}
+			case LOG_PAGE: {
+				page_log_page_t rec;
+				std::memcpy(&rec, data, sizeof(rec));
+				int fid = file_of(rec.file_id);
+				if(!fid)
+					break;
+				int page_size = files[fid].get_page_size();
+				const char *page = data + sizeof(rec);
+				if(rec.size != page_size)
+				{
+					if(lz_codec::decompress(page, rec.size, codec_buffer, page_size) != page_size)
+					{
+						std::fprintf(stderr, "[Error] bad log record of page %d of %s.\n",
+							rec.page_id, file_names[fid].c_str());
+						break;
+					}
+					page = codec_buffer;
+				}
+				redo_page(fid, rec.page_id, page);
+				break;
+			}
+			case LOG_IMAGE: {
+				std::string name(data);
+				std::size_t skip = name.size() + 1;
+				std::FILE *f = std::fopen(name.c_str(), "wb");
+				if(!f || std::fwrite(data + skip, 1, size - skip, f) != size - skip)
+					std::fprintf(stderr, "[Error] fail to write file %s.\n", name.c_str());
+				if(f) std::fclose(f);
+				images.insert(name);
+				break;
+			}
+			case LOG_REMOVE: {
+				std::string name(data, size);
+				close_file(name);
+				std::remove(name.c_str());
+				images.erase(name);
+				break;
+			}
+			case LOG_RENAME: {
+				std::string from(data);
+				std::string to(data + from.size() + 1, size - from.size() - 1);
+				close_file(from);
+				close_file(to);
+				if(file_exists(from))
+				{
+					std::remove(to.c_str());
+					std::rename(from.c_str(), to.c_str());
+				}
+				if(images.erase(from))
+					images.insert(to);
+				break;
+			}
+		}
+	} );
+
+	// make what was redone durable before the log is emptied
+	while(!opened.empty())
+		close_file(opened.begin()->first);
+	for(const std::string &name : images)
+	{
+		if(file_exists(name) && !sync_file(name))
+			std::fprintf(stderr, "[Error] fail to sync file %s.\n", name.c_str());
+	}
+	if(groups > 0)
+		std::fprintf(stderr, "[Info] redid %d commits from the log.\n", groups);
+
+	if(!log.open(path))
+	{
+		std::fprintf(stderr, "[Error] fail to open the log %s.\n", path);
+		return false;
+	}
+	logging = true;
+	return true;
+}
+
+void page_fs::redo_meta(int file_id, const page_log_meta_t &meta, const int *ops)
+{
+	std::lock_guard<std::mutex> lock(meta_latch);
+	page_fs_header_t &info = file_info[file_id];
+	free_map &map = free_maps[file_id];
+	if(meta.truncated)
+	{
+		for(int page_id = meta.page_num + 1; page_id <= info.page_num; ++page_id)
+			discard(file_id, page_id);
+		info.page_num = meta.page_num;
+		map.mark_dirty();
+	} else info.page_num = std::max(info.page_num, meta.page_num);
+	map.resize(info.page_num);
+	std::vector<int> map_pages;
+	for(int g = 0; g != map.get_groups(); ++g)
+	{
+		if(map.map_page(g) > info.page_num)
+			map.map_page(g) = 0;
+		map_pages.push_back(map.map_page(g));
+	}
+	compress[file_id] = meta.compression;
+	info.compression = meta.compression;
+
+	for(int i = 0; i != meta.op_num; ++i)
+	{
+		int page_id = std::abs(ops[i]);
+		bool free = ops[i] > 0;
+		if(page_id < 1 || page_id > info.page_num || map.is_free(page_id) == free
+			|| std::find(map_pages.begin(), map_pages.end(), page_id) != map_pages.end())
+			continue;
+		if(free) map.set_free(page_id);
+		else map.set_used(page_id);
+	}
+}
+
+void page_fs::redo_page(int file_id, int page_id, const char *data)
+{
+	{
+		std::lock_guard<std::mutex> lock(meta_latch);
+		page_fs_header_t &info = file_info[file_id];
+		if(page_id > info.page_num)
+		{
+			info.page_num = page_id;
+			free_maps[file_id].resize(page_id);
+		}
+	}
+
+	page_guard guard = create(file_id, page_id);
+	if(guard) std::memcpy(guard.get(), data, guard.size());
+	else write_page_to_file(file_id, page_id, data);
+}
+
+bool page_fs::write_file(const char *filename, const void *data, std::size_t size)
+{
+	if(logging)
+	{
+		log.append(LOG_IMAGE, filename, std::strlen(filename) + 1, data, size);
+		log_pending = true;
+		std::lock_guard<std::mutex> lock(log_files_latch);
+		log_files.insert(filename);
+	}
+
+	std::FILE *f = std::fopen(filename, "wb");
+	if(!f)
+		return false;
+	bool ok = std::fwrite(data, 1, size, f) == size;
+	return std::fclose(f) == 0 && ok;
 }
 
-void page_fs::free_last_cache()
+bool page_fs::remove_file(const char *filename)
 {
-	int last = cm.last();
-	file_page_t key = index2page[last];
+	if(logging)
+	{
+		log.append(LOG_REMOVE, filename, std::strlen(filename));
+		log_pending = true;
+		std::lock_guard<std::mutex> lock(log_files_latch);
+		log_files.erase(filename);
+	}
+	return std::remove(filename) == 0;
+}
+
+bool page_fs::rename_file(const char *from, const char *to)
+{
+	if(logging)
+	{
+		log.append(LOG_RENAME, from, std::strlen(from) + 1, to, std::strlen(to));
+		log_pending = true;
+		std::lock_guard<std::mutex> lock(log_files_latch);
+		if(log_files.erase(from))
+			log_files.insert(to);
+	}
+	return std::rename(from, to) == 0;
+}
+
+bool page_fs::begin_snapshot(const int *file_ids, int num)
+{
+	std::lock_guard<std::mutex> writer_lock(writer_latch);
+	{
+		std::lock_guard<std::mutex> lock(snapshot_latch);
+		if(snapshot_active)
+			return false;
+	}
+
+	std::unordered_map<int, snapshot_file_t> snapshot;
+	for(int i = 0; i != num; ++i)
+	{
+		int fid = file_ids[i];
+		assert(fm.is_used(fid));
+		// from now on the file has each page until it changes
+		flush(fid);
+
+		std::lock_guard<std::mutex> lock(meta_latch);
+		const page_fs_header_t &info = file_info[fid];
+		snapshot_file_t &f = snapshot[fid];
+		f.page_num = info.page_num;
+		f.copied.assign(info.page_num + 1, 0);
+
+		// the header and the free map are written outside of the pool,
+		// so they are kept at once
+		std::vector<int> page_ids(1, 0);
+		for(int g = 0; g < free_maps[fid].get_groups() && g < PAGE_FREEMAP_MAX_NUM; ++g)
+		{
+			int page_id = free_maps[fid].map_page(g);
+			if(page_id && page_id <= info.page_num)
+				page_ids.push_back(page_id);
+		}
+		for(int page_id : page_ids)
+		{
+			if(!files[fid].read_page(page_id, tmp_buffer))
+			{
+				std::fprintf(stderr, "[Error] fail to read page %d of file %s.\n", page_id, file_names[fid].c_str());
+				return false;
+			}
+			f.preserved[page_id].assign(tmp_buffer, tmp_buffer + info.page_size);
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(snapshot_latch);
+	snapshot_files.swap(snapshot);
+	snapshot_active = !snapshot_files.empty();
+	return true;
+}
+
+std::int64_t page_fs::copy_snapshot(int file_id, const char *path)
+{
+	int page_num;
+	{
+		std::lock_guard<std::mutex> lock(snapshot_latch);
+		auto it = snapshot_files.find(file_id);
+		if(it == snapshot_files.end())
+			return -1;
+		page_num = it->second.page_num;
+	}
+
+	file_io out;
+	bool created;
+	if(!out.open(path, false, created) || !out.truncate(0))
+	{
+		release_snapshot(file_id);
+		return -1;
+	}
+
+	// whole pages at a time, aligned for direct I/O
+	int page_size = files[file_id].get_page_size();
+	int run = std::max(1, PAGE_BACKUP_READ_SIZE / page_size);
+	std::size_t bytes = (std::size_t)run * page_size;
+	char *buf = map_frames(bytes);
+	bool ok = buf != nullptr;
+	for(int first = 0; ok && first <= page_num; first += run)
+	{
+		int n = std::min(run, page_num + 1 - first);
+		std::int64_t offset = (std::int64_t)page_size * first;
+		ok = files[file_id].read(offset, buf, (std::size_t)page_size * n);
+
+		// a page which changed after the read was kept before it did
+		{
+			std::lock_guard<std::mutex> lock(snapshot_latch);
+			auto snapshot = snapshot_files.find(file_id);
+			if(snapshot == snapshot_files.end())
+				break;   // ended meanwhile
+			snapshot_file_t &f = snapshot->second;
+			for(int i = 0; i != n; ++i)
+			{
+				auto it = f.preserved.find(first + i);
+				if(it != f.preserved.end())
+				{
+					std::memcpy(buf + (std::size_t)i * page_size, it->second.data(), page_size);
+					f.preserved.erase(it);
+				}
+				f.copied[first + i] = 1;
+			}
+		}
+
+		ok = ok && out.write(offset, buf, (std::size_t)page_size * n);
+	}
+	ok = ok && out.sync();
+
+	if(buf) unmap_frames(buf, bytes);
+	release_snapshot(file_id);
+	if(!ok)
+	{
+		std::fprintf(stderr, "[Error] fail to copy file %s to %s.\n", file_names[file_id].c_str(), path);
+		return -1;
+	}
+	return (std::int64_t)page_size * (page_num + 1);
+}
+
+void page_fs::end_snapshot()
+{
+	std::lock_guard<std::mutex> lock(snapshot_latch);
+	snapshot_files.clear();
+	snapshot_active = false;
+	snapshot_released.notify_all();
+}
+
+void page_fs::release_snapshot(int file_id)
+{
+	std::lock_guard<std::mutex> lock(snapshot_latch);
+	snapshot_files.erase(file_id);
+	snapshot_active = !snapshot_files.empty();
+	snapshot_released.notify_all();
+}
+
+/* Keep the page as it was at the snapshot if it is about to change for
+ * the first time and was not copied yet. `data` is the frame if it holds
+ * the page, otherwise the file still does, as the page was written back
+ * at the snapshot and not written since. */
+void page_fs::preserve(int file_id, int page_id, const char *data)
+{
+	auto begin = std::chrono::steady_clock::now();
+	auto to_keep = [this, file_id, page_id]() -> snapshot_file_t* {
+		auto it = snapshot_files.find(file_id);
+		if(it == snapshot_files.end())
+			return nullptr;
+		snapshot_file_t &f = it->second;
+		if(page_id > f.page_num || f.copied[page_id] || f.preserved.count(page_id))
+			return nullptr;
+		return &f;
+	};
+
+	std::unique_lock<std::mutex> lock(snapshot_latch);
+	snapshot_file_t *f = to_keep();
+	if(!f) return;
+	int page_size = files[file_id].get_page_size();
+	std::vector<char> page;
+	if(data)
+	{
+		page.assign(data, data + page_size);
+	} else {
+		// the backup goes on meanwhile, the page is read into a buffer
+		// of this call, aligned for direct I/O
+		alignas(PAGE_SIZE) char buf[PAGE_MAX_SIZE];
+		lock.unlock();
+		if(!files[file_id].read_page(page_id, buf))
+			std::fprintf(stderr, "[Error] fail to read page %d of file %d.\n", page_id, file_id);
+		page.assign(buf, buf + page_size);
+		lock.lock();
+		if(!(f = to_keep()))
+			return;
+	}
+
+	f->preserved.emplace(page_id, std::move(page));
+	++cow_pages;
+	cow_ns += ns_since(begin);
+}
+
+/* the shard latch is held, `index` is relative to the shard */
+void page_fs::evict(shard_t &s, int index)
+{
+	int i = s.begin + index;
+	file_page_t key = index2page[i];
 	if(key.first != 0)
 	{
-		if(dirty[last])
+		if(dirty[i])
 		{
 			debug_printf("Free cache and writeback: fid = %d, pid = %d\n", key.first, key.second);
-			write_page_to_file(key.first, key.second, buffer + last * PAGE_SIZE);
+			write_page_to_file(key.first, key.second, frame(i));
+			++s.stats.writes;
+			set_clean(i);
+			// the background writer is behind
+			writer_wake.notify_one();
 		}
 
-		page2index.erase(page2index.find(key));
-		index2page[last] = { 0, 0 };
+		{
+			file_pages_t &f = file_pages[key.first];
+			std::lock_guard<std::mutex> lock(f.latch);
+			f.cached.erase(key.second);
+		}
+		s.page2index.erase(page_key(key.first, key.second));
+		index2page[i] = { 0, 0 };
+		s.policy->remove(index);
 	}
 }
 
 page_fs::~page_fs()
 {
+	{
+		std::lock_guard<std::mutex> lock(writer_wake_latch);
+		writer_stop = true;
+	}
+	writer_wake.notify_one();
+	writer.join();
+
 	for(int i = 1; i <= MAX_FILE_ID; ++i)
 	{
 		if(fm.is_used(i))
 			close(i);
 	}
+	log.close();
+
+	if(writer_buffer) unmap_frames(writer_buffer, writer_buffer_bytes);
+
+	delete aio;
+	if(buffer) unmap_frames(buffer, buffer_bytes);
+	for(shard_t &s : shards)
+		delete s.policy;
+	delete[] dirty;
+	delete[] unlogged;
+	delete[] pin_count;
+	delete[] frame_latches;
+	delete[] index2page;
+	delete[] frame_io;
+	delete[] loading;
 }
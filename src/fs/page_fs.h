@@ -3,52 +3,304 @@
 
 #include <utility>
 #include <cstdio>
+#include <cstdint>
 #include <unordered_map>
+#include <unordered_set>
+#include <set>
+#include <string>
+#include <cassert>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
 
 #include "../defs.h"
 #include "fid_manager.h"
-#include "cache_manager.h"
+#include "free_map.h"
+#include "file_io.h"
+#include "async_io.h"
+#include "cache_policy.h"
+#include "page_table.h"
+#include "page_log.h"
 
-/* The first page is file info, not counted into `page_num`
- * `first_freepage` indicates the first freepage if it is not zero
- * and there is no freepage if it is zero */
+/* The first page is file info, not counted into `page_num`. The
+ * header is followed by the ids of the `freemap_num` free-map pages,
+ * see `free_map`. `first_freepage` heads the free-page list of files
+ * written by older versions, it is turned into the free map on open
+ * and is zero afterwards. `page_size` is chosen when the file is
+ * created, 0 in older files means PAGE_SIZE. Only the first PAGE_SIZE
+ * bytes of the header page and of the free-map pages are used, so
+ * they read the same whatever the page size. `compression` is 1 if
+ * pages are written compressed, 2 if they were before but are not any
+ * more, so that some may still be stored compressed. */
 struct page_fs_header_t
 {
 	int page_num;
 	int first_freepage;
+	int freemap_num;
+	int page_size;
+	int compression;
 };
 
+/* A compressed page on disk: this header, the compressed bytes (see
+ * `lz_codec`) and zeros up to a multiple of PAGE_COMPRESS_BLOCK. The
+ * rest of the page is a hole in the file. */
+struct page_zip_header_t
+{
+	std::uint32_t magic;   // PAGE_COMPRESSED
+	std::uint32_t size;    // of the compressed bytes
+};
+
+#define PAGE_FREEMAP_MAX_NUM ((int)((PAGE_SIZE - sizeof(page_fs_header_t)) / sizeof(int)))
+
+struct page_fs_stats_t
+{
+	std::uint64_t hits, misses;
+	std::uint64_t writes;
+	// pages read ahead of use, not counted into `misses`
+	std::uint64_t prefetches;
+	// pages written by the background writer, counted into `writes`
+	std::uint64_t bg_writes;
+	// page table lookups and the slots they probed
+	std::uint64_t lookups, probes;
+	// pages of compressed files written, their bytes and the bytes
+	// stored on disk, the time spent compressing them
+	std::uint64_t compress_pages, compress_raw_bytes, compress_stored_bytes, compress_ns;
+	// compressed pages read and the time spent decompressing them
+	std::uint64_t decompress_pages, decompress_ns;
+	// commits, syncs and bytes of the write-ahead log
+	std::uint64_t log_commits, log_syncs, log_bytes;
+	// pages kept for a snapshot when they changed, and the time it took
+	std::uint64_t snapshot_cow_pages, snapshot_cow_ns;
+	// pages marked changed while clean or logged, each of which is
+	// written back or logged again
+	std::uint64_t pages_dirtied;
+};
+
+class page_fs;
+
+/* A pinned page in the buffer pool. The frame cannot be evicted
+ * while any guard of it is alive, so the buffer stays valid. Copying
+ * a guard pins the frame again.
+ * Pinning does not lock the content of the page, code which shares
+ * pages between threads takes the frame latch, e.g.
+ * `std::shared_lock<std::shared_mutex> lock(guard.latch());` */
+class page_guard
+{
+	friend class page_fs;
+	page_fs *fs;
+	int index;
+	char *buf;
+	int page_size;
+
+	page_guard(page_fs *fs, int index, char *buf, int page_size);
+	void pin();
+	void unpin();
+public:
+	page_guard() : fs(nullptr), index(-1), buf(nullptr), page_size(0) {}
+	page_guard(const page_guard &other);
+	page_guard(page_guard &&other) noexcept;
+	page_guard& operator = (const page_guard &other);
+	page_guard& operator = (page_guard &&other) noexcept;
+	~page_guard() { unpin(); }
+
+	char* get() const { return buf; }
+	/* page size of the file, the frame may be larger */
+	int size() const { return page_size; }
+	explicit operator bool () const { return buf != nullptr; }
+	void mark_dirty();
+	std::shared_mutex& latch() const;
+	void release() { unpin(); }
+};
+
+/* The buffer pool is partitioned by the hash of (file_id, page_id) into
+ * `PAGE_CACHE_SHARDS` shards. Each shard owns a contiguous range of
+ * frames with its own page table and replacement policy, guarded by
+ * its own latch, so threads reading pages of different shards do not
+ * contend. All frames have the size of the largest pages opened so
+ * far, a file with smaller pages uses the beginning of each frame.
+ * Latch order: `writer_latch` -> `meta_latch` -> shard latch
+ * -> latch of `file_pages`, `evict_latch`. */
 class page_fs
 {
-	struct pair_hash
+	friend class page_guard;
+	typedef std::pair<int, int> file_page_t;
+
+	struct shard_t
 	{
-		template<typename T1, typename T2>
-		std::size_t operator () (const std::pair<T1, T2> &p) const {
-			return std::hash<T1>{}(p.first) ^ (std::hash<T2>{}(p.second) << 1);
-		}
+		std::mutex latch;
+		// frames [begin, begin + capacity)
+		int begin, capacity;
+		cache_policy *policy;
+		// page -> frame index relative to `begin`
+		page_table page2index;
+		page_fs_stats_t stats;
 	};
-private:
-	/* cache */
-	char dirty[PAGE_CACHE_CAPACITY];
-	char buffer[PAGE_CACHE_CAPACITY * PAGE_SIZE];
-	char tmp_buffer[PAGE_SIZE];
-	cache_manager cm;
 
-	typedef std::pair<int, int> file_page_t;
-	std::unordered_map<file_page_t, int, pair_hash> page2index;
+	/* pages of a file in the pool, so that flushing and closing the
+	 * file only visit its own pages. A page is in `dirty` iff its
+	 * frame is dirty, both change together under `latch`, likewise
+	 * `unlogged`, the dirty pages changed since they were logged. */
+	struct file_pages_t
+	{
+		std::mutex latch;
+		std::set<int> dirty;
+		std::set<int> unlogged;
+		std::unordered_set<int> cached;
+	};
+
+	/* free-map changes of a file not logged yet, see `page_log_meta_t` */
+	struct file_log_t
+	{
+		bool changed, truncated;
+		std::vector<int> ops;
+	};
+
+	/* a file in the snapshot, see `begin_snapshot`. Pages [0, page_num]
+	 * are copied, `copied` marks those copied already and `preserved`
+	 * holds the old content of the others which changed since. */
+	struct snapshot_file_t
+	{
+		int page_num;
+		std::vector<char> copied;
+		std::unordered_map<int, std::vector<char>> preserved;
+	};
+
+private:
+	/* cache, `buffer` is mapped on the first cache miss */
+	int capacity;
+	int frame_size;
+	shard_t shards[PAGE_CACHE_SHARDS];
+	std::atomic<char*> buffer;
+	std::size_t buffer_bytes;
+	std::mutex map_latch;
 
+	/* frames */
+	std::atomic<char> *dirty;
+	std::atomic<char> *unlogged;
+	std::atomic<int> *pin_count;
+	std::shared_mutex *frame_latches;
 	// cache is used if `first` != 0
-	file_page_t index2page[PAGE_CACHE_CAPACITY];
+	file_page_t *index2page;
+
+	/* asynchronous I/O, at most one transfer per frame is in flight
+	 * and the frame stays pinned until it completes */
+	struct frame_io_t
+	{
+		io_request req;
+		io_batch *batch;
+	} *frame_io;
+	async_io *aio;
+	std::once_flag aio_once;
+	// set while the page is being read into the frame
+	std::atomic<char> *loading;
+	std::mutex load_latch;
+	std::condition_variable load_done;
+
+	/* warmup, file name -> pages cached in the last run, read ahead
+	 * when the file is opened */
+	std::mutex warmup_latch;
+	std::unordered_map<std::string, std::vector<int>> warmup;
+
+	/* page compression, the setting of each file as in its header and
+	 * the counters of `page_fs_stats_t`, updated by whichever thread
+	 * does the I/O */
+	std::atomic<char> compress[MAX_FILE_ID + 1];
+	std::atomic<std::uint64_t> zip_pages, zip_raw_bytes, zip_stored_bytes, zip_ns;
+	std::atomic<std::uint64_t> unzip_pages, unzip_ns;
+
+	/* write-ahead log, changes are logged while it is open. A file id
+	 * is named in the log before its first record, `file_log` is
+	 * guarded by `meta_latch`. Small files written by `write_file` are
+	 * synced at the next checkpoint. */
+	page_log log;
+	std::atomic<bool> logging;
+	// something was logged since the last commit
+	std::atomic<bool> log_pending;
+	std::atomic<char> log_named[MAX_FILE_ID + 1];
+	file_log_t file_log[MAX_FILE_ID + 1];
+	std::mutex log_files_latch;
+	std::set<std::string> log_files;
+
+	/* snapshot of a backup, file id -> its state. `snapshot_latch`
+	 * comes after the shard latch. */
+	std::mutex snapshot_latch;
+	std::condition_variable snapshot_released;
+	std::atomic<bool> snapshot_active;
+	std::unordered_map<int, snapshot_file_t> snapshot_files;
+	std::atomic<std::uint64_t> cow_pages, cow_ns;
+	// see `page_fs_stats_t::pages_dirtied`
+	std::atomic<std::uint64_t> dirtied_pages;
+
+	/* background writer, `writer_latch` is held during a pass */
+	std::thread writer;
+	std::mutex writer_latch, writer_wake_latch;
+	// held shared by a miss writing its dirty victim, see `write_victim`
+	std::shared_mutex evict_latch;
+	std::condition_variable writer_wake;
+	bool writer_stop;
+	std::atomic<int> writer_clean_percent;
+	std::atomic<std::uint64_t> writer_rate;
+	// aligned staging buffer of the coalesced runs
+	char *writer_buffer;
+	std::size_t writer_buffer_bytes;
 
 	/* file */
+	std::mutex meta_latch;
 	fid_manager fm;
-	FILE *files[MAX_FILE_ID];
-	page_fs_header_t file_info[MAX_FILE_ID];
+	bool direct_io;
+	std::atomic<int> readahead;
+	std::atomic<int> extent;
+	file_io files[MAX_FILE_ID + 1];
+	page_fs_header_t file_info[MAX_FILE_ID + 1];
+	free_map free_maps[MAX_FILE_ID + 1];
+	// pages [0, file_end) are allocated on disk
+	int file_end[MAX_FILE_ID + 1];
+	// pages freed since the file was opened or last compacted
+	int freed_pages[MAX_FILE_ID + 1];
+	file_pages_t file_pages[MAX_FILE_ID + 1];
+	std::string file_names[MAX_FILE_ID + 1];
+	alignas(PAGE_SIZE) char tmp_buffer[PAGE_MAX_SIZE];
 
 private:
-	char* read(int file_id, int page_id, int& index);
-	void free_last_cache();
+	shard_t& shard_of(int file_id, int page_id);
+	char* frame(int index) const { return buffer.load(std::memory_order_relaxed) + (std::size_t)index * frame_size; }
+	page_guard read(int file_id, int page_id, bool for_write);
+	page_guard create(int file_id, int page_id);
+	int install(std::unique_lock<std::mutex> &lock, shard_t &shard, int file_id, int page_id);
+	int lookup(std::unique_lock<std::mutex> &lock, shard_t &shard, int file_id, int page_id, bool &hit);
+	void write_victim(std::unique_lock<std::mutex> &lock, shard_t &shard, int index);
+	void evict(shard_t &shard, int index);
+	void set_dirty(int index);
+	void set_clean(int index, bool log_change = true);
+	void flush(int file_id);
+	void drop(int file_id);
+	bool discard(int file_id, int page_id);
+	int shrink(int file_id);
+	void load_free_map(int file_id);
+	void write_header(int file_id);
+	void write_frames(std::vector<std::pair<file_page_t, int>> &pages);
+	async_io* get_aio();
+	io_request* frame_request(int index, int file_id, int page_id, bool write, io_batch *batch);
+	static void io_complete(io_request *req);
+	void wait_loaded(int index);
+	void writer_main();
+	int write_behind();
+	void map_buffer();
+	void layout_shards(int new_capacity);
+	bool relayout(int new_capacity, int new_frame_size);
 	void write_page_to_file(int file_id, int page_id, const char* data);
+	int compress_page(int file_id, const char *page, char *out);
+	bool decompress_page(int file_id, char *page);
+	void log_file_name(int file_id);
+	void log_page(int file_id, int page_id, const char *data);
+	void log_meta(int file_id);
+	void redo_meta(int file_id, const page_log_meta_t &meta, const int *ops);
+	void redo_page(int file_id, int page_id, const char *data);
+	void preserve(int file_id, int page_id, const char *data);
+	void release_snapshot(int file_id);
 
 private:
 	page_fs();
@@ -56,29 +308,133 @@ private:
 public:
 	~page_fs();
 
-	int open(const char* filename);
+	/* a new file gets pages of `page_size` bytes, PAGE_SIZE if 0.
+	 * Opening a file with larger pages than the frames enlarges the
+	 * frames, which writes back the whole pool, and no page may be
+	 * pinned then. The pool keeps its size in bytes. */
+	int open(const char* filename, int page_size = 0);
 	void close(int file_id);
+	/* bypass the OS page cache for files opened afterwards */
+	void set_direct_io(bool enable) { direct_io = enable; }
+	/* write the dirty pages of the file in page order, nobody may
+	 * be writing to its pages concurrently */
 	void writeback(int file_id);
 
-	/* allocate a new page */
-	int allocate(int file_id);
+	/* allocate a new page, the free page nearest to `hint` if any.
+	 * 0 if all the frames it could be cached in stay pinned. */
+	int allocate(int file_id, int hint = 0);
 	/* free an existed page */
 	void deallocate(int file_id, int page_id);
+	/* give the free pages at the end of the file back to the OS and
+	 * punch holes for the others. Return the number of pages cut off.
+	 * With `when_due` only if enough pages were freed since the last
+	 * time, see PAGE_COMPACT_MIN_FREE and PAGE_COMPACT_FREE_PERCENT. */
+	int compact(int file_id, bool when_due = false);
 
 	void mark_dirty(int file_id, int page_id);
 
-	char* read(int file_id, int page_id) {
-		int index;
-		return read(file_id, page_id, index);
+	/* change the number of cached pages, pages in the dropped
+	 * frames are written back. False if a page is pinned. */
+	bool resize(int new_capacity);
+	int get_capacity() const { return capacity; }
+	int get_frame_size() const { return frame_size; }
+	int get_page_size(int file_id) const { return files[file_id].get_page_size(); }
+	/* a power of two in [PAGE_SIZE, PAGE_MAX_SIZE] */
+	static bool valid_page_size(int page_size) {
+		return page_size >= PAGE_SIZE && page_size <= PAGE_MAX_SIZE && !(page_size & (page_size - 1));
+	}
+
+	/* the background writer keeps this percentage of the frames next
+	 * to be evicted clean, 0 to disable */
+	void set_writer_clean_percent(int percent) { writer_clean_percent = percent; }
+	int get_writer_clean_percent() const { return writer_clean_percent; }
+	/* pages per second written by the background writer recently */
+	std::uint64_t get_writer_rate() const { return writer_rate; }
+
+	/* largest readahead window of leaf scans in pages, 0 to disable */
+	void set_readahead(int pages) { readahead = pages; }
+	int get_readahead() const { return readahead; }
+
+	/* write the pages of the file compressed from now on. Pages are
+	 * read back either way, so the setting may change at any time.
+	 * False if the pages are too small to save a block. */
+	bool set_compression(int file_id, bool enable);
+	bool get_compression(int file_id) const { return compress[file_id] == 1; }
+
+	/* Replay the committed changes in the log at `path` into the files,
+	 * make them durable and log to it from now on. A change is durable
+	 * once the commit after it returns, or after the sync interval. */
+	bool open_log(const char *path);
+	/* log the pages and free-map changes since the last commit as one
+	 * group, then wait for the log to reach the disk */
+	void commit();
+	/* write every dirty page and sync the files, so that the log can
+	 * be emptied. Done by `commit` when the log grows large. */
+	void checkpoint();
+	/* milliseconds between log syncs, commits do not wait for the
+	 * sync then. 0 syncs on each commit. */
+	void set_log_sync_interval(int ms) { log.set_sync_interval(ms); }
+	int get_log_sync_interval() const { return log.get_sync_interval(); }
+	bool is_logging() const { return logging; }
+
+	/* write, remove or rename a whole file outside of the pool, e.g. a
+	 * table header, logged like the pages. The file must not be open. */
+	bool write_file(const char *filename, const void *data, std::size_t size);
+	bool remove_file(const char *filename);
+	bool rename_file(const char *from, const char *to);
+
+	/* Take a snapshot of the files for a backup, nobody may be writing
+	 * to them now. Afterwards pages change as usual, but the first
+	 * change of a page not copied yet keeps its old content in memory
+	 * (copy-on-write). Closing a file waits until it is copied, and its
+	 * free pages are not cut off meanwhile. */
+	bool begin_snapshot(const int *file_ids, int num);
+	/* write the file as it was at the snapshot to `path`, reading
+	 * PAGE_BACKUP_READ_SIZE bytes at a time, then drop it from the
+	 * snapshot. Return the bytes written, -1 on error. */
+	std::int64_t copy_snapshot(int file_id, const char *path);
+	/* drop the files not copied from the snapshot */
+	void end_snapshot();
+	bool in_snapshot() const { return snapshot_active; }
+
+	/* pages a file grows by when it is full */
+	void set_extent(int pages) { extent = pages; }
+	int get_extent() const { return extent; }
+
+	/* switch replacement policy, `lru` or `2q` */
+	bool set_policy(const char *name);
+	const char* get_policy() const { return shards[0].policy->name(); }
+
+	/* write the pages cached now, so that the next run can warm up
+	 * its pool with them. Keep the old list if nothing is cached. */
+	bool save_resident(const char *path);
+	/* read a list written by `save_resident`. At most `max_pages` of
+	 * its pages, in the order of the list, are read ahead once their
+	 * files are opened. */
+	bool load_warmup(const char *path, int max_pages);
+
+	page_fs_stats_t get_stats();
+	void reset_stats();
+	// `page_fs_stats_t::pages_dirtied`, without visiting the shards
+	std::uint64_t get_dirtied_pages() const { return dirtied_pages; }
+
+	/* an empty guard if the page is not cached and all the frames of
+	 * its shard stay pinned, see PAGE_PIN_WAIT_MS */
+	page_guard read(int file_id, int page_id) {
+		return read(file_id, page_id, false);
 	}
 
-	char* read_for_write(int file_id, int page_id) {
-		int index;
-		char *buf = read(file_id, page_id, index);
-		dirty[index] = 1;
-		return buf;
+	page_guard read_for_write(int file_id, int page_id) {
+		return read(file_id, page_id, true);
 	}
 
+	/* start reading the pages which are not cached yet and return
+	 * at once. Pages out of the file are ignored. If `batch` is given,
+	 * the reads are added to it. Return the number of reads started. */
+	int prefetch(int file_id, const int *page_ids, int num, io_batch *batch = nullptr);
+	/* read many pages with their I/O in flight at the same time */
+	void read_batch(int file_id, const int *page_ids, int num, page_guard *pages);
+
 public:
 	static page_fs* get_instance()
 	{
@@ -87,4 +443,84 @@ public:
 	}
 };
 
+/* page_guard code */
+inline page_guard::page_guard(page_fs *fs, int index, char *buf, int page_size)
+	: fs(fs), index(index), buf(buf), page_size(page_size)
+{
+	pin();
+}
+
+inline page_guard::page_guard(const page_guard &other)
+	: fs(other.fs), index(other.index), buf(other.buf), page_size(other.page_size)
+{
+	pin();
+}
+
+inline page_guard::page_guard(page_guard &&other) noexcept
+	: fs(other.fs), index(other.index), buf(other.buf), page_size(other.page_size)
+{
+	other.fs = nullptr;
+	other.index = -1;
+	other.buf = nullptr;
+}
+
+inline page_guard& page_guard::operator = (const page_guard &other)
+{
+	if(this != &other)
+	{
+		unpin();
+		fs = other.fs;
+		index = other.index;
+		buf = other.buf;
+		page_size = other.page_size;
+		pin();
+	}
+	return *this;
+}
+
+inline page_guard& page_guard::operator = (page_guard &&other) noexcept
+{
+	if(this != &other)
+	{
+		unpin();
+		fs = other.fs;
+		index = other.index;
+		buf = other.buf;
+		page_size = other.page_size;
+		other.fs = nullptr;
+		other.index = -1;
+		other.buf = nullptr;
+	}
+	return *this;
+}
+
+inline void page_guard::pin()
+{
+	if(fs) ++fs->pin_count[index];
+}
+
+inline void page_guard::unpin()
+{
+	if(fs)
+	{
+		assert(fs->pin_count[index] > 0);
+		--fs->pin_count[index];
+		fs = nullptr;
+		index = -1;
+		buf = nullptr;
+	}
+}
+
+inline void page_guard::mark_dirty()
+{
+	assert(fs);
+	fs->set_dirty(index);
+}
+
+inline std::shared_mutex& page_guard::latch() const
+{
+	assert(fs);
+	return fs->frame_latches[index];
+}
+
 #endif
@@ -0,0 +1,250 @@
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+
+#include "page_log.h"
+
+static const std::uint32_t* crc_table()
+{
+	static std::uint32_t table[256];
+	static std::once_flag once;
+	std::call_once(once, [] {
+		for(std::uint32_t i = 0; i != 256; ++i)
+		{
+			std::uint32_t c = i;
+			for(int k = 0; k != 8; ++k)
+				c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+			table[i] = c;
+		}
+	} );
+	return table;
+}
+
+static std::uint32_t crc32(std::uint32_t crc, const void *data, std::size_t size)
+{
+	const std::uint32_t *table = crc_table();
+	const unsigned char *p = (const unsigned char*)data;
+	crc = ~crc;
+	while(size--)
+		crc = table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+static std::uint32_t record_checksum(const page_log_record_t &rec, const char *data)
+{
+	std::uint32_t crc = crc32(0, &rec.type, sizeof(rec.type));
+	crc = crc32(crc, &rec.size, sizeof(rec.size));
+	return crc32(crc, data, rec.size);
+}
+
+page_log::page_log()
+	: file_size(0), writing(false), end_lsn(0), durable_lsn(0),
+	  commits(0), syncs(0), bytes(0), syncer_stop(false), sync_interval(0)
+{
+}
+
+bool page_log::open(const char *path)
+{
+	close();
+	bool created;
+	if(!file.open(path, false, created))
+		return false;
+	if(!file.truncate(0) || !file.sync())
+	{
+		file.close();
+		return false;
+	}
+
+	file_size = 0;
+	end_lsn = durable_lsn = 0;
+	syncer_stop = false;
+	syncer = std::thread([this] { syncer_main(); });
+	return true;
+}
+
+void page_log::close()
+{
+	if(!file.is_open())
+		return;
+	{
+		std::lock_guard<std::mutex> lock(syncer_latch);
+		syncer_stop = true;
+	}
+	syncer_wake.notify_one();
+	syncer.join();
+
+	flush(end_lsn);
+	file.close();
+	buffer.clear();
+}
+
+void page_log::syncer_main()
+{
+	std::unique_lock<std::mutex> lock(syncer_latch);
+	while(!syncer_stop)
+	{
+		int ms = sync_interval;
+		if(ms) syncer_wake.wait_for(lock, std::chrono::milliseconds(ms));
+		else syncer_wake.wait(lock);
+		if(syncer_stop) break;
+
+		lock.unlock();
+		std::uint64_t lsn;
+		{
+			std::lock_guard<std::mutex> log_lock(latch);
+			lsn = end_lsn;
+		}
+		flush(lsn);
+		lock.lock();
+	}
+}
+
+void page_log::set_sync_interval(int ms)
+{
+	{
+		std::lock_guard<std::mutex> lock(syncer_latch);
+		sync_interval = ms;
+	}
+	syncer_wake.notify_one();
+}
+
+std::uint64_t page_log::append(int type, const void *head, std::size_t head_size,
+	const void *data, std::size_t size)
+{
+	page_log_record_t rec;
+	rec.type = type;
+	rec.size = (std::uint32_t)(head_size + size);
+
+	std::unique_lock<std::mutex> lock(latch);
+	std::size_t begin = buffer.size();
+	buffer.resize(begin + sizeof(rec) + rec.size);
+	char *p = buffer.data() + begin + sizeof(rec);
+	if(head_size) std::memcpy(p, head, head_size);
+	if(size) std::memcpy(p + head_size, data, size);
+	rec.checksum = record_checksum(rec, p);
+	std::memcpy(buffer.data() + begin, &rec, sizeof(rec));
+
+	end_lsn += sizeof(rec) + rec.size;
+	bytes += sizeof(rec) + rec.size;
+	std::uint64_t lsn = end_lsn;
+	// a large statement writes its records as it goes
+	if(buffer.size() >= PAGE_LOG_BUFFER_SIZE && !writing)
+		write_buffer(lock, false);
+	return lsn;
+}
+
+void page_log::commit()
+{
+	std::uint64_t lsn = append(LOG_COMMIT, nullptr, 0);
+	{
+		std::lock_guard<std::mutex> lock(latch);
+		++commits;
+	}
+	if(!sync_interval)
+		flush(lsn);
+}
+
+/* Write out the buffer, then sync the log if `sync`. `lock` holds
+ * `latch` and nobody else is writing, the latch is released during
+ * the I/O so that other threads go on appending. */
+void page_log::write_buffer(std::unique_lock<std::mutex> &lock, bool sync)
+{
+	writing = true;
+	spare.swap(buffer);
+	std::uint64_t lsn = end_lsn;
+	std::int64_t offset = file_size;
+	file_size += spare.size();
+	lock.unlock();
+
+	bool ok = spare.empty() || file.write(offset, spare.data(), spare.size());
+	if(ok && sync) ok = file.sync();
+	if(!ok) std::fprintf(stderr, "[Error] fail to write the log.\n");
+
+	lock.lock();
+	spare.clear();
+	if(sync)
+	{
+		durable_lsn = lsn;
+		++syncs;
+	}
+	writing = false;
+	written.notify_all();
+}
+
+void page_log::flush(std::uint64_t lsn)
+{
+	std::unique_lock<std::mutex> lock(latch);
+	while(durable_lsn < lsn && file.is_open())
+	{
+		// the group in flight may not have our records, wait for it
+		// and lead the next one
+		if(writing) written.wait(lock);
+		else write_buffer(lock, true);
+	}
+}
+
+bool page_log::truncate()
+{
+	std::unique_lock<std::mutex> lock(latch);
+	written.wait(lock, [this] { return !writing; });
+	buffer.clear();
+	file_size = 0;
+	durable_lsn = end_lsn;
+	return file.truncate(0) && file.sync();
+}
+
+std::uint64_t page_log::size()
+{
+	std::lock_guard<std::mutex> lock(latch);
+	return file_size + buffer.size();
+}
+
+void page_log::get_stats(std::uint64_t &commits, std::uint64_t &syncs, std::uint64_t &bytes)
+{
+	std::lock_guard<std::mutex> lock(latch);
+	commits = this->commits;
+	syncs = this->syncs;
+	bytes = this->bytes;
+}
+
+void page_log::reset_stats()
+{
+	std::lock_guard<std::mutex> lock(latch);
+	commits = syncs = bytes = 0;
+}
+
+int page_log::replay(const char *path,
+	const std::function<void(int type, const char *data, std::size_t size)> &apply)
+{
+	std::FILE *f = std::fopen(path, "rb");
+	if(!f) return -1;
+	std::vector<char> log;
+	char chunk[1 << 16];
+	for(std::size_t n; (n = std::fread(chunk, 1, sizeof(chunk), f)) != 0; )
+		log.insert(log.end(), chunk, chunk + n);
+	std::fclose(f);
+
+	// the records of the group read so far, (offset, record)
+	std::vector<std::pair<std::size_t, page_log_record_t>> group;
+	int groups = 0;
+	for(std::size_t pos = 0; log.size() - pos >= sizeof(page_log_record_t); )
+	{
+		page_log_record_t rec;
+		std::memcpy(&rec, log.data() + pos, sizeof(rec));
+		pos += sizeof(rec);
+		// the tail of a crash, torn or never written
+		if(rec.size > log.size() - pos || record_checksum(rec, log.data() + pos) != rec.checksum)
+			break;
+
+		if(rec.type == LOG_COMMIT)
+		{
+			for(auto &r : group)
+				apply(r.second.type, log.data() + r.first, r.second.size);
+			group.clear();
+			++groups;
+		} else group.push_back({ pos, rec });
+		pos += rec.size;
+	}
+
+	return groups;
+}
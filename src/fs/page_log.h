@@ -0,0 +1,130 @@
+#ifndef __TRIVIALDB_PAGE_LOG__
+#define __TRIVIALDB_PAGE_LOG__
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+#include "../defs.h"
+#include "file_io.h"
+
+/* Records of the write-ahead log, see `page_fs::open_log`. Each record
+ * is a `page_log_record_t` followed by `size` bytes. A group of records
+ * ends with LOG_COMMIT, recovery skips the records of a group which did
+ * not make it to the log as a whole. */
+enum page_log_type
+{
+	LOG_FILE = 1,   // page_log_file_t, the file name
+	LOG_CREATE,     // page_log_file_t, the file was created empty
+	LOG_META,       // page_log_meta_t, the free-map changes
+	LOG_PAGE,       // page_log_page_t, the page
+	LOG_IMAGE,      // the file name, '\0', the whole file
+	LOG_REMOVE,     // the file name
+	LOG_RENAME,     // the old name, '\0', the new name
+	LOG_COMMIT
+};
+
+struct page_log_record_t
+{
+	std::uint32_t type;
+	std::uint32_t size;
+	// crc32 of the type, the size and the bytes
+	std::uint32_t checksum;
+};
+
+/* a file id of the log names the file until it is named again */
+struct page_log_file_t
+{
+	int file_id;
+	int page_size;
+};
+
+/* `page_num` is the least number of pages, or the exact one after the
+ * file was cut (`truncated`), followed by `op_num` ints: the page id if
+ * the page was freed, minus the page id if it was taken */
+struct page_log_meta_t
+{
+	int file_id;
+	int page_num;
+	int truncated;
+	int compression;
+	int op_num;
+};
+
+/* followed by `size` bytes, the page as it is if `size` is the page
+ * size, or else compressed by `lz_codec` */
+struct page_log_page_t
+{
+	int file_id;
+	int page_id;
+	int size;
+};
+
+/* The log file. Records are appended to a buffer, and whoever waits
+ * for them first writes the buffer and syncs the file while the others
+ * go on appending, so one sync makes the records of every commit which
+ * waits in the meantime durable (group commit). With a sync interval,
+ * commits do not wait at all and a thread syncs the log that often. */
+class page_log
+{
+	file_io file;
+	std::int64_t file_size;
+	std::mutex latch;
+	std::condition_variable written;
+	// set while a thread is writing out `buffer`
+	bool writing;
+	std::vector<char> buffer, spare;
+	// bytes appended since the log was opened, and those synced
+	std::uint64_t end_lsn, durable_lsn;
+	std::uint64_t commits, syncs, bytes;
+
+	std::thread syncer;
+	std::mutex syncer_latch;
+	std::condition_variable syncer_wake;
+	bool syncer_stop;
+	std::atomic<int> sync_interval;
+
+	void write_buffer(std::unique_lock<std::mutex> &lock, bool sync);
+	void syncer_main();
+public:
+	page_log();
+	~page_log() { close(); }
+
+	/* open the log, what it held is discarded */
+	bool open(const char *path);
+	void close();
+	bool is_open() const { return file.is_open(); }
+
+	/* append a record of `head` and `data`, return its end */
+	std::uint64_t append(int type, const void *head, std::size_t head_size,
+		const void *data = nullptr, std::size_t size = 0);
+	/* end the group, and wait until it is durable unless there is a
+	 * sync interval */
+	void commit();
+	/* wait until the records up to `lsn` are durable */
+	void flush(std::uint64_t lsn);
+	/* drop every record, once the files have all of them */
+	bool truncate();
+	/* bytes in the log file and the buffer */
+	std::uint64_t size();
+
+	/* milliseconds between syncs, 0 to sync on every commit */
+	void set_sync_interval(int ms);
+	int get_sync_interval() const { return sync_interval; }
+
+	void get_stats(std::uint64_t &commits, std::uint64_t &syncs, std::uint64_t &bytes);
+	void reset_stats();
+
+	/* call `apply` on each record of the whole groups in the log at
+	 * `path`, in order. Return the number of groups, -1 if the log
+	 * cannot be read. */
+	static int replay(const char *path,
+		const std::function<void(int type, const char *data, std::size_t size)> &apply);
+};
+
+#endif
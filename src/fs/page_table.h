@@ -0,0 +1,123 @@
+#ifndef __TRIVIALDB_PAGE_TABLE__
+#define __TRIVIALDB_PAGE_TABLE__
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+/* Page table of a buffer pool shard, packed (file, page) key -> frame.
+ * Open addressing with linear probing in a power-of-two array kept at
+ * most half full, so a lookup touches one or two cache lines. Erasing
+ * shifts the following entries back, there are no tombstones.
+ * Key 0 marks an empty slot, file ids start at 1 so no page has it. */
+class page_table
+{
+	struct slot_t
+	{
+		std::uint64_t key;
+		int value;
+	};
+
+	std::vector<slot_t> slots;
+	std::size_t mask;
+	int num;
+	// probes of `find`, a hit in the home slot is one probe
+	std::uint64_t lookups, probes;
+
+	std::size_t home(std::uint64_t key) const
+	{
+		// the finalizer of MurmurHash3
+		key ^= key >> 33;
+		key *= 0xff51afd7ed558ccdull;
+		key ^= key >> 33;
+		key *= 0xc4ceb9fe1a85ec53ull;
+		key ^= key >> 33;
+		return (std::size_t)key & mask;
+	}
+
+public:
+	page_table() : mask(0), num(0), lookups(0), probes(0) {}
+
+	/* make room for `capacity` entries, the entries are kept */
+	void reserve(int capacity)
+	{
+		std::size_t size = 16;
+		while(size < (std::size_t)capacity * 2)
+			size <<= 1;
+		if(size == slots.size())
+			return;
+
+		std::vector<slot_t> old(size, slot_t{ 0, 0 });
+		old.swap(slots);
+		mask = size - 1;
+		num = 0;
+		for(const slot_t &s : old)
+			if(s.key) insert(s.key, s.value);
+	}
+
+	int size() const { return num; }
+
+	/* the frame of the page, -1 if it is not cached */
+	int find(std::uint64_t key)
+	{
+		++lookups;
+		for(std::size_t i = home(key);; i = (i + 1) & mask)
+		{
+			++probes;
+			if(slots[i].key == key) return slots[i].value;
+			if(!slots[i].key) return -1;
+		}
+	}
+
+	bool contains(std::uint64_t key) const
+	{
+		for(std::size_t i = home(key);; i = (i + 1) & mask)
+		{
+			if(slots[i].key == key) return true;
+			if(!slots[i].key) return false;
+		}
+	}
+
+	/* the key is not in the table */
+	void insert(std::uint64_t key, int value)
+	{
+		assert(key && num < (int)(slots.size() / 2));
+		std::size_t i = home(key);
+		while(slots[i].key)
+		{
+			assert(slots[i].key != key);
+			i = (i + 1) & mask;
+		}
+		slots[i] = { key, value };
+		++num;
+	}
+
+	void erase(std::uint64_t key)
+	{
+		std::size_t i = home(key);
+		while(slots[i].key != key)
+		{
+			assert(slots[i].key);
+			i = (i + 1) & mask;
+		}
+
+		// move back the entries which would no longer be found
+		for(std::size_t j = (i + 1) & mask; slots[j].key; j = (j + 1) & mask)
+		{
+			std::size_t h = home(slots[j].key);
+			// `h` is cyclically in (i, j], the entry stays
+			if(i <= j ? (i < h && h <= j) : (i < h || h <= j))
+				continue;
+			slots[i] = slots[j];
+			i = j;
+		}
+		slots[i] = { 0, 0 };
+		--num;
+	}
+
+	std::uint64_t get_lookups() const { return lookups; }
+	std::uint64_t get_probes() const { return probes; }
+	void reset_stats() { lookups = probes = 0; }
+};
+
+#endif
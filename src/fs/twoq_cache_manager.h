@@ -0,0 +1,256 @@
+#ifndef __TRIVIALDB_TWOQ_CACHE_MANAGER__
+#define __TRIVIALDB_TWOQ_CACHE_MANAGER__
+#include <assert.h>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <unordered_map>
+
+#include "../defs.h"
+#include "cache_policy.h"
+
+/* 2Q (Johnson & Shasha, VLDB'94).
+ * A page read for the first time enters `A1in`, a FIFO holding about
+ * a quarter of the frames. When it leaves `A1in` its key is kept in the
+ * ghost queue `A1out`, and pages referenced again while in `A1out` are
+ * loaded into `Am`, which is managed as LRU. A page hit in `A1in` is
+ * moved to `Am` only if enough other pages have been loaded since it
+ * was read, so the repeated hits of a scan on its current page do not
+ * count. A full table scan thus only cycles through `A1in` and leaves
+ * the hot pages in `Am` alone. */
+class twoq_cache_manager : public cache_policy
+{
+	enum { LIST_FREE, LIST_A1IN, LIST_AM, LIST_NUM };
+
+	struct node_t
+	{
+		int prev, next, list;
+		std::uint64_t key, loaded_at;
+	} *nodes;
+
+	int capacity;
+	// `head` is the most recent one, -1 if the list is empty
+	int head[LIST_NUM], size[LIST_NUM];
+
+	// ghost keys of A1out with their insertion sequence, so stale
+	// queue entries of keys which come back are recognized
+	std::deque<std::pair<std::uint64_t, std::uint64_t>> a1out;
+	std::unordered_map<std::uint64_t, std::uint64_t> a1out_seq;
+	std::uint64_t seq;
+	// number of loads so far
+	std::uint64_t clock;
+
+public:
+	twoq_cache_manager(int capacity)
+		: nodes(nullptr), capacity(0), seq(0), clock(0)
+	{
+		for(int i = 0; i != LIST_NUM; ++i)
+			head[i] = -1, size[i] = 0;
+		resize(capacity);
+	}
+
+	~twoq_cache_manager()
+	{
+		delete[] nodes;
+	}
+
+public:
+	const char* name() const { return "2q"; }
+
+	void access(int id)
+	{
+		assert(0 <= id && id < capacity);
+		assert(nodes[id].list != LIST_FREE);
+		if(nodes[id].list == LIST_A1IN)
+		{
+			if(clock - nodes[id].loaded_at > correlated_period())
+			{
+				unlink(id);
+				push_front(LIST_AM, id);
+			}
+		} else if(head[LIST_AM] != id) {
+			unlink(id);
+			push_front(LIST_AM, id);
+		}
+	}
+
+	void load(int id, std::uint64_t key)
+	{
+		assert(0 <= id && id < capacity);
+		assert(nodes[id].list == LIST_FREE);
+		unlink(id);
+		auto it = a1out_seq.find(key);
+		if(it != a1out_seq.end())
+		{
+			a1out_seq.erase(it);
+			push_front(LIST_AM, id);
+		} else {
+			push_front(LIST_A1IN, id);
+		}
+		nodes[id].key = key;
+		nodes[id].loaded_at = ++clock;
+	}
+
+	void remove(int id)
+	{
+		assert(0 <= id && id < capacity);
+		if(nodes[id].list == LIST_FREE)
+			return;
+		if(nodes[id].list == LIST_A1IN)
+			remember(nodes[id].key);
+		unlink(id);
+		push_back(LIST_FREE, id);
+	}
+
+	int victim(const std::atomic<int> *pin_count, const std::atomic<char> *held)
+	{
+		if(size[LIST_FREE])
+			return head[LIST_FREE];
+		int first = LIST_AM, second = LIST_A1IN;
+		if(size[LIST_A1IN] > max_a1in() || !size[LIST_AM])
+			std::swap(first, second);
+		int id = unpinned_back(first, pin_count, held);
+		return id != -1 ? id : unpinned_back(second, pin_count, held);
+	}
+
+	int candidates(const std::atomic<int> *pin_count, const std::atomic<char> *held, int *out, int num)
+	{
+		int ret = 0;
+		if(head[LIST_FREE] != -1)
+		{
+			int k = head[LIST_FREE];
+			for(int i = 0; i != size[LIST_FREE] && ret != num; ++i, k = nodes[k].next)
+				out[ret++] = k;
+		}
+
+		int first = LIST_AM, second = LIST_A1IN;
+		if(size[LIST_A1IN] > max_a1in() || !size[LIST_AM])
+			std::swap(first, second);
+		for(int list : { first, second })
+		{
+			if(head[list] == -1) continue;
+			int k = nodes[head[list]].prev;
+			for(int i = 0; i != size[list] && ret != num; ++i, k = nodes[k].prev)
+			{
+				if(!pin_count[k] && !(held && held[k]))
+					out[ret++] = k;
+			}
+		}
+		return ret;
+	}
+
+	void resize(int new_capacity)
+	{
+		assert(new_capacity > 0);
+		node_t *old_nodes = nodes;
+		int old_head[LIST_NUM];
+		for(int i = 0; i != LIST_NUM; ++i)
+		{
+			old_head[i] = head[i];
+			head[i] = -1, size[i] = 0;
+		}
+
+		nodes = new node_t[new_capacity];
+		// keep the order of the remaining frames
+		for(int l = 0; l != LIST_NUM; ++l)
+		{
+			if(old_head[l] == -1) continue;
+			int k = old_head[l];
+			do {
+				if(k < new_capacity)
+				{
+					push_back(l, k);
+					nodes[k].key = old_nodes[k].key;
+					nodes[k].loaded_at = old_nodes[k].loaded_at;
+				} else assert(l == LIST_FREE);
+				k = old_nodes[k].next;
+			} while(k != old_head[l]);
+		}
+
+		for(int i = capacity; i < new_capacity; ++i)
+			push_back(LIST_FREE, i);
+
+		delete[] old_nodes;
+		capacity = new_capacity;
+		while(a1out_seq.size() > (std::size_t)max_a1out())
+			forget_oldest();
+	}
+
+private:
+	int max_a1in() const { return capacity / 4 > 0 ? capacity / 4 : 1; }
+	int max_a1out() const { return capacity / 2 > 0 ? capacity / 2 : 1; }
+	std::uint64_t correlated_period() const { return max_a1in() / 4; }
+
+	int unpinned_back(int list, const std::atomic<int> *pin_count, const std::atomic<char> *held) const
+	{
+		if(head[list] == -1)
+			return -1;
+		int k = nodes[head[list]].prev;
+		for(int i = 0; i != size[list]; ++i, k = nodes[k].prev)
+		{
+			if(!pin_count[k] && !(held && held[k]))
+				return k;
+		}
+		return -1;
+	}
+
+	void unlink(int id)
+	{
+		int list = nodes[id].list;
+		if(nodes[id].next == id)
+		{
+			head[list] = -1;
+		} else {
+			nodes[nodes[id].prev].next = nodes[id].next;
+			nodes[nodes[id].next].prev = nodes[id].prev;
+			if(head[list] == id)
+				head[list] = nodes[id].next;
+		}
+		--size[list];
+	}
+
+	void push_back(int list, int id)
+	{
+		nodes[id].list = list;
+		int h = head[list];
+		if(h == -1)
+		{
+			nodes[id].prev = nodes[id].next = id;
+			head[list] = id;
+		} else {
+			nodes[id].next = h;
+			nodes[id].prev = nodes[h].prev;
+			nodes[nodes[h].prev].next = id;
+			nodes[h].prev = id;
+		}
+		++size[list];
+	}
+
+	void push_front(int list, int id)
+	{
+		push_back(list, id);
+		head[list] = id;
+	}
+
+	void remember(std::uint64_t key)
+	{
+		a1out.emplace_back(key, ++seq);
+		a1out_seq[key] = seq;
+		while(a1out_seq.size() > (std::size_t)max_a1out())
+			forget_oldest();
+		// drop stale entries so that the queue stays bounded
+		while(!a1out.empty() && a1out.size() > 2 * (std::size_t)max_a1out())
+			forget_oldest();
+	}
+
+	void forget_oldest()
+	{
+		auto front = a1out.front();
+		a1out.pop_front();
+		auto it = a1out_seq.find(front.first);
+		if(it != a1out_seq.end() && it->second == front.second)
+			a1out_seq.erase(it);
+	}
+};
+
+#endif
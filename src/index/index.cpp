@@ -1,27 +1,73 @@
 #include "index.h"
-#include "../utils/comparer.h"
+#include <algorithm>
+#include <cstdio>
 #include <cstring>
+#include <queue>
+#include <vector>
 
-index_manager::index_manager(pager *pg, int size, int root_pid, comparer_t comparer)
+/* The b-tree of an index, made for the key type of its column so that
+ * the comparisons of keys are inlined, sorting them as well. */
+class index_tree
+{
+public:
+	virtual ~index_tree() {}
+	virtual int get_root_page_id() = 0;
+	virtual void insert(const char *key, int rid) = 0;
+	virtual bool erase(const char *key) = 0;
+	virtual std::pair<int, int> lower_bound(const char *key) = 0;
+	virtual void bulk_load(const std::function<const char*()> &next, int fill_percent) = 0;
+	virtual void sort(std::vector<const char*> &keys) = 0;
+	virtual bool less(const char *a, const char *b) = 0;
+};
+
+namespace
+{
+	template<typename Comparer>
+	class typed_index_tree : public index_tree
+	{
+		index_btree<Comparer> btr;
+		Comparer compare;
+	public:
+		typed_index_tree(pager *pg, int root_pid, int field_size)
+			: btr(pg, root_pid, field_size), compare(field_size) {}
+
+		int get_root_page_id() override { return btr.get_root_page_id(); }
+		void insert(const char *key, int rid) override { btr.insert(key, rid); }
+		bool erase(const char *key) override { return btr.erase(key); }
+		std::pair<int, int> lower_bound(const char *key) override { return btr.lower_bound(key); }
+
+		void bulk_load(const std::function<const char*()> &next, int fill_percent) override
+		{
+			btr.bulk_load(next, fill_percent);
+		}
+
+		void sort(std::vector<const char*> &keys) override
+		{
+			std::sort(keys.begin(), keys.end(), [this](const char *a, const char *b) {
+				return compare(a, b) < 0;
+			} );
+		}
+
+		bool less(const char *a, const char *b) override { return compare(a, b) < 0; }
+	};
+}
+
+index_manager::index_manager(pager *pg, int size, int root_pid, int col_type)
 {
 	this->pg = pg;
 	this->size = size;
-	// [rid, nullmark, data]
-	buf = new char[size + sizeof(int) + 1];
-	btr = new index_btree(pg, root_pid, size + sizeof(int) + 1,
-		[comparer](const char *a, const char *b) -> int {
-			if(a[4] != b[4])
-			{
-				// one of A and B is NULL
-				return a[4] ? -1 : 1;
-			} else if(!a[4]) {
-				// A and B are not NULL
-				int r = comparer(a + sizeof(int) + 1, b + sizeof(int) + 1);
-				if(r != 0) return r;
-			}
-
-			return integer_comparer(*(int*)a, *(int*)b);
-		} );
+	this->col_type = col_type;
+	// [nullmark, data, rid], a string as long as it is
+	int key_size = 1 + size + sizeof(int);
+	buf = new char[key_size];
+	if(col_type == COL_TYPE_VARCHAR)
+	{
+		btr = new typed_index_tree<variable_key_comparer>(
+			pg, root_pid, key_size | index_page<true>::variable_keys);
+	} else {
+		assert(size == 4);
+		btr = new typed_index_tree<fixed_key_comparer>(pg, root_pid, key_size);
+	}
 }
 
 index_manager::~index_manager()
@@ -39,15 +85,39 @@ int index_manager::get_root_pid()
 
 void index_manager::fill_buf(const char *key, int rid)
 {
-	*(int*)buf = rid;
-	if(key != nullptr)
+	char *p = buf;
+	if(key == nullptr)
 	{
-		buf[4] = 0;
-		std::memcpy(buf + sizeof(int) + 1, key, size);
+		*p++ = 0;
+		if(col_type != COL_TYPE_VARCHAR)
+		{
+			std::memset(p, 0, size);
+			p += size;
+		}
 	} else {
-		buf[4] = 1;
-		std::memset(buf + sizeof(int) + 1, 0, size);
+		*p++ = 1;
+		switch(col_type)
+		{
+			case COL_TYPE_INT:
+			case COL_TYPE_DATE:
+				index_key::encode_int(p, *(const int*)key);
+				p += size;
+				break;
+			case COL_TYPE_FLOAT:
+				index_key::encode_float(p, *(const float*)key);
+				p += size;
+				break;
+			default: {
+				// a string key may end early
+				int len = (int)strnlen(key, size - 1);
+				std::memcpy(p, key, len);
+				p[len] = 0;
+				p += len + 1;
+				break; }
+		}
 	}
+
+	index_key::encode_int(p, rid);
 }
 
 void index_manager::insert(const char *key, int rid)
@@ -56,6 +126,90 @@ void index_manager::insert(const char *key, int rid)
 	btr->insert(buf, rid);
 }
 
+namespace
+{
+	/* a sorted run of keys spilled to a temporary file */
+	struct sorted_run
+	{
+		FILE *file;
+		std::vector<char> key;
+		bool next() { return std::fread(key.data(), key.size(), 1, file) == 1; }
+	};
+}
+
+int index_manager::bulk_load(const std::function<bool(const char*&, int&)> &next, int fill_percent)
+{
+	int key_size = 1 + size + sizeof(int);
+	auto less = [this](const char *a, const char *b) { return btr->less(a, b); };
+	std::vector<char> keys;
+	std::vector<const char*> sorted;
+	std::vector<sorted_run> runs;
+	int num = 0;
+
+	auto sort_keys = [&]() {
+		sorted.clear();
+		for(size_t i = 0; i != keys.size(); i += key_size)
+			sorted.push_back(keys.data() + i);
+		btr->sort(sorted);
+	};
+
+	const char *key;
+	int rid;
+	while(next(key, rid))
+	{
+		fill_buf(key, rid);
+		keys.insert(keys.end(), buf, buf + key_size);
+		++num;
+		if(keys.size() + key_size <= INDEX_BULK_SORT_BUFFER)
+			continue;
+
+		// spill a sorted run, or keep all keys in memory without a temporary file
+		FILE *file = std::tmpfile();
+		if(!file) continue;
+		sort_keys();
+		for(const char *k : sorted)
+			std::fwrite(k, key_size, 1, file);
+		runs.push_back({ file, std::vector<char>(key_size) });
+		keys.clear();
+	}
+
+	sort_keys();
+	if(runs.empty())
+	{
+		size_t pos = 0;
+		btr->bulk_load([&]() -> const char* {
+			return pos == sorted.size() ? nullptr : sorted[pos++];
+		}, fill_percent);
+		return num;
+	}
+
+	// merge the runs with the keys left in memory
+	size_t pos = 0;
+	auto greater = [&](int a, int b) { return less(runs[b].key.data(), runs[a].key.data()); };
+	std::priority_queue<int, std::vector<int>, decltype(greater)> heap(greater);
+	for(int i = 0; i != (int)runs.size(); ++i)
+	{
+		std::rewind(runs[i].file);
+		if(runs[i].next()) heap.push(i);
+	}
+
+	int last_run = -1;
+	btr->bulk_load([&]() -> const char* {
+		if(last_run >= 0 && runs[last_run].next())
+			heap.push(last_run);
+		last_run = -1;
+		if(heap.empty() || (pos != sorted.size() && !less(runs[heap.top()].key.data(), sorted[pos])))
+			return pos == sorted.size() ? nullptr : sorted[pos++];
+		last_run = heap.top();
+		heap.pop();
+		return runs[last_run].key.data();
+	}, fill_percent);
+
+	for(auto &run : runs)
+		std::fclose(run.file);
+	return num;
+}
+
 void index_manager::erase(const char *key, int rid)
 {
 	fill_buf(key, rid);
@@ -64,13 +218,13 @@ void index_manager::erase(const char *key, int rid)
 	UNUSED(ret);
 }
 
-index_btree::search_result index_manager::lower_bound(const char *key, int rid)
+std::pair<int, int> index_manager::lower_bound(const char *key, int rid)
 {
 	fill_buf(key, rid);
 	return btr->lower_bound(buf);
 }
 
-btree_iterator<index_btree::leaf_page> index_manager::get_iterator_lower_bound(const char *key, int rid)
+btree_iterator<index_page<true>> index_manager::get_iterator_lower_bound(const char *key, int rid)
 {
 	auto ret = lower_bound(key, rid);
 	return { pg, ret.first, ret.second };
@@ -4,26 +4,34 @@
 #include "../btree/btree.h"
 #include "../btree/iterator.h"
 
+class index_tree;
+
 class index_manager
 {
 	char *buf;
-	index_btree *btr;
-	int size;
+	index_tree *btr;
+	int size, col_type;
 	pager *pg;
 
 	void fill_buf(const char *key, int rid);
 
 public:
-	typedef int(*comparer_t)(const char*, const char*);
-
-	index_manager(pager *pg, int size, int root_pid, comparer_t comparer);
+	/* keys of `size` bytes of a column of `col_type`, strings stored in
+	 * their length, see `index_btree` */
+	index_manager(pager *pg, int size, int root_pid, int col_type);
 	~index_manager();
 
 	int get_root_pid();
 	void insert(const char *key, int rid);
+	/* Build the index, which must be empty, from all (key, rid) pairs
+	 * of a table. `next` gives them in any order, a NULL key as nullptr,
+	 * and returns false at the end. The pairs are sorted, on disk if
+	 * there are too many, and the tree is built bottom up with pages
+	 * filled to `fill_percent`. Return the number of pairs. */
+	int bulk_load(const std::function<bool(const char*&, int&)> &next, int fill_percent);
 	void erase(const char *key, int rid);
-	index_btree::search_result lower_bound(const char *key, int rid = 0);
-	btree_iterator<index_btree::leaf_page> get_iterator_lower_bound(const char *key, int rid = 0);
+	std::pair<int, int> lower_bound(const char *key, int rid = 0);
+	btree_iterator<index_page<true>> get_iterator_lower_bound(const char *key, int rid = 0);
 
 };
 
@@ -1,5 +1,8 @@
 #include <string.h>
 #include "database/dbms.h"
+#include "fs/page_fs.h"
+#include "utils/byte_size.h"
+#include <climits>
 
 extern "C" char run_parser(const char *input);
 
@@ -8,11 +11,41 @@ int main(int argc, char *argv[])
     // Check for auth args
     const char* user = nullptr;
     const char* pass = nullptr;
+    int option_args = 0;
+    // preload up to the whole pool by default
+    std::uint64_t warmup_bytes = UINT64_MAX;
     
     for(int i=1; i<argc; i++) {
         if(strcmp(argv[i], "-u") == 0 && i+1 < argc) user = argv[++i];
         if(strcmp(argv[i], "-p") == 0 && i+1 < argc) pass = argv[++i];
+        if(strcmp(argv[i], "--buffer-pool-size") == 0 && i+1 < argc) {
+            std::uint64_t bytes;
+            const char* size = argv[++i];
+            option_args += 2;
+            if(!parse_byte_size(size, bytes) || bytes / PAGE_SIZE < PAGE_CACHE_MIN_CAPACITY
+                    || bytes / PAGE_SIZE > INT_MAX) {
+                fprintf(stderr, "[Error] invalid buffer pool size '%s'.\n", size);
+                return 1;
+            }
+            page_fs::get_instance()->resize((int)(bytes / PAGE_SIZE));
+        }
+        if(strcmp(argv[i], "--warmup-size") == 0 && i+1 < argc) {
+            const char* size = argv[++i];
+            option_args += 2;
+            if(!parse_byte_size(size, warmup_bytes)) {
+                fprintf(stderr, "[Error] invalid warmup size '%s'.\n", size);
+                return 1;
+            }
+        }
+        if(strcmp(argv[i], "--direct-io") == 0) {
+            option_args += 1;
+            page_fs::get_instance()->set_direct_io(true);
+        }
     }
+    argc -= option_args;
+    // redo the changes a crash left in the log before any file is used
+    page_fs::get_instance()->open_log(PAGE_LOG_FILE);
+    dbms::get_instance()->warm_up_buffer_pool(warmup_bytes);
     
     if (user && pass) {
         dbms::get_instance()->login(user, pass);
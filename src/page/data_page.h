@@ -18,9 +18,9 @@ public:
 
 	PAGE_FIELD_ACCESSER(Key, key, get_block(id).second);
 
-	std::pair<int, data_page> split(int cur_id)
+	std::pair<int, data_page> split(int cur_id, int lower_percent = 50)
 	{
-		auto ret = variant_page::split(cur_id);
+		auto ret = variant_page::split(cur_id, lower_percent);
 		return { ret.first,
 			*reinterpret_cast<data_page*>(&ret.second)
 		};
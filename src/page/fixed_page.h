@@ -21,9 +21,11 @@ public:
 	PAGE_FIELD_ACCESSER(T,   key,   begin() + id * field_size());
 	PAGE_FIELD_ACCESSER(int, child, children() + id);
 	static constexpr int header_size() { return 16; }
-	int capacity() { return (PAGE_SIZE - header_size()) / (sizeof(T) + 4); }
+	int capacity() { return (page_size - header_size()) / (sizeof(T) + 4); }
 	bool full() { return capacity() == size(); }
 	bool empty() { return size() == 0; }
+	// one more child fits, so an insert below does not split it
+	bool safe_for_insert() { return !full(); }
 	bool underflow() { return size() < capacity() / 2 - 1; }
 	bool underflow_if_remove(int) { return size() < capacity() / 2; }
 	void init(int field_size)
@@ -35,11 +37,14 @@ public:
 	}
 
 	char* begin() { return end() - size() * field_size(); }
-	char* end() { return buf + PAGE_SIZE; }
+	char* end() { return buf + page_size; }
 
+	// keys of a fixed size always fit
+	bool try_set_key(int pos, const T& key) { set_key(pos, key); return true; }
 	bool insert(int pos, const T& key, int child);
 	void erase(int pos);
-	std::pair<int, fixed_page> split(int cur_id);
+	// the lower part keeps `lower_percent` of the items
+	std::pair<int, fixed_page> split(int cur_id, int lower_percent = 50);
 	bool merge(fixed_page page, int cur_id);
 	void move_from(fixed_page page, int src_pos, int dest_pos);
 };
@@ -48,20 +53,20 @@ public:
 template<> inline
 int fixed_page<const char*>::capacity()
 {
-	return (PAGE_SIZE - header_size()) / (field_size() + 4);
+	return (page_size - header_size()) / (field_size() + 4);
 }
 
 template<> inline
 const char* fixed_page<const char*>::get_key(int pos)
 {
-	return buf + PAGE_SIZE - (size() - pos) * field_size();
+	return buf + page_size - (size() - pos) * field_size();
 }
 
 template<> inline
 void fixed_page<const char*>::set_key(int pos, const char * const &data)
 {
 	std::memcpy(
-		buf + PAGE_SIZE - (size() - pos) * field_size(),
+		buf + page_size - (size() - pos) * field_size(),
 		data, field_size());
 }
 
@@ -93,10 +98,11 @@ void fixed_page<T>::erase(int pos)
 {
 	assert(0 <= pos && pos < size());
 
-	int* ch_ptr = children() + pos;
-	for(int i = size(); i > pos; --i, ++ch_ptr)
-		*ch_ptr = *(ch_ptr + 1);
-	*ch_ptr = 0;
+	// the slot past the last child is the first key of a full page
+	int* ch_ptr = children();
+	for(int i = pos; i < size() - 1; ++i)
+		ch_ptr[i] = ch_ptr[i + 1];
+	ch_ptr[size() - 1] = 0;
 
 	std::memmove(
 		reinterpret_cast<char*>(end()) - (size() - 1) * field_size(),
@@ -108,12 +114,12 @@ void fixed_page<T>::erase(int pos)
 }
 
 template<typename T>
-std::pair<int, fixed_page<T>> fixed_page<T>::split(int cur_id)
+std::pair<int, fixed_page<T>> fixed_page<T>::split(int cur_id, int lower_percent)
 {
 	if(size() < PAGE_BLOCK_MIN_NUM)
 		return { 0, { nullptr, nullptr } };
 
-	int page_id = pg->new_page();
+	int page_id = pg->new_page(cur_id);
 	if(!page_id) return { 0, { nullptr, nullptr } };
 	fixed_page upper_page { pg->read_for_write(page_id), pg };
 	upper_page.init(field_size());
@@ -122,6 +128,7 @@ std::pair<int, fixed_page<T>> fixed_page<T>::split(int cur_id)
 	if(next_page())
 	{
 		fixed_page page { pg->read_for_write(next_page()), pg };
+		std::lock_guard<std::shared_mutex> latch(page.guard.latch());
 		assert(page.magic() == magic());
 		page.prev_page_ref() = page_id;
 	}
@@ -129,7 +136,7 @@ std::pair<int, fixed_page<T>> fixed_page<T>::split(int cur_id)
 	upper_page.prev_page_ref() = cur_id;
 	next_page_ref() = page_id;
 
-	int lower_size = size() >> 1;
+	int lower_size = size() * lower_percent / 100;
 	int upper_size = size() - lower_size;
 	std::memcpy(
 		upper_page.children(),
@@ -159,12 +166,13 @@ bool fixed_page<T>::merge(fixed_page page, int cur_id)
 	if(next_page())
 	{
 		fixed_page page { pg->read_for_write(next_page()), pg };
+		std::lock_guard<std::shared_mutex> latch(page.guard.latch());
 		assert(page.magic() == magic());
 		page.prev_page_ref() = cur_id;
 	}
 
 	std::memcpy(children() + size(), page.children(), 4 * page.size());
-	std::memmove(begin() - page.size() * field_size(), begin(), field_size() * page.size());
+	std::memmove(begin() - page.size() * field_size(), begin(), field_size() * size());
 	std::memcpy(end() - page.size() * field_size(), page.begin(), field_size() * page.size());
 	size_ref() += page.size();
 
@@ -0,0 +1,365 @@
+#ifndef __TRIVIALDB_INDEX_PAGE__
+#define __TRIVIALDB_INDEX_PAGE__
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <vector>
+#include "fixed_page.h"
+
+/* A page of an index b-tree, an interior page if `Leaf` is false.
+ * A key is [nullmark, data, rid], see `index_key.h`. Keys of a fixed
+ * size are laid out as in `fixed_page`. Keys whose data is a string are
+ * stored in their actual length instead, behind a slot directory:
+ *   | header | slot 0 | ... | slot n-1 | free space | keys |
+ * The page type tells the two layouts apart. */
+template<bool Leaf>
+class index_page : public general_page
+{
+	struct slot_t
+	{
+		int child;
+		uint16_t offset, length;
+	};
+
+	typedef fixed_page<const char*> fixed_t;
+	fixed_t& fixed() { return *reinterpret_cast<fixed_t*>(this); }
+public:
+	// or-ed into the field size given to `init` for variable-length keys
+	static constexpr int variable_keys = 1 << 16;
+	static constexpr uint16_t variable_magic = Leaf ? PAGE_KEY_LEAF : PAGE_KEY_INTERIOR;
+
+	using general_page::general_page;
+	PAGE_FIELD_REF(magic,       uint16_t, 0);   // page type
+	PAGE_FIELD_REF(field_size,  uint16_t, 2);   // size of the longest key
+	PAGE_FIELD_REF(size,        int,      4);   // number of items
+	PAGE_FIELD_REF(next_page,   int,      8);
+	PAGE_FIELD_REF(prev_page,   int,      12);
+	PAGE_FIELD_REF(heap,        int,      16);   // offset of the first key
+	PAGE_FIELD_REF(garbage,     int,      20);   // bytes of keys not used any more
+	PAGE_FIELD_PTR(slots,       slot_t,   24);
+	static constexpr int variable_header_size() { return 24; }
+
+	bool variable() { return magic() == variable_magic; }
+
+	/* bytes of `key` in a page made by `init(field_size)` */
+	static int key_size(const char *key, int field_size)
+	{
+		int size = field_size & ~variable_keys;
+		if(!(field_size & variable_keys)) return size;
+		if(!key[0]) return 1 + sizeof(int);   // NULL
+		int data_size = size - 1 - (int)sizeof(int);
+		int len = (int)strnlen(key + 1, data_size - 1) + 1;
+		return 1 + len + sizeof(int);
+	}
+
+	static int entry_size(const char *key, int field_size)
+	{
+		return key_size(key, field_size) + (field_size & variable_keys ? sizeof(slot_t) : sizeof(int));
+	}
+
+	static int usable_size(int page_size, int field_size)
+	{
+		return page_size - (field_size & variable_keys ? variable_header_size() : fixed_t::header_size());
+	}
+
+	int entry_size(int pos)
+	{
+		return variable() ? slots()[pos].length + sizeof(slot_t) : field_size() + sizeof(int);
+	}
+
+	// bytes of the items
+	int used()
+	{
+		if(!variable()) return size() * (field_size() + sizeof(int));
+		return size() * sizeof(slot_t) + page_size - heap() - garbage();
+	}
+
+	int usable() { return page_size - (variable() ? variable_header_size() : fixed_t::header_size()); }
+	bool empty() { return size() == 0; }
+
+	// one more child and a longer key of the child split fit
+	bool safe_for_insert()
+	{
+		if(!variable()) return fixed().safe_for_insert();
+		return free_size() + garbage() >= 2 * max_entry_size();
+	}
+
+	/* Less than half full. A variable-length page is allowed one entry
+	 * of the longest key less, so that both halves of a split are not. */
+	bool underflow()
+	{
+		if(!variable()) return fixed().underflow();
+		return used() < usable() / 2 - max_entry_size();
+	}
+
+	bool underflow_if_remove(int pos)
+	{
+		if(!variable()) return fixed().underflow_if_remove(pos);
+		return used() - entry_size(pos) < usable() / 2 - max_entry_size();
+	}
+
+	void init(int field_size)
+	{
+		fixed().init(field_size & ~variable_keys);
+		if(field_size & variable_keys)
+		{
+			magic_ref() = variable_magic;
+			heap_ref() = page_size;
+			garbage_ref() = 0;
+		} else if(Leaf) {
+			magic_ref() = PAGE_INDEX_LEAF;
+		}
+	}
+
+	const char* get_key(int pos)
+	{
+		if(!variable()) return fixed().get_key(pos);
+		assert(0 <= pos && pos < size());
+		return buf + slots()[pos].offset;
+	}
+
+	int get_child(int pos)
+	{
+		if(!variable()) return fixed().get_child(pos);
+		assert(0 <= pos && pos < size());
+		return slots()[pos].child;
+	}
+
+	void set_child(int pos, int child)
+	{
+		if(!variable()) return fixed().set_child(pos, child);
+		assert(0 <= pos && pos < size());
+		slots()[pos].child = child;
+	}
+
+	bool insert(int pos, const char *key, int child);
+	// `insert` of `key` succeeds
+	bool fits(const char *key, int)
+	{
+		if(!variable()) return !fixed().full();
+		return free_size() + garbage() >= key_size(key, field_size() | variable_keys) + (int)sizeof(slot_t);
+	}
+	void erase(int pos);
+	// false if a longer key does not fit
+	bool try_set_key(int pos, const char *key);
+	void set_key(int pos, const char *key)
+	{
+		bool succ = try_set_key(pos, key);
+		assert(succ);
+		UNUSED(succ);
+	}
+
+	/* fill an empty page with `n` keys `stride` bytes apart */
+	void assign(int n, const char *keys, int stride, const int *children);
+
+	std::pair<int, index_page> split(int cur_id, int lower_percent = 50);
+	bool merge(index_page page, int cur_id);
+	void move_from(index_page page, int src_pos, int dest_pos)
+	{
+		bool succ_ins = insert(dest_pos, page.get_key(src_pos), page.get_child(src_pos));
+		assert(succ_ins);
+		UNUSED(succ_ins);
+		page.erase(src_pos);
+	}
+
+private:
+	int max_entry_size() { return field_size() + sizeof(slot_t); }
+	int free_size() { return heap() - variable_header_size() - size() * (int)sizeof(slot_t); }
+	void compact();
+	void link_after(index_page &lower, int lower_id, int page_id);
+};
+
+template<bool Leaf>
+bool index_page<Leaf>::insert(int pos, const char *key, int child)
+{
+	if(!variable()) return fixed().insert(pos, key, child);
+	assert(0 <= pos && pos <= size());
+	int len = key_size(key, field_size() | variable_keys);
+	if(free_size() + garbage() < len + (int)sizeof(slot_t))
+		return false;
+	if(free_size() < len + (int)sizeof(slot_t))
+		compact();
+
+	heap_ref() -= len;
+	std::memcpy(buf + heap(), key, len);
+	slot_t *s = slots();
+	std::memmove(s + pos + 1, s + pos, (size() - pos) * sizeof(slot_t));
+	s[pos] = { child, (uint16_t)heap(), (uint16_t)len };
+	++size_ref();
+	return true;
+}
+
+template<bool Leaf>
+void index_page<Leaf>::erase(int pos)
+{
+	if(!variable()) return fixed().erase(pos);
+	assert(0 <= pos && pos < size());
+	slot_t *s = slots();
+	garbage_ref() += s[pos].length;
+	std::memmove(s + pos, s + pos + 1, (size() - pos - 1) * sizeof(slot_t));
+	if(--size_ref() == 0)
+	{
+		heap_ref() = page_size;
+		garbage_ref() = 0;
+	}
+}
+
+template<bool Leaf>
+bool index_page<Leaf>::try_set_key(int pos, const char *key)
+{
+	if(!variable())
+	{
+		fixed().set_key(pos, key);
+		return true;
+	}
+
+	assert(0 <= pos && pos < size());
+	int len = key_size(key, field_size() | variable_keys);
+	slot_t &s = slots()[pos];
+	if(len <= s.length)
+	{
+		std::memmove(buf + s.offset, key, len);
+		garbage_ref() += s.length - len;
+		s.length = len;
+		return true;
+	}
+
+	if(free_size() + garbage() + s.length < len)
+		return false;
+	garbage_ref() += s.length;
+	s.length = 0;
+	std::vector<char> copy;
+	if(free_size() < len)
+	{
+		// the key may be in this page
+		copy.assign(key, key + len);
+		key = copy.data();
+		compact();
+	}
+
+	heap_ref() -= len;
+	std::memcpy(buf + heap(), key, len);
+	s.offset = heap();
+	s.length = len;
+	return true;
+}
+
+template<bool Leaf>
+void index_page<Leaf>::compact()
+{
+	std::vector<char> keys(buf + heap(), buf + page_size);
+	int base = heap(), top = page_size;
+	slot_t *s = slots();
+	for(int i = 0; i != size(); ++i)
+	{
+		top -= s[i].length;
+		std::memcpy(buf + top, keys.data() + (s[i].offset - base), s[i].length);
+		s[i].offset = top;
+	}
+
+	heap_ref() = top;
+	garbage_ref() = 0;
+}
+
+template<bool Leaf>
+void index_page<Leaf>::assign(int n, const char *keys, int stride, const int *children)
+{
+	assert(empty());
+	if(!variable())
+	{
+		assert(stride == field_size());
+		size_ref() = n;
+		std::memcpy(fixed().children(), children, n * sizeof(int));
+		std::memcpy(fixed().end() - n * stride, keys, n * stride);
+		return;
+	}
+
+	for(int i = 0; i != n; ++i)
+	{
+		bool succ_ins = insert(i, keys + i * stride, children[i]);
+		assert(succ_ins);
+		UNUSED(succ_ins);
+	}
+}
+
+template<bool Leaf>
+void index_page<Leaf>::link_after(index_page &lower, int lower_id, int page_id)
+{
+	if(lower.next_page())
+	{
+		index_page page { pg->read_for_write(lower.next_page()), pg };
+		std::lock_guard<std::shared_mutex> latch(page.guard.latch());
+		assert(page.magic() == variable_magic);
+		page.prev_page_ref() = page_id;
+	}
+
+	next_page_ref() = lower.next_page();
+	prev_page_ref() = lower_id;
+	lower.next_page_ref() = page_id;
+}
+
+template<bool Leaf>
+std::pair<int, index_page<Leaf>> index_page<Leaf>::split(int cur_id, int lower_percent)
+{
+	if(!variable())
+	{
+		auto pw = fixed().split(cur_id, lower_percent);
+		if(!pw.first) return { 0, { nullptr, nullptr } };
+		return { pw.first, { std::move(pw.second.guard), pg } };
+	}
+
+	if(size() < PAGE_BLOCK_MIN_NUM)
+		return { 0, { nullptr, nullptr } };
+
+	int page_id = pg->new_page(cur_id);
+	if(!page_id) return { 0, { nullptr, nullptr } };
+	index_page upper_page { pg->read_for_write(page_id), pg };
+	upper_page.init(field_size() | variable_keys);
+	upper_page.link_after(*this, cur_id, page_id);
+
+	// the lower part keeps about `lower_percent` of the bytes
+	int lower_max = used() * lower_percent / 100, lower_size = 1, lower_used = entry_size(0);
+	while(lower_size < size() - 1 && lower_used + entry_size(lower_size) <= lower_max)
+		lower_used += entry_size(lower_size++);
+
+	for(int i = lower_size; i != size(); ++i)
+	{
+		bool succ_ins = upper_page.insert(i - lower_size, get_key(i), get_child(i));
+		assert(succ_ins);
+		UNUSED(succ_ins);
+		garbage_ref() += slots()[i].length;
+	}
+
+	size_ref() = lower_size;
+	return { page_id, upper_page };
+}
+
+template<bool Leaf>
+bool index_page<Leaf>::merge(index_page page, int cur_id)
+{
+	assert(variable() == page.variable());
+	if(!variable())
+		return fixed().merge(page.fixed(), cur_id);
+	if(used() + page.used() > usable())
+		return false;
+
+	next_page_ref() = page.next_page();
+	if(next_page())
+	{
+		index_page next { pg->read_for_write(next_page()), pg };
+		std::lock_guard<std::shared_mutex> latch(next.guard.latch());
+		next.prev_page_ref() = cur_id;
+	}
+
+	for(int i = 0; i != page.size(); ++i)
+	{
+		bool succ_ins = insert(size(), page.get_key(i), page.get_child(i));
+		assert(succ_ins);
+		UNUSED(succ_ins);
+	}
+
+	return true;
+}
+
+#endif
@@ -15,7 +15,7 @@ public:
 	PAGE_FIELD_REF(next,  int,      4);
 	PAGE_FIELD_PTR(block, char,     8);
 	static constexpr int header_size() { return 8; }
-	static constexpr int block_size()  { return PAGE_SIZE - header_size(); }
+	int block_size() { return page_size - header_size(); }
 
 	void init()
 	{
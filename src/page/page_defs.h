@@ -2,7 +2,9 @@
 #define __TRIVIALDB_PAGE_DEFS__
 
 #include <stdint.h>
+#include <utility>
 #include "../defs.h"
+#include "../fs/page_fs.h"
 
 #define PAGE_FIELD_REF(name, type, offset) \
 	type name() { return *reinterpret_cast<type*>(buf + offset); } \
@@ -23,13 +25,23 @@
 
 class pager;
 
+/* Page offsets and sizes are stored in 16 bits */
+static_assert(PAGE_MAX_SIZE <= 65536, "page offsets do not fit in uint16_t");
+
+/* A page keeps its frame pinned if it is made from a `page_guard`.
+ * `page_size` is the page size of its file. */
 struct general_page
 {
 	char* buf;
 	pager* pg;
+	page_guard guard;
+	int page_size;
 	general_page(char *buf, pager *pg)
-		: buf(buf), pg(pg) {}
+		: buf(buf), pg(pg), page_size(PAGE_SIZE) {}
+	general_page(page_guard guard, pager *pg)
+		: buf(guard.get()), pg(pg), guard(std::move(guard)), page_size(this->guard.size()) {}
 	general_page(const general_page&) = default;
+	general_page& operator = (const general_page&) = default;
 
 	static uint16_t get_magic_number(const void* addr) {
 		return *reinterpret_cast<const uint16_t*>(addr);
@@ -2,6 +2,8 @@
 #define __TRIVIALDB_PAGER__
 
 #include <utility>
+#include <algorithm>
+#include <cstring>
 #include "../fs/page_file.h"
 #include "overflow_page.h"
 
@@ -12,13 +14,74 @@ public:
 
 	void free_overflow_page(int page_id, bool recursive = true)
 	{
-		auto ov_page = overflow_page(read_for_write(page_id), this);
-		assert(ov_page.magic() == PAGE_OVERFLOW);
-		int next_page_id = ov_page.next();
+		int next_page_id;
+		{
+			auto ov_page = overflow_page(read(page_id), this);
+			assert(ov_page.magic() == PAGE_OVERFLOW);
+			next_page_id = ov_page.next();
+		}
+		// not pinned any more, so the page is dropped without a write
 		free_page(page_id);
 		if(recursive && next_page_id)
 			free_overflow_page(next_page_id, true);
 	}
+
+	/* Store `size` bytes in the chain of overflow pages at `page_id`,
+	 * a new chain if 0, which grows or shrinks to fit. Pages which hold
+	 * the same bytes already are not written. Return the first page. */
+	int write_overflow(int page_id, const void *data, int size)
+	{
+		const char *p = (const char*)data;
+		if(!page_id) page_id = new_page();
+		int first_page_id = page_id;
+		for(;;)
+		{
+			auto page = overflow_page(read(page_id), this);
+			bool fresh = page.magic() != PAGE_OVERFLOW;
+			int n = std::min(size, page.block_size());
+			int next_page_id = fresh ? 0 : page.next();
+			if(size > n && !next_page_id)
+				next_page_id = new_page(page_id);
+			else if(size == n && next_page_id) {
+				free_overflow_page(next_page_id);
+				next_page_id = 0;
+			}
+
+			if(fresh || page.size() != n || page.next() != next_page_id
+				|| std::memcmp(page.block(), p, n) != 0)
+			{
+				page.guard.mark_dirty();
+				page.init();
+				page.size_ref() = n;
+				page.next_ref() = next_page_id;
+				std::memcpy(page.block(), p, n);
+			}
+			if(size == n) break;
+			p += n;
+			size -= n;
+			page_id = next_page_id;
+		}
+		return first_page_id;
+	}
+
+	/* read `size` bytes stored by `write_overflow`, false if the chain
+	 * holds fewer */
+	bool read_overflow(int page_id, void *data, int size)
+	{
+		char *p = (char*)data;
+		while(size && page_id)
+		{
+			auto page = overflow_page(read(page_id), this);
+			if(page.magic() != PAGE_OVERFLOW)
+				return false;
+			int n = std::min(size, (int)page.size());
+			std::memcpy(p, page.block(), n);
+			p += n;
+			size -= n;
+			page_id = page.next();
+		}
+		return size == 0;
+	}
 };
 
 #endif
@@ -12,7 +12,7 @@ void variant_page::init(int)
 	magic_ref() = PAGE_VARIANT;
 	flags_ref() = 0;
 	free_block_ref() = 0;
-	free_size_ref() = PAGE_SIZE - header_size();
+	free_size_ref() = page_size - header_size();
 	size_ref() = 0;
 	bottom_used_ref() = 0;
 	next_page_ref() = prev_page_ref() = 0;
@@ -39,7 +39,7 @@ void variant_page::erase(int pos, bool follow_ov_page)
 void variant_page::set_freeblock(int offset)
 {
 	block_header *header = (block_header*)(buf + offset);
-	if(offset + bottom_used() == PAGE_SIZE)
+	if(offset + bottom_used() == page_size)
 	{
 		bottom_used_ref() -= header->size;
 	} else {
@@ -54,7 +54,7 @@ bool variant_page::insert(int pos, const char *data, int data_size)
 {
 	assert(0 <= pos && pos <= size());
 	int real_size = data_size + sizeof(block_header);
-	bool ov = (real_size > PAGE_BLOCK_MAX_SIZE);
+	bool ov = (real_size > PAGE_BLOCK_MAX_SIZE(page_size));
 	int size_required = ov ? PAGE_OV_KEEP_SIZE : real_size;
 	char *dest = allocate(size_required);
 	if(!dest) return false;
@@ -78,8 +78,10 @@ bool variant_page::insert(int pos, const char *data, int data_size)
 	{
 		header->ov_page = 0;
 	} else {
+		int last_pid = 0;
 		auto create_and_copy = [&](const char *src, int size) {
-			int pid = pg->new_page();
+			// keep the chain together
+			int pid = last_pid = pg->new_page(last_pid);
 			overflow_page page = overflow_page(pg->read_for_write(pid), pg);
 			page.init();
 			page.size_ref() = size;
@@ -87,9 +89,11 @@ bool variant_page::insert(int pos, const char *data, int data_size)
 			return std::make_pair(pid, page);
 		};
 
+		// overflow pages are in the same file, so of the same size
+		int ov_block_size = page_size - overflow_page::header_size();
 		data += copied_size;
 		int remain = data_size - copied_size;
-		int to_copy = std::min(overflow_page::block_size(), remain);
+		int to_copy = std::min(ov_block_size, remain);
 
 		auto ret = create_and_copy(data, to_copy);
 		overflow_page ov_page = ret.second;
@@ -99,7 +103,7 @@ bool variant_page::insert(int pos, const char *data, int data_size)
 
 		while(remain > 0)
 		{
-			to_copy = std::min(overflow_page::block_size(), remain);
+			to_copy = std::min(ov_block_size, remain);
 			auto ret = create_and_copy(data, to_copy);
 			ov_page.next_ref() = ret.first;
 			ov_page = ret.second;
@@ -111,11 +115,11 @@ bool variant_page::insert(int pos, const char *data, int data_size)
 	return true;
 }
 
-std::pair<int, variant_page> variant_page::split(int cur_id)
+std::pair<int, variant_page> variant_page::split(int cur_id, int lower_percent)
 {
 	if(size() < PAGE_BLOCK_MIN_NUM)
 		return { 0, { nullptr, nullptr } };
-	int page_id = pg->new_page();
+	int page_id = pg->new_page(cur_id);
 	if(!page_id) return { 0, { nullptr, nullptr } };
 	variant_page upper_page { pg->read_for_write(page_id), pg };
 	upper_page.init();
@@ -124,6 +128,7 @@ std::pair<int, variant_page> variant_page::split(int cur_id)
 	if(next_page())
 	{
 		variant_page page { pg->read_for_write(next_page()), pg };
+		std::lock_guard<std::shared_mutex> latch(page.guard.latch());
 		assert(page.magic() == magic());
 		page.prev_page_ref() = page_id;
 	}
@@ -131,8 +136,8 @@ std::pair<int, variant_page> variant_page::split(int cur_id)
 	upper_page.prev_page_ref() = cur_id;
 	next_page_ref() = page_id;
 
-	int to_move = used_size() / 2, moved = 0;
-	char *dest_addr = upper_page.buf + PAGE_SIZE;
+	int to_move = used_size() * (100 - lower_percent) / 100, moved = 0;
+	char *dest_addr = upper_page.buf + upper_page.page_size;
 	uint16_t *dest_slots = upper_page.slots();
 	for(int i = size() - 1; i >= PAGE_BLOCK_MIN_NUM / 2; --i)
 	{
@@ -168,7 +173,7 @@ std::pair<int, variant_page> variant_page::split(int cur_id)
 
 bool variant_page::merge(variant_page page, int cur_id)
 {
-	int space_req = PAGE_SIZE - page.free_size() - header_size();
+	int space_req = page_size - page.free_size() - header_size();
 	if(space_req > free_size())
 		return false;
 
@@ -176,6 +181,7 @@ bool variant_page::merge(variant_page page, int cur_id)
 	if(next_page())
 	{
 		variant_page page { pg->read_for_write(next_page()), pg };
+		std::lock_guard<std::shared_mutex> latch(page.guard.latch());
 		assert(page.magic() == magic());
 		page.prev_page_ref() = cur_id;
 	}
@@ -183,7 +189,7 @@ bool variant_page::merge(variant_page page, int cur_id)
 	defragment();
 	uint16_t *src_slot = page.slots();
 	uint16_t *dest_slot = slots() + size();
-	char *dest = buf + PAGE_SIZE - bottom_used();
+	char *dest = buf + page_size - bottom_used();
 	for(int i = 0, t = page.size(); i < t; ++i)
 	{
 		char *src = page.buf + *src_slot++;
@@ -204,7 +210,7 @@ char* variant_page::allocate(int sz)
 {
 	if(free_size() < sz + 2) return nullptr;  // no space for data
 
-	int unallocated = PAGE_SIZE - (header_size() + size() * 2 + bottom_used());
+	int unallocated = page_size - (header_size() + size() * 2 + bottom_used());
 	auto free_blk = LOAD_FREEBLK(free_block());
 
 	if(unallocated < 2 && free_size() - 2 >= sz)
@@ -232,7 +238,7 @@ char* variant_page::allocate(int sz)
 		// minus one slot size for this item
 		bottom_used_ref() += sz;
 		free_size_ref() -= sz;
-		return buf + PAGE_SIZE - bottom_used();
+		return buf + page_size - bottom_used();
 	} else if(free_size() - 2 >= sz) {
 		defragment();
 		return allocate(sz);
@@ -251,7 +257,7 @@ void variant_page::defragment()
 	} );
 
 	int total_blk_sz = 0;
-	char *ptr = buf + PAGE_SIZE;
+	char *ptr = buf + page_size;
 	for(int i = 0; i < sz; ++i)
 	{
 		char *blk = buf + slots_ptr[index[i]];
@@ -267,7 +273,7 @@ void variant_page::defragment()
 	free_block_ref()  = 0;
 	bottom_used_ref() = total_blk_sz;
 
-	assert(total_blk_sz + header_size() + 2 * size() + free_size() == PAGE_SIZE);
+	assert(total_blk_sz + header_size() + 2 * size() + free_size() == page_size);
 }
 
 void variant_page::move_from(variant_page page, int src_pos, int dest_pos)
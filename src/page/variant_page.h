@@ -11,6 +11,8 @@
  * then part of it will be stored in overflow pages and the first
  * PAGE_OV_KEEP_SIZE will stay in the data page. If S <= PAGE_BLOCK_MAX_SIZE,
  * all the data will be stored in the data page.
+ * Offsets are 16-bit, a page of PAGE_MAX_SIZE bytes still fits since
+ * no block starts at offset 0 (the header is there).
  * */
 
 class variant_page : public general_page
@@ -47,12 +49,12 @@ public:
 	PAGE_FIELD_PTR(slots,       uint16_t, 20);  // slots
 	static constexpr int header_size() { return 20; }
 	int used_size() {
-		return PAGE_SIZE - free_size() - size() * 2 - header_size();
+		return page_size - free_size() - size() * 2 - header_size();
 	}
 
 	bool underflow()
 	{
-		return free_size() > PAGE_FREE_SPACE_MAX
+		return free_size() > PAGE_FREE_SPACE_MAX(page_size)
 			|| size() < PAGE_BLOCK_MIN_NUM / 2;
 	}
 
@@ -60,21 +62,29 @@ public:
 	{
 		assert(0 <= pos && pos < size());
 		int free_size_if_remove = free_size() - get_block(pos).first.size - 2;
-		return free_size_if_remove > PAGE_FREE_SPACE_MAX
+		return free_size_if_remove > PAGE_FREE_SPACE_MAX(page_size)
 			|| size() - 1 < PAGE_BLOCK_MIN_NUM / 2;
 	}
 
 	void init(int = 0);
 	void erase(int pos) { erase(pos, true); }
 	bool insert(int pos, const char *data, int data_size);
+	// `insert` of `data_size` bytes succeeds
+	bool fits(const char*, int data_size)
+	{
+		int real_size = data_size + sizeof(block_header);
+		if(real_size > PAGE_BLOCK_MAX_SIZE(page_size))
+			real_size = PAGE_OV_KEEP_SIZE;
+		return free_size() >= real_size + 2;
+	}
 	void move_from(variant_page page, int src_pos, int dest_pos);
 
 	/* Split the (full) page into two parts, each of which has at least
 	 * (PAGE_BLOCK_MIN_NUM / 2) used blocks, and the upper part of the
 	 * splited page id is returned. If the block requirement cannnot be
-	 * satisfied, 0 is returned. The free_size of the two parts is
-	 * as close as possible. */
-	std::pair<int, variant_page> split(int cur_id);
+	 * satisfied, 0 is returned. The lower part keeps about
+	 * `lower_percent` of the used bytes. */
+	std::pair<int, variant_page> split(int cur_id, int lower_percent = 50);
 	bool merge(variant_page page, int cur_id);
 
 	std::pair<block_header, char*> get_block(int id)
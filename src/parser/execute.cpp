@@ -78,6 +78,27 @@ void execute_switch_output(const char* output_filename)
 	free((void*)output_filename);
 }
 
+void execute_set_variable(const char* name, const char* value)
+{
+	dbms::get_instance()->set_variable(name, value);
+	free((void*)name);
+	free((void*)value);
+}
+
+void execute_set_table_option(const char* table_name, const char* name, const char* value)
+{
+	dbms::get_instance()->set_table_option(table_name, name, value);
+	free((void*)table_name);
+	free((void*)name);
+	free((void*)value);
+}
+
+void execute_show_variable(const char* name)
+{
+	dbms::get_instance()->show_variable(name);
+	free((void*)name);
+}
+
 void execute_create_table(const table_def_t* table)
 {
 	table_header_t* header = new table_header_t;
@@ -106,10 +127,11 @@ void execute_create_table(const table_def_t* table)
 	free((void*)table);
 }
 
-void execute_create_database(const char* db_name)
+void execute_create_database(const char* db_name, const char* page_size, int tablespace)
 {
-	dbms::get_instance()->create_database(db_name);
+	dbms::get_instance()->create_database(db_name, page_size, tablespace);
 	free((char*)db_name);
+	free((char*)page_size);
 }
 
 void execute_use_database(const char* db_name)
@@ -130,6 +152,12 @@ void execute_show_database(const char* db_name)
 	free((void*)db_name);
 }
 
+void execute_backup_database(const char* dir)
+{
+	dbms::get_instance()->backup_database(dir);
+	free((void*)dir);
+}
+
 void execute_drop_table(const char* table_name)
 {
 	dbms::get_instance()->drop_table(table_name);
@@ -219,11 +247,18 @@ void execute_drop_index(const char* table_name, const char* col_name)
 	free((char*)col_name);
 }
 
+void execute_commit()
+{
+	dbms::get_instance()->commit();
+}
+
 void execute_quit()
 {
 	// 日志记录系统退出
 	Logger::get_instance()->log(LogLevel::INFO, OperationType::SYSTEM_QUIT, "EXIT;", true, "TrivialDB session ended");
+	dbms::get_instance()->save_buffer_pool();
 	dbms::get_instance()->close_database();
+	dbms::get_instance()->checkpoint();
 	printf("[exit] good bye!\n");
 }
 
@@ -7,10 +7,11 @@
 extern "C" {
 #endif
 
-void execute_create_database(const char *db_name);
+void execute_create_database(const char *db_name, const char *page_size, int tablespace);
 void execute_use_database(const char *db_name);
 void execute_drop_database(const char *db_name);
 void execute_show_database(const char *db_name);
+void execute_backup_database(const char *dir);
 void execute_create_table(const table_def_t *table);
 void execute_drop_table(const char *table_name);
 void execute_show_table(const char *table_name);
@@ -21,6 +22,10 @@ void execute_update(const update_info_t *update_info);
 void execute_create_index(const char *table_name, const char *col_name);
 void execute_drop_index(const char *table_name, const char *col_name);
 void execute_switch_output(const char *output_filename);
+void execute_set_variable(const char *name, const char *value);
+void execute_set_table_option(const char *table_name, const char *name, const char *value);
+void execute_show_variable(const char *name);
+void execute_commit();
 void execute_quit();
 void execute_rename_table(const rename_info_t *rename_info);
 void execute_alter_table(const alter_info_t *alter_info);
@@ -53,8 +53,8 @@ void yyerror(const char *s);
 %token LEFT RIGHT FULL ASC DESC ORDER BY IN ON AS
 %token DISTINCT GROUP USING INDEX TABLE DATABASE
 %token DEFAULT UNIQUE PRIMARY FOREIGN REFERENCES CHECK KEY OUTPUT
-%token ALTER RENAME TO ADD COLUMN MODIFY
-%token USE CREATE DROP SELECT INSERT UPDATE DELETE SHOW SET EXIT
+%token ALTER RENAME TO ADD COLUMN MODIFY PAGESIZE TABLESPACE
+%token USE CREATE DROP SELECT INSERT UPDATE DELETE SHOW SET EXIT BACKUP
 
 %token IDENTIFIER
 %token DATE_LITERAL
@@ -68,7 +68,7 @@ void yyerror(const char *s);
 
 %type <val_i> field_type field_width field_flag field_flags
 %type <val_i> opt_distinct
-%type <val_s> table_name database_name
+%type <val_s> table_name database_name variable_value
 %type <val_s> create_database_stmt use_database_stmt drop_database_stmt show_database_stmt 
 %type <val_s> drop_table_stmt show_table_stmt
 %type <rename_info> rename_table_stmt
@@ -95,25 +95,32 @@ void yyerror(const char *s);
 
 %%
 
-sql_stmts  :  sql_stmt
-		   |  sql_stmts sql_stmt
+sql_stmts  :  sql_stmt              { execute_commit(); }
+		   |  sql_stmts sql_stmt    { execute_commit(); }
 		   ;
 
 sql_stmt   :  create_table_stmt ';'    { execute_create_table($1); }
-		   |  create_database_stmt ';' { execute_create_database($1); }
+		   |  create_database_stmt ';' { execute_create_database($1, NULL, 0); }
+		   |  create_database_stmt PAGESIZE '=' variable_value ';' { execute_create_database($1, $4, 0); }
+		   |  create_database_stmt TABLESPACE ';' { execute_create_database($1, NULL, 1); }
+		   |  create_database_stmt PAGESIZE '=' variable_value TABLESPACE ';' { execute_create_database($1, $4, 1); }
 		   |  use_database_stmt ';'    { execute_use_database($1); }
 		   |  show_database_stmt ';'   { execute_show_database($1); }
 		   |  drop_database_stmt ';'   { execute_drop_database($1); }
+		   |  BACKUP DATABASE TO STRING_LITERAL ';' { execute_backup_database($4); }
 		   |  show_table_stmt ';'      { execute_show_table($1); }
 		   |  drop_table_stmt ';'      { execute_drop_table($1); }
 		   |  rename_table_stmt ';'    { execute_rename_table($1); }
 		   |  alter_table_stmt ';'     { execute_alter_table($1); }
+		   |  ALTER TABLE table_name SET IDENTIFIER '=' variable_value ';' { execute_set_table_option($3, $5, $7); }
 		   |  insert_stmt ';'          { execute_insert($1); }
 		   |  update_stmt ';'          { execute_update($1); }
 		   |  delete_stmt ';'          { execute_delete($1); }
 		   |  select_stmt ';'          { execute_select($1); }
 		   |  EXIT ';'                 { execute_quit(); exit(0); }
 		   |  SET OUTPUT '=' STRING_LITERAL ';'  { execute_switch_output($4); }
+		   |  SET IDENTIFIER '=' variable_value ';'  { execute_set_variable($2, $4); }
+		   |  SHOW IDENTIFIER ';'      { execute_show_variable($2); }
 		   |  CREATE INDEX table_name '(' IDENTIFIER ')' ';' { execute_create_index($3, $5); }
 		   |  DROP   INDEX table_name '(' IDENTIFIER ')' ';' { execute_drop_index($3, $5); }
 		   ;
@@ -712,6 +719,14 @@ table_name : IDENTIFIER          { $$ = $1; }
 database_name : IDENTIFIER       { $$ = $1; }
 			  ;
 
+variable_value : IDENTIFIER      { $$ = $1; }
+			   | STRING_LITERAL  { $$ = $1; }
+			   | INT_LITERAL     {
+					$$ = (char*)malloc(16);
+					sprintf($$, "%d", $1);
+			   }
+			   ;
+
 %%
 
 void yyerror(const char *msg)
@@ -17,6 +17,7 @@ void record_manager::open(int pid, int pos, bool dirty)
 		auto block = page.get_block(pos);
 		remain = block.first.size - sizeof(data_page<int>::block_header);
 		next_pid = block.first.ov_page;
+		cur_page = page.guard;
 		cur_buf = block.second;
 	}
 }
@@ -33,6 +34,7 @@ record_manager& record_manager::seek(int offset)
 		auto block = page.get_block(pos);
 		remain = block.first.size - sizeof(data_page<int>::block_header);
 		next_pid = block.first.ov_page;
+		cur_page = page.guard;
 		cur_buf = block.second;
 		forward(offset);
 	}
@@ -46,8 +48,9 @@ record_manager& record_manager::write(const void *b, int size)
 	while(size)
 	{
 		int l = size < remain ? size : remain;
+		// before the change, a snapshot may keep the page as it was
+		if(!dirty) cur_page.mark_dirty();
 		std::memcpy(cur_buf, data, l);
-		if(!dirty) pg->mark_dirty(cur_pid);
 		data += l;
 		size -= l;
 		forward(l);
@@ -80,6 +83,7 @@ record_manager& record_manager::forward(int size)
 	{
 		overflow_page page { dirty ? pg->read_for_write(next_pid) : pg->read(next_pid), pg };
 		remain += page.size();
+		cur_page = page.guard;
 		cur_buf = page.block() + (page.size() - remain);
 		cur_pid = next_pid;
 		next_pid = page.next();
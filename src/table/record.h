@@ -9,6 +9,7 @@ class record_manager
 {
 	pager *pg;
 	int pid, pos, cur_pid;
+	page_guard cur_page;  // keep the current page pinned
 	char *cur_buf;
 	int remain, next_pid, offset;
 	bool dirty;
@@ -32,7 +33,7 @@ public:
 inline std::pair<char*, int> record_manager::ptr_for_write()
 {
 	if(!dirty)
-		pg->mark_dirty(cur_pid);
+		cur_page.mark_dirty();
 	return { cur_buf, remain };
 }
 
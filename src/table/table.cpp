@@ -5,15 +5,19 @@
 #include "../database/dbms.h"
 #include <cstdio>
 #include <cassert>
+#include <climits>
 #include <cstdio>
 #include <cstring>
 #include <string>
 
-index_manager::comparer_t get_index_comparer(int type)
+typedef int(*comparer_t)(const char*, const char*);
+
+comparer_t get_index_comparer(int type)
 {
 	switch(type)
 	{
 		case COL_TYPE_INT:
+		case COL_TYPE_DATE:
 			return integer_bin_comparer;
 		case COL_TYPE_FLOAT:
 			return float_bin_comparer;
@@ -28,7 +32,7 @@ index_manager::comparer_t get_index_comparer(int type)
 record_manager table_manager::open_record_from_index_lower_bound(
 	std::pair<int, int> idx_pos, int *rid)
 {
-	index_btree::leaf_page page { pg->read(idx_pos.first), pg.get() };
+	index_page<true> page { pg->read(idx_pos.first), pg.get() };
 	int r = page.get_child(idx_pos.second);
 	record_manager rm = get_record_ptr_lower_bound(r, false);
 	if(rid != nullptr) rm.read(rid, 4);
@@ -85,7 +89,7 @@ void table_manager::load_indices()
 			indices[i] = new index_manager(pg.get(),
 				header.col_length[i],
 				header.index_root[i],
-				get_index_comparer(header.col_type[i])
+				header.col_type[i]
 			);
 		}
 	}
@@ -140,67 +144,159 @@ std::shared_ptr<table_manager> table_manager::mirror(const char *alias_name)
 	return tb;
 }
 
-bool table_manager::open(const char *table_name)
+bool table_manager::open(const char *table_name, std::shared_ptr<pager> space, int header_page)
 {
 	if(is_open) return false;
 	tname = table_name;
-	// 文件存储在项目根目录的database/文件夹下
-	std::string thead = "../../database/" + tname + ".thead";
-	std::string tdata = "../../database/" + tname + ".tdata";
+	this->header_page = header_page;
+	if(space)
+	{
+		if(!space->read_overflow(header_page, &header, sizeof(header))) {
+			std::fprintf(stderr, "[Error] Failed to read the header of table `%s`\n", table_name);
+			return false;
+		}
+		pg = space;
+	} else {
+		// 文件存储在项目根目录的database/文件夹下
+		std::string thead = "../../database/" + tname + ".thead";
+		std::string tdata = "../../database/" + tname + ".tdata";
 
-	std::ifstream ifs(thead, std::ios::binary);
-	if(!ifs || !ifs.read((char*)&header, sizeof(header))) {
-		std::fprintf(stderr, "[Error] Failed to read table header file: %s\n", thead.c_str());
-		return false;
+		std::ifstream ifs(thead, std::ios::binary);
+		if(!ifs || !ifs.read((char*)&header, sizeof(header))) {
+			std::fprintf(stderr, "[Error] Failed to read table header file: %s\n", thead.c_str());
+			return false;
+		}
+		pg = std::make_shared<pager>(tdata.c_str());
 	}
-	pg = std::make_shared<pager>(tdata.c_str());
 	btr = std::make_shared<int_btree>(
 			pg.get(), header.index_root[header.main_index]);
 	allocate_temp_record();
 	load_indices();
+	upgrade_indices();
 	load_check_constraints();
 
 	is_mirror = false;
 	return is_open = true;
 }
 
-bool table_manager::create(const char *table_name, const table_header_t *header)
+bool table_manager::create(const char *table_name, const table_header_t *header, int page_size,
+	std::shared_ptr<pager> space)
 {
 	if(is_open) return false;
 	tname = table_name;
-	// 文件存储在项目根目录的database/文件夹下
-	std::string tdata = "../../database/" + tname + ".tdata";
-	std::string thead = "../../database/" + tname + ".thead";
-
-	pg = std::make_shared<pager>(tdata.c_str());
+	header_page = 0;
+	if(space)
+	{
+		pg = space;
+		// taken before the tree, so that the header is near the catalog
+		header_page = pg->write_overflow(0, header, sizeof(*header));
+	} else {
+		// 文件存储在项目根目录的database/文件夹下
+		std::string tdata = "../../database/" + tname + ".tdata";
+		pg = std::make_shared<pager>(tdata.c_str(), page_size);
+	}
 	btr = std::make_shared<int_btree>(pg.get(), 0);
 
 	this->header = *header;
 	this->header.index_root[header->main_index] = btr->get_root_page_id();
+	this->header.index_key_version = INDEX_KEY_VERSION;
 	allocate_temp_record();
 	load_indices();
 	load_check_constraints();
 
 	// 立即保存表头文件
-	std::ofstream ofs(thead, std::ios::binary);
-	if(ofs) {
-		ofs.write((char*)&this->header, sizeof(this->header));
-		ofs.close();
-	}
+	save_header();
 
 	is_mirror = false;
 	return is_open = true;
 }
 
+/* free the pages of a tree in a tablespace, with the overflow pages of
+ * its records */
+static void free_tree(pager *pg, int page_id)
+{
+	std::vector<int> children, overflow;
+	{
+		page_guard guard = pg->read(page_id);
+		uint16_t magic = general_page::get_magic_number(guard.get());
+		if(magic == PAGE_FIXED)
+		{
+			// the children come first whatever the key type
+			fixed_page<int> page { guard, pg };
+			for(int i = 0; i != page.size(); ++i)
+				children.push_back(page.get_child(i));
+		} else if(magic == PAGE_KEY_INTERIOR) {
+			index_page<false> page { guard, pg };
+			for(int i = 0; i != page.size(); ++i)
+				children.push_back(page.get_child(i));
+		} else if(magic == PAGE_VARIANT) {
+			data_page<int> page { guard, pg };
+			for(int i = 0; i != page.size(); ++i)
+			{
+				int ov_page = page.get_block(i).first.ov_page;
+				if(ov_page) overflow.push_back(ov_page);
+			}
+		}
+	}
+
+	for(int child : children)
+		free_tree(pg, child);
+	for(int ov_page : overflow)
+		pg->free_overflow_page(ov_page);
+	pg->free_page(page_id);
+}
+
+/* indices whose keys are encoded as before are built again */
+void table_manager::upgrade_indices()
+{
+	if(header.index_key_version == INDEX_KEY_VERSION)
+		return;
+	header.index_key_version = INDEX_KEY_VERSION;
+	for(int i = 0; i < header.col_num; ++i)
+	{
+		if(i == header.main_index || !((1u << i) & header.flag_indexed))
+			continue;
+		delete indices[i];
+		if(header.index_root[i])
+			free_tree(pg.get(), header.index_root[i]);
+		header.index_root[i] = 0;
+		indices[i] = new index_manager(pg.get(), header.col_length[i], 0, header.col_type[i]);
+		int num = build_index(i, INDEX_FILL_PERCENT);
+		std::printf("[Info] Index on column `%s` of table `%s` rebuilt: %d records\n",
+			header.col_name[i], header.table_name, num);
+	}
+}
+
 void table_manager::drop()
 {
 	if(!is_open) return;
+	if(header_page)
+	{
+		// the pages go back to the tablespace
+		std::shared_ptr<pager> space = pg;
+		int first_page = header_page;
+		sync_roots();
+		std::vector<int> roots;
+		for(int i = 0; i < header.col_num; ++i)
+		{
+			if(i == header.main_index || ((1u << i) & header.flag_indexed))
+				roots.push_back(header.index_root[i]);
+		}
+		close();
+		for(int root : roots)
+		{
+			if(root) free_tree(space.get(), root);
+		}
+		space->free_overflow_page(first_page);
+		return;
+	}
+
 	close();
 	// 文件存储在项目根目录的database/文件夹下
 	std::string thead = "../../database/" + tname + ".thead";
 	std::string tdata = "../../database/" + tname + ".tdata";
-	std::remove(thead.c_str());
-	std::remove(tdata.c_str());
+	page_fs::get_instance()->remove_file(thead.c_str());
+	page_fs::get_instance()->remove_file(tdata.c_str());
 }
 
 bool table_manager::alter_table_add_column(const field_item_t *field)
@@ -326,9 +422,7 @@ bool table_manager::alter_table_add_column(const field_item_t *field)
 	allocate_temp_record();
 	
 	// 保存修改后的表头
-	std::string thead = "../../database/" + tname + ".thead";
-	FILE *f = std::fopen(thead.c_str(), "wb");
-	if(!f) {
+	if(!save_header()) {
 		std::fprintf(stderr, "[Error] ALTER TABLE: failed to save table header\n");
 		// 回滚表头修改
 		header = old_header;
@@ -336,9 +430,6 @@ bool table_manager::alter_table_add_column(const field_item_t *field)
 		return false;
 	}
 	
-	std::fwrite(&header, sizeof(header), 1, f);
-	std::fclose(f);
-	
 	std::printf("[Info] ALTER TABLE: column `%s` added successfully\n", field->name);
 	return true;
 }
@@ -427,9 +518,7 @@ bool table_manager::alter_table_drop_column(const char *column_name)
 	allocate_temp_record();
 	
 	// 保存修改后的表头
-	std::string thead = "../../database/" + tname + ".thead";
-	FILE *f = std::fopen(thead.c_str(), "wb");
-	if(!f) {
+	if(!save_header()) {
 		std::fprintf(stderr, "[Error] ALTER TABLE DROP COLUMN: failed to save table header\n");
 		// 回滚表头修改
 		header = old_header;
@@ -437,9 +526,6 @@ bool table_manager::alter_table_drop_column(const char *column_name)
 		return false;
 	}
 	
-	std::fwrite(&header, sizeof(header), 1, f);
-	std::fclose(f);
-	
 	std::printf("[Info] ALTER TABLE DROP COLUMN: column `%s` dropped successfully\n", column_name);
 	return true;
 }
@@ -483,18 +569,13 @@ bool table_manager::alter_table_rename_column(const char *old_name, const char *
 	std::strncpy(header.col_name[col_index], new_name, MAX_NAME_LEN);
 
 	// 保存修改后的表头
-	std::string thead = "../../database/" + tname + ".thead";
-	std::ofstream ofs(thead, std::ios::binary);
-	if(!ofs) {
+	if(!save_header()) {
 		std::fprintf(stderr, "[Error] ALTER TABLE RENAME COLUMN: failed to save table header\n");
 		// 回滚表头修改
 		header = old_header;
 		return false;
 	}
 	
-	ofs.write((char*)&header, sizeof(header));
-	ofs.close();
-	
 	std::printf("[Info] ALTER TABLE RENAME COLUMN: column `%s` renamed to `%s` successfully\n", old_name, new_name);
 	return true;
 }
@@ -508,20 +589,16 @@ bool table_manager::update_table_name(const char *new_name)
 	
 	// 更新表名
 	std::strncpy(header.table_name, new_name, MAX_NAME_LEN);
+	tname = new_name;
 	
 	// 保存修改后的表头
-	std::string thead = "../../database/" + tname + ".thead";
-	std::ofstream ofs(thead, std::ios::binary);
-	if(!ofs) {
+	if(!save_header()) {
 		std::fprintf(stderr, "[Error] UPDATE TABLE NAME: failed to save table header\n");
 		// 回滚表头修改
 		header = old_header;
 		return false;
 	}
 	
-	ofs.write((char*)&header, sizeof(header));
-	ofs.close();
-	
 	std::printf("[Info] UPDATE TABLE NAME: table name updated to `%s`\n", new_name);
 	return true;
 }
@@ -600,9 +677,7 @@ bool table_manager::alter_table_modify_column(const field_item_t *field)
 	allocate_temp_record();
 	
 	// 保存修改后的表头
-	std::string thead = "../../database/" + tname + ".thead";
-	std::ofstream ofs(thead, std::ios::binary);
-	if(!ofs) {
+	if(!save_header()) {
 		std::fprintf(stderr, "[Error] ALTER TABLE MODIFY COLUMN: failed to save table header\n");
 		// 回滚表头修改
 		header = old_header;
@@ -610,9 +685,6 @@ bool table_manager::alter_table_modify_column(const field_item_t *field)
 		return false;
 	}
 	
-	ofs.write((char*)&header, sizeof(header));
-	ofs.close();
-	
 	std::printf("[Info] ALTER TABLE MODIFY COLUMN: column `%s` modified successfully\n", field->name);
 	return true;
 }
@@ -623,21 +695,14 @@ void table_manager::close()
 
 	if(!is_mirror)
 	{
-		// 文件存储在项目根目录的database/文件夹下
-		std::string thead = "../../database/" + tname + ".thead";
-		std::string tdata = "../../database/" + tname + ".tdata";
-
 		header.index_root[header.main_index] = btr->get_root_page_id();
 		free_indices();
 		free_check_constraints();
 
 		// 正确保存表头文件
-		std::ofstream ofs(thead, std::ios::binary);
-		if(ofs) {
-			ofs.write((char*)&header, sizeof(header));
-			ofs.close();  // 确保立即关闭文件
-		}
-		pg->close();
+		save_header();
+		// the tablespace is closed by the database
+		if(!header_page) pg->close();
 	}
 
 	btr = nullptr;
@@ -657,10 +722,64 @@ void table_manager::close()
 		tmp_index = nullptr;
 	}
 	
+	saved_header.reset();
 	is_open = false;
 	is_mirror = false;
 }
 
+void table_manager::commit()
+{
+	if(!is_open || is_mirror || !page_fs::get_instance()->is_logging())
+		return;
+
+	sync_roots();
+	if(saved_header && std::memcmp(saved_header.get(), &header, sizeof(header)) == 0)
+		return;
+	if(!saved_header)
+		saved_header.reset(new table_header_t);
+	*saved_header = header;
+	save_header();
+}
+
+/* write the header where it is kept, the .thead file or the header
+ * pages in the tablespace */
+bool table_manager::save_header()
+{
+	if(header_page)
+		return pg->write_overflow(header_page, &header, sizeof(header)) == header_page;
+	std::string thead = "../../database/" + tname + ".thead";
+	return page_fs::get_instance()->write_file(thead.c_str(), &header, sizeof(header));
+}
+
+/* the roots move as the trees grow */
+void table_manager::sync_roots()
+{
+	header.index_root[header.main_index] = btr->get_root_page_id();
+	for(int i = 0; i < header.col_num; ++i)
+	{
+		if(i != header.main_index && ((1u << i) & header.flag_indexed))
+			header.index_root[i] = indices[i]->get_root_pid();
+	}
+}
+
+int table_manager::backup_header(const char *dir)
+{
+	if(!is_open || is_mirror)
+		return 0;
+	sync_roots();
+	// the header is in the snapshot of the tablespace
+	if(header_page)
+		return save_header() ? pg->get_fid() : 0;
+	std::string thead = std::string(dir) + "/" + tname + ".thead";
+	std::ofstream ofs(thead, std::ios::binary);
+	if(!ofs || !ofs.write((char*)&header, sizeof(header)))
+	{
+		std::fprintf(stderr, "[Error] fail to write %s.\n", thead.c_str());
+		return 0;
+	}
+	return pg->get_fid();
+}
+
 int table_manager::lookup_column(const char *col_name)
 {
 	for(int i = 0; i < header.col_num; ++i)
@@ -910,7 +1029,8 @@ void table_manager::dump_record(FILE *f, record_manager *rm)
 bool table_manager::modify_record(int rid, int col, const void* data)
 {
 	assert(!is_mirror);
-	record_manager rec = get_record_ptr(rid, true);
+	// pages are made dirty as they are written, not if a check fails
+	record_manager rec = get_record_ptr(rid);
 	if(!rec.valid()) return false;
 	assert(col >= 0 && col < header.col_num);
 
@@ -971,7 +1091,7 @@ bool table_manager::has_index(int cid)
 	return (header.flag_indexed >> cid) & 1u;
 }
 
-void table_manager::create_index(const char *col_name)
+void table_manager::create_index(const char *col_name, int fill_percent)
 {
 	int cid = lookup_column(col_name);
 	if(cid < 0)
@@ -984,13 +1104,33 @@ void table_manager::create_index(const char *col_name)
 		indices[cid] = new index_manager(pg.get(),
 			header.col_length[cid],
 			header.index_root[cid],
-			get_index_comparer(header.col_type[cid])
+			header.col_type[cid]
 		);
 
-		// TODO: add existed data.
+		int num = build_index(cid, fill_percent);
+		std::printf("[Info] CREATE INDEX: %d records indexed on column `%s`\n", num, col_name);
 	}
 }
 
+/* scan the records and build the index on `cid` bottom up */
+int table_manager::build_index(int cid, int fill_percent)
+{
+	int read_size = header.col_offset[cid] + header.col_length[cid];
+	std::vector<char> rec(read_size);
+	auto it = get_record_iterator_lower_bound(INT_MIN);
+	record_manager rm(pg.get());
+	return indices[cid]->bulk_load([&](const char *&key, int &rid) {
+		if(it.is_end()) return false;
+		rm.open(it.get(), false);
+		rm.read(rec.data(), read_size);
+		it.next();
+		rid = *(int*)rec.data();
+		bool is_null = (((int*)rec.data())[1] >> cid) & 1;
+		key = is_null ? nullptr : rec.data() + header.col_offset[cid];
+		return true;
+	}, fill_percent);
+}
+
 bool table_manager::check_constraints(const char *buf)
 {
 	if(!check_notnull(buf))
@@ -23,9 +23,13 @@ class table_manager
 {
 	bool is_open, is_mirror;
 	table_header_t header;
+	// as last logged, see `commit`
+	std::unique_ptr<table_header_t> saved_header;
 	std::shared_ptr<int_btree> btr;
 	std::shared_ptr<pager> pg;
 	std::string tname;
+	// first page of the header in a tablespace, 0 if the table has files of its own
+	int header_page;
 	index_manager *indices[MAX_COL_NUM];
 	expr_node_t *check_conds[MAX_CHECK_CONSTRAINT_NUM];
 	const char *error_msg;
@@ -35,17 +39,33 @@ class table_manager
 	char *tmp_cache, *tmp_index;
 	int *tmp_null_mark;
 	void allocate_temp_record();
+	void sync_roots();
+	bool save_header();
 	void load_indices();
+	void upgrade_indices();
+	int build_index(int cid, int fill_percent);
 	void free_indices();
 	void load_check_constraints();
 	void free_check_constraints();
 public:
-	table_manager() : is_open(false), tmp_record(nullptr) { }
+	table_manager() : is_open(false), header_page(0), tmp_record(nullptr), tmp_cache(nullptr), tmp_index(nullptr) { }
 	~table_manager() { /* 析构函数不调用close()，因为database::close()已经处理了 */ }
-	bool create(const char *table_name, const table_header_t *header);
-	bool open(const char *table_name);
+	/* the data file gets pages of `page_size` bytes, PAGE_SIZE if 0.
+	 * With a tablespace the table lives in `space` instead, its header
+	 * included, and no files of its own are made. */
+	bool create(const char *table_name, const table_header_t *header, int page_size = 0,
+		std::shared_ptr<pager> space = nullptr);
+	/* `header_page` is the first page of the header in `space` */
+	bool open(const char *table_name, std::shared_ptr<pager> space = nullptr, int header_page = 0);
+	int get_header_page() { return header_page; }
 	void drop();
 	void close();
+	/* log the header if it changed since the last commit, the pages
+	 * are logged by `page_fs::commit` */
+	void commit();
+	/* write the header into `dir` for a backup, return the id of the
+	 * data file, which `page_fs::copy_snapshot` copies. 0 on error. */
+	int backup_header(const char *dir);
 	std::shared_ptr<table_manager> mirror(const char *alias_name);
 
 	int lookup_column(const char *col_name);
@@ -60,13 +80,20 @@ public:
 	void init_temp_record();
 	int insert_record();
 	bool remove_record(int rid);
+	// give the space of freed pages back to the OS, see `page_fs::compact`
+	int compact(bool when_due = false) { return pg->compact(when_due); }
+	// store the pages of the table compressed, see `page_fs::compress_page`
+	bool set_compression(bool enable) { return pg->set_compression(enable); }
+	bool get_compression() { return pg->get_compression(); }
 	bool modify_record(int rid, int col, const void* data);
 	bool set_temp_record(int col, const void* data);
 
 	void cache_record(record_manager *rm);
 	const char* get_cached_column(int cid);
 
-	void create_index(const char *col_name);
+	/* index the records in the table, with pages of the index filled
+	 * to `fill_percent` */
+	void create_index(const char *col_name, int fill_percent = INDEX_FILL_PERCENT);
 	bool has_index(const char *col_name);
 	bool has_index(int cid);
 	index_manager *get_index(int cid);
@@ -9,6 +9,8 @@ struct table_header_t
 	uint8_t col_num;
 	// main index for this table
 	uint8_t main_index, is_main_index_additional;
+	// INDEX_KEY_VERSION of the indices, in what was padding, so 0 before
+	uint8_t index_key_version;
 
 	int records_num, primary_key_num, check_constaint_num, foreign_key_num;
 	uint32_t flag_notnull, flag_primary, flag_indexed, flag_unique, flag_default;
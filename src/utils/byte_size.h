@@ -0,0 +1,35 @@
+#ifndef __TRIVIALDB_BYTE_SIZE__
+#define __TRIVIALDB_BYTE_SIZE__
+
+#include <cctype>
+#include <cstdlib>
+#include <cstdint>
+
+/* Parse sizes like `4096`, `64K`, `512M`, `2G` (optionally followed by `B`).
+ * Return false if `str` is not a valid size. */
+inline bool parse_byte_size(const char *str, std::uint64_t &bytes)
+{
+	if(!str || !std::isdigit((unsigned char)*str))
+		return false;
+
+	char *end;
+	std::uint64_t val = std::strtoull(str, &end, 10);
+	int shift = 0;
+	switch(std::toupper((unsigned char)*end))
+	{
+		case 'K': shift = 10; ++end; break;
+		case 'M': shift = 20; ++end; break;
+		case 'G': shift = 30; ++end; break;
+		default: break;
+	}
+
+	if(std::toupper((unsigned char)*end) == 'B')
+		++end;
+	if(*end != 0 || val > (UINT64_MAX >> shift))
+		return false;
+
+	bytes = val << shift;
+	return true;
+}
+
+#endif
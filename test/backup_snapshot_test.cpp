@@ -0,0 +1,124 @@
+/* A backup must hold the files as they were at its snapshot, whatever
+ * changes while they are copied. A file of pages is written and a
+ * snapshot taken, the file on disk then being the image the backup has
+ * to match. Pages are changed in place, freed and allocated again, and
+ * added at the end while `copy_snapshot` goes on in another thread, the
+ * buffer pool being small so that the changed pages are written back
+ * before the copy reads them. The backup is compared with the image.
+ * Run with each replacement policy.
+ * Usage: backup_snapshot_test [pages] */
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../src/fs/page_fs.h"
+
+static const char *file_name = "backup_snapshot_test.tdata";
+static const char *backup_name = "backup_snapshot_test.backup";
+
+/* a value at both ends of the page */
+static void put(page_fs *fs, int file_id, int page_id, int value)
+{
+	page_guard page = fs->read_for_write(file_id, page_id);
+	int *p = (int*)page.get();
+	p[0] = p[page.size() / sizeof(int) - 1] = value;
+}
+
+static std::vector<char> read_file(const char *name)
+{
+	std::vector<char> data;
+	FILE *f = std::fopen(name, "rb");
+	if(!f) return data;
+	char buf[1 << 16];
+	std::size_t n;
+	while((n = std::fread(buf, 1, sizeof(buf), f)) != 0)
+		data.insert(data.end(), buf, buf + n);
+	std::fclose(f);
+	return data;
+}
+
+/* pages of the backup which differ from the snapshot, -1 on error */
+static int backup_run(const char *policy, int pages)
+{
+	std::remove(file_name);
+	std::remove(backup_name);
+	page_fs *fs = page_fs::get_instance();
+	fs->set_policy(policy);
+	fs->resize(PAGE_CACHE_MIN_CAPACITY);
+	int fid = fs->open(file_name);
+	for(int i = 1; i <= pages; ++i)
+		put(fs, fid, fs->allocate(fid), i);
+	for(int i = 7; i <= pages; i += 10)
+		fs->deallocate(fid, i);
+
+	if(!fs->begin_snapshot(&fid, 1))
+	{
+		fs->close(fid);
+		return -1;
+	}
+	std::vector<char> image = read_file(file_name);
+
+	// each change is the first of its page now and then
+	std::atomic<bool> copying(true);
+	std::atomic<int> changes(0);
+	std::thread changer([&] {
+		std::mt19937 rng(1);
+		for(int round = 1; copying; ++round)
+		{
+			int page_id = 1 + (int)(rng() % pages);
+			if(page_id % 10 == 3)
+			{
+				fs->deallocate(fid, page_id);
+				put(fs, fid, fs->allocate(fid, page_id), -round);
+			} else if(page_id % 10 == 7) {
+				put(fs, fid, fs->allocate(fid, page_id), -round);
+			} else {
+				put(fs, fid, page_id, -round);
+			}
+			if(round % 16 == 0)
+				put(fs, fid, fs->allocate(fid, pages + 1), -round);
+			++changes;
+		}
+	} );
+	// let a few changes be made before the copy starts
+	while(changes < 100)
+		std::this_thread::yield();
+	std::int64_t bytes = fs->copy_snapshot(fid, backup_name);
+	int during = changes;
+	copying = false;
+	changer.join();
+	fs->end_snapshot();
+	fs->close(fid);
+
+	std::vector<char> backup = read_file(backup_name);
+	std::remove(file_name);
+	std::remove(backup_name);
+	if(bytes <= 0 || (std::int64_t)backup.size() != bytes || (std::int64_t)image.size() < bytes)
+		return -1;
+
+	int bad = 0;
+	for(std::int64_t offset = 0; offset < bytes; offset += PAGE_SIZE)
+		bad += !std::equal(backup.begin() + offset, backup.begin() + offset + PAGE_SIZE, image.begin() + offset);
+	std::printf("%s: %d pages, %d changes by the end of the copy, %d pages of the backup differ\n",
+		policy, (int)(bytes / PAGE_SIZE), during, bad);
+	return bad;
+}
+
+int main(int argc, char *argv[])
+{
+	int pages = argc > 1 ? std::atoi(argv[1]) : 8000;
+
+	int failed = 0;
+	for(const char *policy : { "lru", "2q" })
+	{
+		int bad = backup_run(policy, pages);
+		if(bad < 0)
+			std::printf("%s: the backup failed\n", policy);
+		failed += bad != 0;
+	}
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,249 @@
+/* Indices whose keys are encoded as before INDEX_KEY_VERSION 1 must be
+ * built again when their table is opened. A table in a tablespace gets
+ * an INT and a FLOAT column with duplicates, negative values and NULLs.
+ * Its indices are then written as the baseline did, [rid, nullmark,
+ * data] with the data in host order and 1 marking NULL, and the header
+ * is put back to version 0. After the table is opened again, the keys
+ * of each index must come in the order of their values, NULL first, and
+ * a lookup of each row must find it.
+ * Usage: index_upgrade_test [rows] */
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "../src/table/table.h"
+
+static const char *file_name = "index_upgrade_test.tdata";
+static const int int_col = 0, float_col = 1, rowid_col = 2;
+
+/* the order of baseline keys, NULL first, then by the data in host
+ * order and by the rid */
+template<typename T>
+static bool baseline_less(const char *a, const char *b)
+{
+	if(a[4] != b[4])
+		return a[4];
+	if(!a[4])
+	{
+		T x, y;
+		std::memcpy(&x, a + 5, sizeof(T));
+		std::memcpy(&y, b + 5, sizeof(T));
+		if(x != y) return x < y;
+	}
+	int ra, rb;
+	std::memcpy(&ra, a, sizeof(int));
+	std::memcpy(&rb, b, sizeof(int));
+	return ra < rb;
+}
+
+struct row_t
+{
+	int rid, i;
+	float f;
+	bool i_null, f_null;
+};
+
+static void fill_header(table_header_t *header)
+{
+	std::memset(header, 0, sizeof(*header));
+	std::strcpy(header->table_name, "t");
+	const char *names[] = { "i", "f", "__rowid__" };
+	const int types[] = { COL_TYPE_INT, COL_TYPE_FLOAT, COL_TYPE_INT };
+	const int offsets[] = { 8, 12, 0 };
+	for(int c = 0; c != 3; ++c)
+	{
+		std::strcpy(header->col_name[c], names[c]);
+		header->col_type[c] = types[c];
+		header->col_length[c] = 4;
+		header->col_offset[c] = offsets[c];
+	}
+	header->col_num = 3;
+	header->main_index = rowid_col;
+	header->is_main_index_additional = 1;
+	header->flag_indexed = header->flag_primary = header->flag_notnull = 1u << rowid_col;
+	header->primary_key_num = 1;
+	header->auto_inc = 1;
+}
+
+/* Write the index of `col` as the baseline did, return its root. The
+ * pages are laid out as they are now, only the keys and their order
+ * differ, so the keys are sorted here and loaded bottom up. */
+template<typename T>
+static int write_baseline_index(pager *pg, const std::vector<row_t> &rows, int col)
+{
+	const int key_size = 1 + sizeof(T) + sizeof(int);
+	std::vector<char> keys(rows.size() * key_size);
+	std::vector<const char*> order;
+	for(size_t k = 0; k != rows.size(); ++k)
+	{
+		const row_t &r = rows[k];
+		char *key = &keys[k * key_size];
+		bool is_null = col == int_col ? r.i_null : r.f_null;
+		std::memcpy(key, &r.rid, sizeof(int));
+		key[4] = is_null;
+		if(!is_null)
+		{
+			if(col == int_col) std::memcpy(key + 5, &r.i, sizeof(T));
+			else std::memcpy(key + 5, &r.f, sizeof(T));
+		}
+		order.push_back(key);
+	}
+	std::sort(order.begin(), order.end(), baseline_less<T>);
+
+	index_btree<fixed_key_comparer> bt(pg, 0, key_size);
+	size_t next = 0;
+	bt.bulk_load([&]() -> const char* {
+		return next == order.size() ? nullptr : order[next++];
+	}, 100);
+	return bt.get_root_page_id();
+}
+
+/* the key `index_manager` makes for the value of `col` in `r` */
+static void encode_key(char *key, const row_t &r, int col)
+{
+	bool is_null = col == int_col ? r.i_null : r.f_null;
+	key[0] = !is_null;
+	std::memset(key + 1, 0, 4);
+	if(!is_null)
+	{
+		if(col == int_col) index_key::encode_int(key + 1, r.i);
+		else index_key::encode_float(key + 1, r.f);
+	}
+	index_key::encode_int(key + 5, r.rid);
+}
+
+/* the rows in the order of the index on `col` */
+static std::vector<row_t> index_order(std::vector<row_t> rows, int col)
+{
+	std::stable_sort(rows.begin(), rows.end(), [col](const row_t &a, const row_t &b) {
+		bool a_null = col == int_col ? a.i_null : a.f_null;
+		bool b_null = col == int_col ? b.i_null : b.f_null;
+		if(a_null != b_null) return a_null;
+		if(!a_null)
+		{
+			if(col == int_col && a.i != b.i) return a.i < b.i;
+			if(col == float_col && a.f != b.f) return a.f < b.f;
+		}
+		return a.rid < b.rid;
+	} );
+	return rows;
+}
+
+/* keys of the index on `col` out of order or not found, 0 if none */
+static int check_index(pager *pg, index_manager *index, const std::vector<row_t> &rows, int col)
+{
+	int bad = 0;
+	char key[9];
+
+	// a scan from the first key gives every row in order
+	std::vector<row_t> sorted = index_order(rows, col);
+	auto it = index->get_iterator_lower_bound(nullptr, 0);
+	for(const row_t &r : sorted)
+	{
+		if(it.is_end())
+		{
+			std::printf("index on column %d: %d keys missing\n", col, (int)rows.size());
+			return bad + 1;
+		}
+		index_page<true> page { pg->read(it.get().first), pg };
+		encode_key(key, r, col);
+		if(std::memcmp(page.get_key(it.get().second), key, sizeof(key)) != 0)
+			++bad;
+		it.next();
+	}
+	if(!it.is_end())
+		++bad;
+
+	// a lookup of each row finds its key
+	for(const row_t &r : rows)
+	{
+		bool is_null = col == int_col ? r.i_null : r.f_null;
+		const char *value = is_null ? nullptr
+			: col == int_col ? (const char*)&r.i : (const char*)&r.f;
+		auto pos = index->lower_bound(value, r.rid);
+		encode_key(key, r, col);
+		index_page<true> page { pg->read(pos.first), pg };
+		if(pos.second >= page.size() || std::memcmp(page.get_key(pos.second), key, sizeof(key)) != 0)
+			++bad;
+	}
+
+	std::printf("index on column %d: %d of %d keys bad\n", col, bad, (int)rows.size());
+	return bad;
+}
+
+int main(int argc, char *argv[])
+{
+	int num = argc > 1 ? std::atoi(argv[1]) : 2000;
+	std::remove(file_name);
+
+	// duplicates, negative values and NULLs in both columns
+	std::vector<row_t> rows;
+	for(int k = 0; k != num; ++k)
+	{
+		row_t r;
+		r.i = k % 50 - 25;
+		r.f = (k * 37 % 101 - 50) * 0.25f;
+		r.i_null = k % 9 == 4;
+		r.f_null = k % 11 == 7;
+		rows.push_back(r);
+	}
+
+	int header_page;
+	{
+		auto space = std::make_shared<pager>(file_name);
+		table_header_t header;
+		fill_header(&header);
+		table_manager tm;
+		if(!tm.create("t", &header, 0, space))
+		{
+			std::printf("cannot create the table\n");
+			return 1;
+		}
+		for(row_t &r : rows)
+		{
+			tm.init_temp_record();
+			tm.set_temp_record(int_col, r.i_null ? nullptr : &r.i);
+			tm.set_temp_record(float_col, r.f_null ? nullptr : &r.f);
+			r.rid = tm.insert_record();
+		}
+		header_page = tm.get_header_page();
+		tm.close();
+
+		// indices and a header as the baseline wrote them
+		space->read_overflow(header_page, &header, sizeof(header));
+		header.index_root[int_col] = write_baseline_index<int>(space.get(), rows, int_col);
+		header.index_root[float_col] = write_baseline_index<float>(space.get(), rows, float_col);
+		header.flag_indexed |= 1u << int_col | 1u << float_col;
+		header.index_key_version = 0;
+		space->write_overflow(header_page, &header, sizeof(header));
+	}
+
+	int bad = 0;
+	{
+		auto space = std::make_shared<pager>(file_name);
+		table_manager tm;
+		if(!tm.open("t", space, header_page))
+		{
+			std::printf("cannot open the table\n");
+			return 1;
+		}
+		bad += check_index(space.get(), tm.get_index(int_col), rows, int_col);
+		bad += check_index(space.get(), tm.get_index(float_col), rows, float_col);
+		tm.close();
+
+		table_header_t header;
+		space->read_overflow(header_page, &header, sizeof(header));
+		if(header.index_key_version != INDEX_KEY_VERSION)
+		{
+			std::printf("index key version %d after the upgrade\n", header.index_key_version);
+			++bad;
+		}
+	}
+
+	std::remove(file_name);
+	std::printf("%s\n", bad ? "FAILED" : "passed");
+	return bad ? 1 : 0;
+}
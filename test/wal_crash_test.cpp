@@ -0,0 +1,107 @@
+/* A crash in the middle of a statement must leave the files as the last
+ * commit left them. A child process commits a file of pages, changes a
+ * few of them without committing, reads the whole file through a small
+ * buffer pool so the changed pages would be evicted, and exits without
+ * closing anything. The file is then opened again through the log.
+ * Run with each replacement policy.
+ * Usage: wal_crash_test [pages] [changed pages] */
+#include <cstdio>
+#include <cstdlib>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../src/fs/page_fs.h"
+
+static const char *log_name = "wal_crash_test.wal";
+static const char *file_name = "wal_crash_test.tdata";
+
+static void put(page_fs *fs, int file_id, int page_id, int value)
+{
+	page_guard page = fs->read_for_write(file_id, page_id);
+	*(int*)page.get() = value;
+}
+
+/* Run `body` in a child process, its exit status, -1 if it did not exit.
+ * The buffer pool and the log belong to the process, so the crash and
+ * the recovery each get one. */
+template<typename Fn>
+static int in_child(Fn body)
+{
+	std::fflush(stdout);
+	pid_t pid = fork();
+	if(pid < 0)
+	{
+		std::perror("fork");
+		return -1;
+	}
+	if(pid == 0)
+	{
+		int ret = body();
+		std::fflush(stdout);
+		_exit(ret);
+	}
+	int status;
+	if(waitpid(pid, &status, 0) != pid || !WIFEXITED(status))
+		return -1;
+	return WEXITSTATUS(status);
+}
+
+/* changed pages found on disk after the crash, -1 if a run failed */
+static int crash_run(const char *policy, int pages, int changed)
+{
+	std::remove(log_name);
+	std::remove(file_name);
+
+	int ret = in_child([&] {
+		page_fs *fs = page_fs::get_instance();
+		fs->set_policy(policy);
+		fs->resize(PAGE_CACHE_MIN_CAPACITY);
+		fs->open_log(log_name);
+		int fid = fs->open(file_name);
+		for(int i = 0; i != pages; ++i)
+			put(fs, fid, fs->allocate(fid), 1);
+		fs->commit();
+		// empty the log, the file alone holds the committed pages
+		fs->checkpoint();
+
+		for(int i = 1; i <= changed; ++i)
+			put(fs, fid, i * pages / (changed + 1), 2);
+		for(int round = 0; round != 3; ++round)
+			for(int i = 1; i <= pages; ++i)
+				fs->read(fid, i);
+		// give the background writer its turn, then crash
+		usleep(200000);
+		return 0;
+	} );
+	if(ret != 0)
+		return -1;
+
+	int bad = in_child([&] {
+		page_fs *fs = page_fs::get_instance();
+		fs->open_log(log_name);
+		int fid = fs->open(file_name);
+		int n = 0;
+		for(int i = 1; i <= pages; ++i)
+			n += *(int*)fs->read(fid, i).get() != 1;
+		return n < 255 ? n : 255;
+	} );
+	std::remove(log_name);
+	std::remove(file_name);
+	return bad;
+}
+
+int main(int argc, char *argv[])
+{
+	int pages = argc > 1 ? std::atoi(argv[1]) : 4000;
+	int changed = argc > 2 ? std::atoi(argv[2]) : 40;
+
+	int failed = 0;
+	for(const char *policy : { "lru", "2q" })
+	{
+		int bad = crash_run(policy, pages, changed);
+		std::printf("%s: %d pages, %d changed without a commit, %d of them on disk after the crash\n",
+			policy, pages, changed, bad);
+		failed += bad != 0;
+	}
+	return failed ? 1 : 0;
+}
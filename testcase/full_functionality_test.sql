@@ -151,6 +151,10 @@ SHOW TABLE employees;
 ALTER TABLE departments DROP COLUMN employeecount;
 SHOW TABLE departments;
 
+-- SET compression：company_db 是默认的 4K 页，压缩省不出一个块，应报 [Error]，仍为 compression = none
+ALTER TABLE departments SET compression = lz;
+SHOW TABLE departments;
+
 -----------------------------------------------
 -- 第八部分：RENAME TABLE 测试
 -----------------------------------------------
@@ -168,6 +172,201 @@ DROP TABLE employees;
 DROP TABLE departments;
 DROP DATABASE company_db;
 
+-- 大于 4K 的页才能压缩，应为 compression = lz
+CREATE DATABASE zip_db PAGE_SIZE = '16K';
+USE zip_db;
+CREATE TABLE notes (
+    note_id int PRIMARY KEY,
+    body varchar(200)
+);
+ALTER TABLE notes SET compression = lz;
+SHOW TABLE notes;
+DROP TABLE notes;
+DROP DATABASE zip_db;
+
+-----------------------------------------------
+-- 第十部分：在已有数据的表上建索引 (CREATE INDEX)
+-----------------------------------------------
+
+-- 先插入数据再建索引：sensor 有重复值、负数和 NULL
+CREATE DATABASE index_db;
+USE index_db;
+CREATE TABLE readings (
+    reading_id int PRIMARY KEY,
+    sensor int
+);
+INSERT INTO readings VALUES (1, -11), (2, -10), (3, -9), (4, -8), (5, -7), (6, -6), (7, -5), (8, -4), (9, -3), (10, NULL), (11, -1), (12, 0), (13, 1), (14, 2), (15, 3), (16, 4), (17, 5), (18, 6), (19, 7), (20, NULL);
+INSERT INTO readings VALUES (21, 9), (22, 10), (23, 11), (24, 12), (25, -12), (26, -11), (27, -10), (28, -9), (29, -8), (30, NULL), (31, -6), (32, -5), (33, -4), (34, -3), (35, -2), (36, -1), (37, 0), (38, 1), (39, 2), (40, NULL);
+INSERT INTO readings VALUES (41, 4), (42, 5), (43, 6), (44, 7), (45, 8), (46, 9), (47, 10), (48, 11), (49, 12), (50, NULL), (51, -11), (52, -10), (53, -9), (54, -8), (55, -7), (56, -6), (57, -5), (58, -4), (59, -3), (60, NULL);
+INSERT INTO readings VALUES (61, -1), (62, 0), (63, 1), (64, 2), (65, 3), (66, 4), (67, 5), (68, 6), (69, 7), (70, NULL), (71, 9), (72, 10), (73, 11), (74, 12), (75, -12), (76, -11), (77, -10), (78, -9), (79, -8), (80, NULL);
+INSERT INTO readings VALUES (81, -6), (82, -5), (83, -4), (84, -3), (85, -2), (86, -1), (87, 0), (88, 1), (89, 2), (90, NULL), (91, 4), (92, 5), (93, 6), (94, 7), (95, 8), (96, 9), (97, 10), (98, 11), (99, 12), (100, NULL);
+INSERT INTO readings VALUES (101, -11), (102, -10), (103, -9), (104, -8), (105, -7), (106, -6), (107, -5), (108, -4), (109, -3), (110, NULL), (111, -1), (112, 0), (113, 1), (114, 2), (115, 3), (116, 4), (117, 5), (118, 6), (119, 7), (120, NULL);
+INSERT INTO readings VALUES (121, 9), (122, 10), (123, 11), (124, 12), (125, -12), (126, -11), (127, -10), (128, -9), (129, -8), (130, NULL), (131, -6), (132, -5), (133, -4), (134, -3), (135, -2), (136, -1), (137, 0), (138, 1), (139, 2), (140, NULL);
+INSERT INTO readings VALUES (141, 4), (142, 5), (143, 6), (144, 7), (145, 8), (146, 9), (147, 10), (148, 11), (149, 12), (150, NULL), (151, -11), (152, -10), (153, -9), (154, -8), (155, -7), (156, -6), (157, -5), (158, -4), (159, -3), (160, NULL);
+INSERT INTO readings VALUES (161, -1), (162, 0), (163, 1), (164, 2), (165, 3), (166, 4), (167, 5), (168, 6), (169, 7), (170, NULL), (171, 9), (172, 10), (173, 11), (174, 12), (175, -12), (176, -11), (177, -10), (178, -9), (179, -8), (180, NULL);
+INSERT INTO readings VALUES (181, -6), (182, -5), (183, -4), (184, -3), (185, -2), (186, -1), (187, 0), (188, 1), (189, 2), (190, NULL), (191, 4), (192, 5), (193, 6), (194, 7), (195, 8), (196, 9), (197, 10), (198, 11), (199, 12), (200, NULL);
+INSERT INTO readings VALUES (201, -11), (202, -10), (203, -9), (204, -8), (205, -7), (206, -6), (207, -5), (208, -4), (209, -3), (210, NULL), (211, -1), (212, 0), (213, 1), (214, 2), (215, 3), (216, 4), (217, 5), (218, 6), (219, 7), (220, NULL);
+INSERT INTO readings VALUES (221, 9), (222, 10), (223, 11), (224, 12), (225, -12), (226, -11), (227, -10), (228, -9), (229, -8), (230, NULL), (231, -6), (232, -5), (233, -4), (234, -3), (235, -2), (236, -1), (237, 0), (238, 1), (239, 2), (240, NULL);
+INSERT INTO readings VALUES (241, 4), (242, 5), (243, 6), (244, 7), (245, 8), (246, 9), (247, 10), (248, 11), (249, 12), (250, NULL), (251, -11), (252, -10), (253, -9), (254, -8), (255, -7), (256, -6), (257, -5), (258, -4), (259, -3), (260, NULL);
+INSERT INTO readings VALUES (261, -1), (262, 0), (263, 1), (264, 2), (265, 3), (266, 4), (267, 5), (268, 6), (269, 7), (270, NULL), (271, 9), (272, 10), (273, 11), (274, 12), (275, -12), (276, -11), (277, -10), (278, -9), (279, -8), (280, NULL);
+INSERT INTO readings VALUES (281, -6), (282, -5), (283, -4), (284, -3), (285, -2), (286, -1), (287, 0), (288, 1), (289, 2), (290, NULL), (291, 4), (292, 5), (293, 6), (294, 7), (295, 8), (296, 9), (297, 10), (298, 11), (299, 12), (300, NULL);
+
+-- 索引页只填到 70%，自底向上一次建成
+SET index_fill_percent = 70;
+CREATE INDEX readings(sensor);
+
+-- 等值查找，应为 12
+SELECT COUNT(*) FROM readings WHERE sensor = 5;
+-- NULL 也在索引中，应为 30
+SELECT COUNT(*) FROM readings WHERE sensor IS NULL;
+-- 范围扫描，应为 66
+SELECT COUNT(*) FROM readings WHERE sensor >= -3 AND sensor <= 2;
+SELECT * FROM readings WHERE sensor >= 11;
+
+-- 建索引后继续插入：180 个相同的键落在同一叶页，未填满的页仍会分裂
+INSERT INTO readings VALUES (301, 5), (302, 5), (303, 5), (304, 5), (305, 5), (306, 5), (307, 5), (308, 5), (309, 5), (310, 5), (311, 5), (312, 5), (313, 5), (314, 5), (315, 5), (316, 5), (317, 5), (318, 5), (319, 5), (320, 5);
+INSERT INTO readings VALUES (321, 5), (322, 5), (323, 5), (324, 5), (325, 5), (326, 5), (327, 5), (328, 5), (329, 5), (330, 5), (331, 5), (332, 5), (333, 5), (334, 5), (335, 5), (336, 5), (337, 5), (338, 5), (339, 5), (340, 5);
+INSERT INTO readings VALUES (341, 5), (342, 5), (343, 5), (344, 5), (345, 5), (346, 5), (347, 5), (348, 5), (349, 5), (350, 5), (351, 5), (352, 5), (353, 5), (354, 5), (355, 5), (356, 5), (357, 5), (358, 5), (359, 5), (360, 5);
+INSERT INTO readings VALUES (361, 5), (362, 5), (363, 5), (364, 5), (365, 5), (366, 5), (367, 5), (368, 5), (369, 5), (370, 5), (371, 5), (372, 5), (373, 5), (374, 5), (375, 5), (376, 5), (377, 5), (378, 5), (379, 5), (380, 5);
+INSERT INTO readings VALUES (381, 5), (382, 5), (383, 5), (384, 5), (385, 5), (386, 5), (387, 5), (388, 5), (389, 5), (390, 5), (391, 5), (392, 5), (393, 5), (394, 5), (395, 5), (396, 5), (397, 5), (398, 5), (399, 5), (400, 5);
+INSERT INTO readings VALUES (401, 5), (402, 5), (403, 5), (404, 5), (405, 5), (406, 5), (407, 5), (408, 5), (409, 5), (410, 5), (411, 5), (412, 5), (413, 5), (414, 5), (415, 5), (416, 5), (417, 5), (418, 5), (419, 5), (420, 5);
+INSERT INTO readings VALUES (421, 5), (422, 5), (423, 5), (424, 5), (425, 5), (426, 5), (427, 5), (428, 5), (429, 5), (430, 5), (431, 5), (432, 5), (433, 5), (434, 5), (435, 5), (436, 5), (437, 5), (438, 5), (439, 5), (440, 5);
+INSERT INTO readings VALUES (441, 5), (442, 5), (443, 5), (444, 5), (445, 5), (446, 5), (447, 5), (448, 5), (449, 5), (450, 5), (451, 5), (452, 5), (453, 5), (454, 5), (455, 5), (456, 5), (457, 5), (458, 5), (459, 5), (460, 5);
+INSERT INTO readings VALUES (461, 5), (462, 5), (463, 5), (464, 5), (465, 5), (466, 5), (467, 5), (468, 5), (469, 5), (470, 5), (471, 5), (472, 5), (473, 5), (474, 5), (475, 5), (476, 5), (477, 5), (478, 5), (479, 5), (480, 5);
+-- 应为 192
+SELECT COUNT(*) FROM readings WHERE sensor = 5;
+-- 应仍为 66
+SELECT COUNT(*) FROM readings WHERE sensor >= -3 AND sensor <= 2;
+SET index_fill_percent = 90;
+DROP TABLE readings;
+DROP DATABASE index_db;
+
+-----------------------------------------------
+-- 第十一部分：VARCHAR 索引
+-----------------------------------------------
+
+-- 键按实际长度存放：长短不一的键逐条插入，其中 15 个达到 200 个字符的最大长度，叶页会分裂
+CREATE DATABASE varchar_db;
+USE varchar_db;
+CREATE TABLE tags (
+    tag_id int PRIMARY KEY,
+    name varchar(200)
+);
+CREATE INDEX tags(name);
+INSERT INTO tags VALUES (1, 'k01-abcdefghijabcdefghijabcdefghijabc'), (2, 'k02-abcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdef'), (3, 'max-yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy0003'), (4, 'k04-abcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcd');
+INSERT INTO tags VALUES (5, 'k0'), (6, 'max-yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy0006'), (7, 'k07-abcdefghija'), (8, 'k08-abcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghij');
+INSERT INTO tags VALUES (9, 'max-yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy0009'), (10, 'k'), (11, 'k11-abcdefghijabcdefghijabcdefghijabc'), (12, 'max-yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy0012');
+INSERT INTO tags VALUES (13, 'k13-ab'), (14, 'k14-abcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcd'), (15, 'max-yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy0015'), (16, 'k16-abcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdef');
+INSERT INTO tags VALUES (17, 'k17-abcdefghija'), (18, 'max-yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy0018'), (19, 'k19'), (20, 'k');
+INSERT INTO tags VALUES (21, 'max-yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy0021'), (22, 'k22-abcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdef'), (23, 'k23-ab'), (24, 'max-yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy0024');
+INSERT INTO tags VALUES (25, 'k2'), (26, 'k26-abcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdef'), (27, 'max-yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy0027'), (28, 'k28-abcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghij');
+INSERT INTO tags VALUES (29, 'k29'), (30, 'max-yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy0030'), (31, 'k31-abcdefghijabcdefghijabcdefghijabc'), (32, 'k32-abcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdef');
+INSERT INTO tags VALUES (33, 'max-yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy0033'), (34, 'k34-abcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcd'), (35, 'k3'), (36, 'max-yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy0036');
+INSERT INTO tags VALUES (37, 'k37-abcdefghija'), (38, 'k38-abcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghij'), (39, 'max-yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy0039'), (40, 'k');
+INSERT INTO tags VALUES (41, 'k41-abcdefghijabcdefghijabcdefghijabc'), (42, 'max-yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy0042'), (43, 'k43-ab'), (44, 'k44-abcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcd');
+INSERT INTO tags VALUES (45, 'max-yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy0045'), (46, 'k46-abcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdef');
+
+-- 应为 46
+SELECT COUNT(*) FROM tags;
+-- 重复的短键，应为 3
+SELECT COUNT(*) FROM tags WHERE name = 'k';
+-- 按最大长度的键查找，应为 tag_id 21
+SELECT tag_id FROM tags WHERE name = 'max-yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy0021';
+-- 最大长度的键共 15 个
+SELECT COUNT(*) FROM tags WHERE name LIKE 'max-%';
+
+-- 删除一半后再插回同样的键
+DELETE FROM tags WHERE tag_id <= 23;
+-- 应为 0 行、1、8
+SELECT tag_id FROM tags WHERE name = 'max-yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy0021';
+SELECT COUNT(*) FROM tags WHERE name = 'k';
+SELECT COUNT(*) FROM tags WHERE name LIKE 'max-%';
+INSERT INTO tags VALUES (1, 'k01-abcdefghijabcdefghijabcdefghijabc'), (2, 'k02-abcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdef'), (3, 'max-yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy0003'), (4, 'k04-abcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcd');
+INSERT INTO tags VALUES (5, 'k0'), (6, 'max-yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy0006'), (7, 'k07-abcdefghija'), (8, 'k08-abcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghij');
+INSERT INTO tags VALUES (9, 'max-yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy0009'), (10, 'k'), (11, 'k11-abcdefghijabcdefghijabcdefghijabc'), (12, 'max-yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy0012');
+INSERT INTO tags VALUES (13, 'k13-ab'), (14, 'k14-abcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcd'), (15, 'max-yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy0015'), (16, 'k16-abcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdef');
+INSERT INTO tags VALUES (17, 'k17-abcdefghija'), (18, 'max-yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy0018'), (19, 'k19'), (20, 'k');
+INSERT INTO tags VALUES (21, 'max-yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy0021'), (22, 'k22-abcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdef'), (23, 'k23-ab');
+-- 应为 46、21、3、15
+SELECT COUNT(*) FROM tags;
+SELECT tag_id FROM tags WHERE name = 'max-yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy0021';
+SELECT COUNT(*) FROM tags WHERE name = 'k';
+SELECT COUNT(*) FROM tags WHERE name LIKE 'max-%';
+DROP TABLE tags;
+DROP DATABASE varchar_db;
+
+-----------------------------------------------
+-- 第十二部分：单文件表空间 (TABLESPACE)
+-----------------------------------------------
+
+-- 目录是第 1 页起的溢出页链，每个表头是另一条溢出页链
+CREATE DATABASE space_db TABLESPACE;
+USE space_db;
+-- 应为 Tablespace = single file
+SHOW DATABASE space_db;
+CREATE TABLE authors (
+    author_id int PRIMARY KEY,
+    name varchar(40)
+);
+CREATE TABLE books (
+    book_id int PRIMARY KEY,
+    title varchar(60),
+    author_id int,
+    price float
+);
+INSERT INTO authors VALUES (1, 'Lu Xun'), (2, 'Lao She'), (3, 'Ba Jin');
+INSERT INTO books VALUES (11, 'Call to Arms', 1, 32.5), (12, 'Rickshaw Boy', 2, 28.0), (13, 'Teahouse', 2, 19.9), (14, 'Family', 3, 35.0);
+CREATE INDEX books(author_id);
+
+-- 删表后以不同的列重建，释放的表头页和数据页被重新使用
+DROP TABLE authors;
+CREATE TABLE authors (
+    author_id int PRIMARY KEY,
+    name varchar(40),
+    country varchar(20)
+);
+INSERT INTO authors VALUES (1, 'Lu Xun', 'China'), (2, 'Lao She', 'China'), (4, 'Lu Ling', 'China');
+CREATE TABLE reviews (
+    review_id int PRIMARY KEY,
+    book_id int,
+    stars int
+);
+INSERT INTO reviews VALUES (1, 12, 5), (2, 13, 4), (3, 12, 4);
+
+-- 重新打开：从目录和表头链读回所有表
+USE sys_db;
+USE space_db;
+-- 应为 Table number = 3
+SHOW DATABASE space_db;
+-- authors 应为 3 列
+SHOW TABLE authors;
+SELECT * FROM authors;
+-- 经索引查找，应为 2 行
+SELECT * FROM books WHERE author_id = 2;
+-- 应为 3
+SELECT COUNT(*) FROM reviews;
+
+-- 删表后再次重新打开，目录中不应再有 reviews
+DROP TABLE reviews;
+USE sys_db;
+USE space_db;
+-- 应为 Table number = 2，SHOW TABLE reviews 应报 [Error]
+SHOW DATABASE space_db;
+SHOW TABLE reviews;
+SELECT * FROM books;
+CREATE TABLE reviews (
+    review_id int PRIMARY KEY,
+    comment varchar(80)
+);
+INSERT INTO reviews VALUES (1, 'recreated after a reopen');
+USE sys_db;
+USE space_db;
+SELECT * FROM reviews;
+DROP TABLE reviews;
+DROP TABLE books;
+DROP TABLE authors;
+DROP DATABASE space_db;
+
 PRINT("========================================");
 PRINT("         所有功能测试完成！");
 PRINT("========================================");
@@ -175,11 +374,14 @@ PRINT("测试内容：");
 PRINT("✓ CREATE/USE/DROP DATABASE");
 PRINT("✓ CREATE/SHOW/DROP TABLE");
 PRINT("✓ RENAME TABLE");
-PRINT("✓ ALTER TABLE: ADD/DROP/RENAME/MODIFY");
+PRINT("✓ ALTER TABLE: ADD/DROP/RENAME/MODIFY/SET compression");
 PRINT("✓ INSERT/UPDATE/DELETE");
 PRINT("✓ SELECT: 单表查询、条件查询、投影、排序");
 PRINT("✓ 多表连接查询");
 PRINT("✓ 聚合函数: COUNT/AVG/MAX/MIN/SUM");
+PRINT("✓ CREATE INDEX: 已有数据的表上建索引、等值查找、范围扫描、建后插入");
+PRINT("✓ VARCHAR 索引: 长短不一的键、最大长度的键、删除后再插入");
+PRINT("✓ TABLESPACE: 建表、删表、重建与重新打开");
 PRINT("========================================");
 
 EXIT;
\ No newline at end of file